@@ -0,0 +1,339 @@
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_IDLE_PICKS 1000  // Patterns picked in a row without adding an item before a transaction is cut short
+
+/**
+ * Synthetic transaction generator in the style of the IBM Quest generator (Agrawal and Srikant, "Fast Algorithms for
+ * Mining Association Rules", 1994). Transactions are assembled from a pool of potentially frequent patterns, so the
+ * data has the long, overlapping frequent item sets of retail baskets rather than independent items. The output is a
+ * basket file with a line of item ids per transaction, to be mined with --format=basket.
+ */
+
+/**
+ * @brief Parameters of the generated data.
+ */
+typedef struct GeneratorOptions {
+    long numRows;           // Number of transactions
+    int numItems;           // Number of distinct items
+    double avgLength;       // Average number of items per transaction
+    int numPatterns;        // Number of potentially frequent patterns the transactions are built from
+    double avgPatternSize;  // Average number of items per pattern
+    double correlation;     // Average fraction of a pattern taken over from the previous pattern
+    double corruption;      // Average chance that an item of a pattern is dropped when it is added to a transaction
+    uint64_t seed;
+} GeneratorOptions;
+
+/**
+ * @brief A potentially frequent pattern.
+ */
+typedef struct Pattern {
+    int *items;
+    int size;
+    double weight;      // Cumulative probability of picking this pattern or one before it
+    double corruption;  // Chance to drop each item when the pattern is used
+} Pattern;
+
+static uint64_t rngState;
+
+/**
+ * @brief Returns the next 64 random bits of a splitmix64 generator, so the data only depends on the seed and not on
+ * the C library.
+ */
+static uint64_t nextRandom(void) {
+    uint64_t z = (rngState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Returns a uniformly distributed number in [0, 1).
+ */
+static double uniform(void) { return (nextRandom() >> 11) * (1.0 / 9007199254740992.0); }
+
+/**
+ * @brief Returns an exponentially distributed number with the given mean.
+ */
+static double exponential(double mean) { return -mean * log(1.0 - uniform()); }
+
+/**
+ * @brief Returns a normally distributed number, using the Box-Muller transform.
+ */
+static double normal(double mean, double stddev) {
+    double u = 1.0 - uniform();
+    return mean + stddev * sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * uniform());
+}
+
+/**
+ * @brief Returns a Poisson distributed number with the given mean, of at least 1.
+ */
+static int poisson(double mean) {
+    double limit = exp(-mean), product = uniform();
+    int n = 0;
+    while (product > limit) {
+        n++;
+        product *= uniform();
+    }
+    return n > 0 ? n : 1;
+}
+
+static void *checkedMalloc(size_t size) {
+    void *p = malloc(size);
+    if (!p) {
+        fprintf(stderr, "Failed to allocate %zu bytes.\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/**
+ * @brief Checks whether a list of items contains an item.
+ */
+static int containsItem(const int *items, int numItems, int item) {
+    for (int i = 0; i < numItems; i++) {
+        if (items[i] == item) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Creates the pool of patterns. The size of a pattern is Poisson distributed. Part of its items are taken over
+ * from the previous pattern, which makes the patterns overlap, and the rest is picked at random. Every pattern gets an
+ * exponentially distributed weight and a normally distributed corruption level.
+ */
+static Pattern *createPatterns(const GeneratorOptions *options) {
+    Pattern *patterns = checkedMalloc(options->numPatterns * sizeof(Pattern));
+    double totalWeight = 0;
+    for (int p = 0; p < options->numPatterns; p++) {
+        Pattern *pattern = &patterns[p];
+        pattern->size = poisson(options->avgPatternSize);
+        if (pattern->size > options->numItems) {
+            pattern->size = options->numItems;
+        }
+        pattern->items = checkedMalloc(pattern->size * sizeof(int));
+        int size = 0;
+        if (p > 0) {
+            const Pattern *previous = &patterns[p - 1];
+            double fraction = exponential(options->correlation);
+            int numShared = fraction >= 1 ? pattern->size : (int)(fraction * pattern->size + 0.5);
+            for (int i = 0; i < numShared && i < previous->size; i++) {
+                pattern->items[size++] = previous->items[nextRandom() % previous->size];
+                if (containsItem(pattern->items, size - 1, pattern->items[size - 1])) {
+                    size--;
+                }
+            }
+        }
+        while (size < pattern->size) {
+            int item = nextRandom() % options->numItems;
+            if (!containsItem(pattern->items, size, item)) {
+                pattern->items[size++] = item;
+            }
+        }
+        pattern->weight = exponential(1.0);
+        totalWeight += pattern->weight;
+        double corruption = normal(options->corruption, 0.1);
+        pattern->corruption = corruption < 0 ? 0 : corruption > 1 ? 1 : corruption;
+    }
+    double cumulative = 0;
+    for (int p = 0; p < options->numPatterns; p++) {
+        cumulative += patterns[p].weight / totalWeight;
+        patterns[p].weight = cumulative;
+    }
+    return patterns;
+}
+
+/**
+ * @brief Picks a pattern with a probability proportional to its weight.
+ */
+static int pickPattern(const Pattern *patterns, int numPatterns) {
+    double r = uniform();
+    int low = 0, high = numPatterns - 1;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (patterns[mid].weight < r) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static int compareInts(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Writes the transactions. The size of a transaction is Poisson distributed, and it is filled with patterns
+ * picked by weight. Items of a pattern are dropped while a uniform number stays below the corruption level of the
+ * pattern. A pattern that does not fit is added anyway in half of the cases, and otherwise saved for the next
+ * transaction. A transaction can only hold items of the patterns, so its size is capped at the number of distinct
+ * pattern items, and it is cut short if the patterns keep adding nothing, e.g. when everything is corrupted.
+ */
+static void writeTransactions(FILE *file, const GeneratorOptions *options, const Pattern *patterns) {
+    int *items = checkedMalloc((options->numItems + 1) * sizeof(int));
+    int *kept = checkedMalloc((options->numItems + 1) * sizeof(int));
+    char *inTransaction = calloc(options->numItems, 1);
+    if (!inTransaction) {
+        fprintf(stderr, "Failed to allocate the item flags.\n");
+        exit(EXIT_FAILURE);
+    }
+    int numPatternItems = 0;
+    for (int p = 0; p < options->numPatterns; p++) {
+        for (int i = 0; i < patterns[p].size; i++) {
+            if (!inTransaction[patterns[p].items[i]]) {
+                inTransaction[patterns[p].items[i]] = 1;
+                numPatternItems++;
+            }
+        }
+    }
+    memset(inTransaction, 0, options->numItems);
+    int pending = -1;
+    for (long row = 0; row < options->numRows; row++) {
+        int target = poisson(options->avgLength);
+        target = target < numPatternItems ? target : numPatternItems;
+        int numItems = 0;
+        int idlePicks = 0;
+        while (numItems < target && idlePicks < MAX_IDLE_PICKS) {
+            int p = pending >= 0 ? pending : pickPattern(patterns, options->numPatterns);
+            pending = -1;
+            const Pattern *pattern = &patterns[p];
+            int size = pattern->size;
+            while (size > 0 && uniform() < pattern->corruption) {
+                size--;
+            }
+            if (numItems + size > target && numItems > 0 && uniform() < 0.5) {
+                pending = p;
+                break;
+            }
+            // The kept items are a random subset of the pattern, drawn with a partial Fisher-Yates shuffle
+            int before = numItems;
+            memcpy(kept, pattern->items, pattern->size * sizeof(int));
+            for (int i = 0; i < size; i++) {
+                int j = i + nextRandom() % (pattern->size - i);
+                int item = kept[j];
+                kept[j] = kept[i];
+                if (!inTransaction[item]) {
+                    inTransaction[item] = 1;
+                    items[numItems++] = item;
+                }
+            }
+            idlePicks = numItems > before ? 0 : idlePicks + 1;
+        }
+        qsort(items, numItems, sizeof(int), compareInts);
+        for (int i = 0; i < numItems; i++) {
+            fprintf(file, i ? " %d" : "%d", items[i]);
+            inTransaction[items[i]] = 0;
+        }
+        fputc('\n', file);
+    }
+    free(items);
+    free(kept);
+    free(inTransaction);
+}
+
+static void printUsage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "Writes synthetic transactions in the basket format, with a line of item ids per transaction.\n"
+            "Options:\n"
+            "  -n, --rows=N         Number of transactions (default: 100000)\n"
+            "  -i, --items=N        Number of distinct items (default: 1000)\n"
+            "  -t, --length=T       Average number of items per transaction (default: 10)\n"
+            "  -p, --patterns=N     Number of potentially frequent patterns (default: 2000)\n"
+            "  -l, --pattern-length=I  Average number of items per pattern (default: 4)\n"
+            "  -s, --seed=N         Seed of the random number generator (default: 1)\n"
+            "  -o, --output=FILE    Write to FILE instead of stdout\n",
+            program);
+}
+
+/**
+ * @brief Parses a positive number option, or exits with the usage.
+ */
+static double parsePositive(const char *program, const char *name, const char *value) {
+    char *end;
+    double number = strtod(value, &end);
+    if (*end != '\0' || number <= 0) {
+        fprintf(stderr, "Invalid %s \"%s\".\n", name, value);
+        printUsage(program);
+        exit(EXIT_FAILURE);
+    }
+    return number;
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option longOptions[] = {
+        {"rows", required_argument, NULL, 'n'},
+        {"items", required_argument, NULL, 'i'},
+        {"length", required_argument, NULL, 't'},
+        {"patterns", required_argument, NULL, 'p'},
+        {"pattern-length", required_argument, NULL, 'l'},
+        {"seed", required_argument, NULL, 's'},
+        {"output", required_argument, NULL, 'o'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    GeneratorOptions options = {100000, 1000, 10, 2000, 4, 0.5, 0.5, 1};
+    const char *outputPath = NULL;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:i:t:p:l:s:o:h", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                options.numRows = parsePositive(argv[0], "number of rows", optarg);
+                break;
+            case 'i':
+                options.numItems = parsePositive(argv[0], "number of items", optarg);
+                break;
+            case 't':
+                options.avgLength = parsePositive(argv[0], "average length", optarg);
+                break;
+            case 'p':
+                options.numPatterns = parsePositive(argv[0], "number of patterns", optarg);
+                break;
+            case 'l':
+                options.avgPatternSize = parsePositive(argv[0], "average pattern length", optarg);
+                break;
+            case 's':
+                options.seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'o':
+                outputPath = optarg;
+                break;
+            case 'h':
+                printUsage(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                printUsage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (optind != argc || options.numItems < 1 || options.numPatterns < 1 || options.numRows < 1) {
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    FILE *file = outputPath ? fopen(outputPath, "w") : stdout;
+    if (!file) {
+        fprintf(stderr, "Could not open the output file at path: %s\n", outputPath);
+        exit(EXIT_FAILURE);
+    }
+    rngState = options.seed;
+    Pattern *patterns = createPatterns(&options);
+    writeTransactions(file, &options, patterns);
+    for (int p = 0; p < options.numPatterns; p++) {
+        free(patterns[p].items);
+    }
+    free(patterns);
+    if (outputPath && fclose(file) != 0) {
+        fprintf(stderr, "Could not write the output file.\n");
+        exit(EXIT_FAILURE);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,484 @@
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Benchmark harness for apriori. Every engine is run at every support threshold and thread count, a few times each.
+ * The load and mining phases are timed as reported by apriori itself, the peak RSS is taken from the rusage of the
+ * child, and the results of all runs at a support threshold must be identical. Everything is written to a JSON report,
+ * which can serve as the baseline of a later run to catch slowdowns.
+ */
+
+#define MAX_LIST 32
+#define MAX_REPEAT 64
+
+/**
+ * @brief An engine configuration: a name for the report and the apriori options it stands for.
+ */
+typedef struct Engine {
+    const char *name;
+    const char *engine;
+    const char *counting;
+} Engine;
+
+static const Engine engines[] = {
+    {"apriori", "apriori", "bitset"},
+    {"apriori-trie", "apriori", "trie"},
+    {"apriori-tiled", "apriori", "tiled"},
+    {"eclat", "eclat", "bitset"},
+    {"fpgrowth", "fpgrowth", "bitset"},
+};
+#define NUM_ENGINES (int)(sizeof(engines) / sizeof(engines[0]))
+
+/**
+ * @brief Settings of the harness.
+ */
+typedef struct BenchOptions {
+    const char *binary;
+    const char *format;
+    const char *data;
+    const char *reportPath;
+    const char *baselinePath;
+    int engineIds[NUM_ENGINES];
+    int numEngines;
+    int threads[MAX_LIST];
+    int numThreads;
+    double supports[MAX_LIST];
+    int numSupports;
+    double confidence;
+    int repeat;
+    double tolerance;  // Fraction a median may exceed the baseline by before it counts as a regression
+} BenchOptions;
+
+/**
+ * @brief Measurements of a single run of apriori.
+ */
+typedef struct Sample {
+    double loadSec;
+    double mineSec;
+    double wallSec;
+    long maxRssKb;
+    uint64_t outputHash;
+} Sample;
+
+/**
+ * @brief Summary of the repeated runs of one engine, support threshold and thread count.
+ */
+typedef struct Result {
+    const Engine *engine;
+    double support;
+    int threads;
+    double loadSec;     // Median
+    double mineSec;     // Median
+    double mineMinSec;
+    double wallSec;     // Median
+    double speedup;     // Median mining time at the first thread count divided by this one
+    long maxRssKb;      // Largest of all repetitions
+    uint64_t outputHash;
+    int match;          // The output is identical to that of the first run at this support threshold
+    double baselineSec; // Median mining time of the baseline, or 0 if it has none
+    int regression;
+} Result;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Hashes a file with 64-bit FNV-1a.
+ *
+ * @return uint64_t The hash, or 0 if the file could not be read.
+ */
+static uint64_t hashFile(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    unsigned char buffer[1 << 16];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            hash = (hash ^ buffer[i]) * 0x100000001b3ULL;
+        }
+    }
+    fclose(file);
+    return hash;
+}
+
+/**
+ * @brief Runs apriori once and measures it. Its results go to a scratch file, which is hashed, and the progress
+ * information on stdout is parsed for the times of the phases.
+ *
+ * @return int 1 on success, 0 if apriori failed. A message is printed in the latter case.
+ */
+static int runOnce(const BenchOptions *options, const Engine *engine, double support, int threads,
+                   const char *outputPath, Sample *sample) {
+    char threadArg[16], supportArg[32], confidenceArg[32];
+    snprintf(threadArg, sizeof(threadArg), "%d", threads);
+    snprintf(supportArg, sizeof(supportArg), "%g", support);
+    snprintf(confidenceArg, sizeof(confidenceArg), "%g", options->confidence);
+    char *const args[] = {(char *)options->binary, "-f", (char *)options->format, "-e", (char *)engine->engine,
+                          "-c", (char *)engine->counting, "-t", threadArg, "-O", "binary", "-o",
+                          (char *)outputPath, (char *)options->data, supportArg, confidenceArg, NULL};
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 0;
+    }
+    double start = now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 0;
+    }
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull >= 0) {
+            dup2(devNull, STDERR_FILENO);
+        }
+        close(fds[0]);
+        close(fds[1]);
+        execv(options->binary, args);
+        _exit(127);
+    }
+    close(fds[1]);
+    char info[8192];
+    size_t length = 0;
+    ssize_t n;
+    while ((n = read(fds[0], info + length, sizeof(info) - 1 - length)) > 0) {
+        length += n;
+        if (length == sizeof(info) - 1) {
+            // Only the last lines hold the timings
+            memmove(info, info + length / 2, length - length / 2);
+            length -= length / 2;
+        }
+    }
+    info[length] = '\0';
+    close(fds[0]);
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s failed with engine %s, support %g and %d threads.\n", options->binary, engine->name,
+                support, threads);
+        return 0;
+    }
+    sample->wallSec = now() - start;
+    sample->maxRssKb = usage.ru_maxrss;
+    const char *load = strstr(info, "Loading took ");
+    const char *mine = strstr(info, "Execution took ");
+    sample->loadSec = load ? atof(load + strlen("Loading took ")) : 0;
+    sample->mineSec = mine ? atof(mine + strlen("Execution took ")) : sample->wallSec;
+    sample->outputHash = hashFile(outputPath);
+    return 1;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *values, int n) {
+    qsort(values, n, sizeof(double), compareDoubles);
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+/**
+ * @brief Runs an engine repeatedly at a support threshold and thread count and summarises the runs.
+ *
+ * @return int 1 on success, 0 if a run failed or the runs disagreed on the output.
+ */
+static int runConfiguration(const BenchOptions *options, const Engine *engine, double support, int threads,
+                            const char *outputPath, Result *result) {
+    double load[MAX_REPEAT], mine[MAX_REPEAT], wall[MAX_REPEAT];
+    *result = (Result){.engine = engine, .support = support, .threads = threads};
+    for (int r = 0; r < options->repeat; r++) {
+        Sample sample;
+        if (!runOnce(options, engine, support, threads, outputPath, &sample)) {
+            return 0;
+        }
+        if (r > 0 && sample.outputHash != result->outputHash) {
+            fprintf(stderr, "Repeated runs of %s with support %g and %d threads disagree.\n", engine->name, support,
+                    threads);
+            return 0;
+        }
+        load[r] = sample.loadSec;
+        mine[r] = sample.mineSec;
+        wall[r] = sample.wallSec;
+        result->maxRssKb = sample.maxRssKb > result->maxRssKb ? sample.maxRssKb : result->maxRssKb;
+        result->outputHash = sample.outputHash;
+    }
+    result->loadSec = median(load, options->repeat);
+    result->mineSec = median(mine, options->repeat);
+    result->mineMinSec = mine[0];  // median sorted the times
+    result->wallSec = median(wall, options->repeat);
+    return 1;
+}
+
+/**
+ * @brief Reads the median mining times of a previous report. Every run of a report is on a line of its own.
+ *
+ * @return int 1 if the baseline could be read, 0 otherwise.
+ */
+static int applyBaseline(const char *path, Result *results, int numResults, double tolerance) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Could not open the baseline report at path: %s\n", path);
+        return 0;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        char name[64];
+        double support, mineSec;
+        int threads;
+        const char *run = strstr(line, "{\"engine\": ");
+        if (!run || sscanf(run, "{\"engine\": \"%63[^\"]\", \"support\": %lf, \"threads\": %d, \"loadSec\": %*f, "
+                                "\"mineSec\": %lf", name, &support, &threads, &mineSec) != 4) {
+            continue;
+        }
+        for (int i = 0; i < numResults; i++) {
+            Result *result = &results[i];
+            if (strcmp(result->engine->name, name) == 0 && result->threads == threads &&
+                (float)result->support == (float)support) {
+                result->baselineSec = mineSec;
+                // A few milliseconds of slack keep the noise of very short runs from counting
+                result->regression = result->mineSec > mineSec * (1 + tolerance) + 0.005;
+            }
+        }
+    }
+    fclose(file);
+    return 1;
+}
+
+/**
+ * @brief Writes the report. The settings and the host come first, followed by a line per configuration.
+ *
+ * @return int 1 on success, 0 if the report could not be written.
+ */
+static int writeReport(const BenchOptions *options, const Result *results, int numResults, int mismatches,
+                       int regressions) {
+    FILE *file = fopen(options->reportPath, "w");
+    if (!file) {
+        fprintf(stderr, "Could not open the report at path: %s\n", options->reportPath);
+        return 0;
+    }
+    struct utsname host;
+    uname(&host);
+    char date[32];
+    time_t t = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+    fprintf(file,
+            "{\n  \"date\": \"%s\",\n  \"host\": \"%s\",\n  \"kernel\": \"%s %s %s\",\n  \"cpus\": %ld,\n"
+            "  \"binary\": \"%s\",\n  \"data\": \"%s\",\n  \"format\": \"%s\",\n  \"confidence\": %g,\n"
+            "  \"repeat\": %d,\n  \"runs\": [\n",
+            date, host.nodename, host.sysname, host.release, host.machine, sysconf(_SC_NPROCESSORS_ONLN),
+            options->binary, options->data, options->format, options->confidence, options->repeat);
+    for (int i = 0; i < numResults; i++) {
+        const Result *r = &results[i];
+        fprintf(file,
+                "    {\"engine\": \"%s\", \"support\": %g, \"threads\": %d, \"loadSec\": %.6f, \"mineSec\": %.6f, "
+                "\"mineMinSec\": %.6f, \"wallSec\": %.6f, \"speedup\": %.3f, \"maxRssKb\": %ld, "
+                "\"outputHash\": \"%016llx\", \"match\": %s",
+                r->engine->name, r->support, r->threads, r->loadSec, r->mineSec, r->mineMinSec, r->wallSec, r->speedup,
+                r->maxRssKb, (unsigned long long)r->outputHash, r->match ? "true" : "false");
+        if (r->baselineSec > 0) {
+            fprintf(file, ", \"baselineSec\": %.6f, \"regression\": %s", r->baselineSec,
+                    r->regression ? "true" : "false");
+        }
+        fprintf(file, "}%s\n", i + 1 < numResults ? "," : "");
+    }
+    fprintf(file, "  ],\n  \"mismatches\": %d,\n  \"regressions\": %d\n}\n", mismatches, regressions);
+    return fclose(file) == 0;
+}
+
+static void printUsage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] <input>\n"
+            "Runs apriori with every engine, support threshold and thread count, checks that the results agree and "
+            "writes a JSON report.\n"
+            "Options:\n"
+            "  -b, --binary=PATH    The apriori binary (default: ./apriori)\n"
+            "  -f, --format=FORMAT  Input format of apriori (default: basket)\n"
+            "  -e, --engines=LIST   Engines to run: apriori, apriori-trie, apriori-tiled, eclat and fpgrowth\n"
+            "                       (default: all)\n"
+            "  -t, --threads=LIST   Thread counts (default: 1,2,4,8)\n"
+            "  -s, --supports=LIST  Minimum support thresholds (default: 0.01,0.005)\n"
+            "  -c, --confidence=C   Minimum confidence (default: 0.6)\n"
+            "  -r, --repeat=N       Runs per configuration; the median is reported (default: 3)\n"
+            "  -o, --report=FILE    Path of the report (default: bench_report.json)\n"
+            "  -B, --baseline=FILE  Report of an earlier run to compare the mining times with\n"
+            "  -T, --tolerance=PCT  Slowdown against the baseline that counts as a regression (default: 10)\n",
+            program);
+}
+
+/**
+ * @brief Parses a comma-separated list of numbers.
+ *
+ * @return int Number of values, or 0 if the list is invalid.
+ */
+static int parseList(const char *list, double *values) {
+    int n = 0;
+    const char *p = list;
+    while (*p && n < MAX_LIST) {
+        char *end;
+        values[n] = strtod(p, &end);
+        if (end == p || values[n] <= 0 || (*end != ',' && *end != '\0')) {
+            return 0;
+        }
+        n++;
+        p = *end == ',' ? end + 1 : end;
+    }
+    return *p ? 0 : n;
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option longOptions[] = {
+        {"binary", required_argument, NULL, 'b'},
+        {"format", required_argument, NULL, 'f'},
+        {"engines", required_argument, NULL, 'e'},
+        {"threads", required_argument, NULL, 't'},
+        {"supports", required_argument, NULL, 's'},
+        {"confidence", required_argument, NULL, 'c'},
+        {"repeat", required_argument, NULL, 'r'},
+        {"report", required_argument, NULL, 'o'},
+        {"baseline", required_argument, NULL, 'B'},
+        {"tolerance", required_argument, NULL, 'T'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    BenchOptions options = {"./apriori", "basket", NULL, "bench_report.json", NULL, {0, 1, 2, 3, 4}, NUM_ENGINES,
+                            {1, 2, 4, 8}, 4, {0.01, 0.005}, 2, 0.6, 3, 0.1};
+    double values[MAX_LIST];
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:f:e:t:s:c:r:o:B:T:h", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'b':
+                options.binary = optarg;
+                break;
+            case 'f':
+                options.format = optarg;
+                break;
+            case 'e': {
+                options.numEngines = 0;
+                char *list = strdup(optarg);
+                for (char *name = strtok(list, ","); name; name = strtok(NULL, ",")) {
+                    int id = 0;
+                    while (id < NUM_ENGINES && strcmp(engines[id].name, name) != 0) {
+                        id++;
+                    }
+                    if (id == NUM_ENGINES || options.numEngines == NUM_ENGINES) {
+                        fprintf(stderr, "Unknown engine \"%s\".\n", name);
+                        printUsage(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    options.engineIds[options.numEngines++] = id;
+                }
+                free(list);
+                break;
+            }
+            case 't':
+                options.numThreads = parseList(optarg, values);
+                for (int i = 0; i < options.numThreads; i++) {
+                    options.threads[i] = values[i];
+                }
+                break;
+            case 's':
+                options.numSupports = parseList(optarg, options.supports);
+                break;
+            case 'c':
+                options.confidence = atof(optarg);
+                break;
+            case 'r':
+                options.repeat = atoi(optarg);
+                break;
+            case 'o':
+                options.reportPath = optarg;
+                break;
+            case 'B':
+                options.baselinePath = optarg;
+                break;
+            case 'T':
+                options.tolerance = atof(optarg) / 100;
+                break;
+            case 'h':
+                printUsage(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                printUsage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (optind + 1 != argc || options.numEngines == 0 || options.numThreads == 0 || options.numSupports == 0 ||
+        options.repeat < 1 || options.repeat > MAX_REPEAT) {
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    options.data = argv[optind];
+
+    char outputPath[] = "/tmp/apriori-bench-XXXXXX";
+    int outputFd = mkstemp(outputPath);
+    if (outputFd < 0) {
+        perror("mkstemp");
+        exit(EXIT_FAILURE);
+    }
+    close(outputFd);
+
+    int numResults = options.numEngines * options.numThreads * options.numSupports;
+    Result *results = calloc(numResults, sizeof(Result));
+    int mismatches = 0, failed = 0, n = 0;
+    for (int s = 0; s < options.numSupports && !failed; s++) {
+        uint64_t reference = 0;
+        for (int e = 0; e < options.numEngines && !failed; e++) {
+            const Engine *engine = &engines[options.engineIds[e]];
+            Result *first = &results[n];
+            for (int t = 0; t < options.numThreads; t++) {
+                Result *result = &results[n];
+                if (!runConfiguration(&options, engine, options.supports[s], options.threads[t], outputPath, result)) {
+                    failed = 1;
+                    break;
+                }
+                n++;
+                reference = reference ? reference : result->outputHash;
+                result->match = result->outputHash == reference;
+                mismatches += !result->match;
+                result->speedup = first->mineSec / result->mineSec;
+                printf("%-12s support %-8g %3d threads: load %.3f s, mine %.3f s, speedup %.2f, peak RSS %ld KB%s\n",
+                       engine->name, result->support, result->threads, result->loadSec, result->mineSec,
+                       result->speedup, result->maxRssKb, result->match ? "" : ", OUTPUT DIFFERS");
+                fflush(stdout);
+            }
+        }
+    }
+    unlink(outputPath);
+
+    int regressions = 0;
+    if (options.baselinePath && applyBaseline(options.baselinePath, results, n, options.tolerance)) {
+        for (int i = 0; i < n; i++) {
+            if (results[i].regression) {
+                regressions++;
+                printf("Regression: %s at support %g with %d threads mines in %.3f s instead of %.3f s\n",
+                       results[i].engine->name, results[i].support, results[i].threads, results[i].mineSec,
+                       results[i].baselineSec);
+            }
+        }
+    }
+    if (!writeReport(&options, results, n, mismatches, regressions)) {
+        failed = 1;
+    }
+    free(results);
+    printf("Wrote %s: %d configurations, %d mismatches, %d regressions.\n", options.reportPath, n, mismatches,
+           regressions);
+    return failed || mismatches || regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
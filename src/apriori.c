@@ -1,136 +1,63 @@
+#define _GNU_SOURCE  // qsort_r
 #include "apriori.h"
 #include <omp.h>
-#include <search.h>
-#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "baskets.h"
+#include "bitset.h"
+#include "closed.h"
+#include "csv.h"
+#include "eclat.h"
+#include "fpgrowth.h"
+#include "itemsetmap.h"
+#include "kernels.h"
+#include "metrics.h"
+#include "mining.h"
+#include "output.h"
+#include "shards.h"
+#include "table.h"
+#include "transactions.h"
+#include "trie.h"
+#include "utils.h"
 
-#define MAX_LEVELS 5   // Maximum frequent set size.
-#define BUFFER_LEN 50  // Default buffer len
 #define USE_ANTI_MONOTONICITY_SUPPORT
 #define USE_ANTI_MONOTONICITY_CONFIDENCE
+#define USE_VERTICAL_BITSETS  // Count supports on per-item bitsets instead of scanning the rows of the table
+#define USE_TRIANGULAR_LEVEL2  // Count all 2-item sets in a single scan over the transactions
+#define USE_TRANSACTION_REDUCTION  // Remap, merge and shrink the transactions that COUNTING_TRIE counts on per level
+#define TRIANGLE_MEMORY_BUDGET (1 << 28)  // Max bytes used by per-thread triangular count arrays
+#define MAX_RULE_SET_SIZE 64  // The subsets of an item set are enumerated with a 64-bit mask
+#define MAX_PRUNED_SET_SIZE 24  // Larger sets are enumerated without confidence pruning, as its state takes 2^n bytes
+#define DEFAULT_MIN_SUPPORT 0.005
+#define DEFAULT_MIN_CONFIDENCE 0.6
 // #define PRINT_UTILS
 
 /**
- * @brief Struct that describes item sets at a particular level k.
+ * @brief Checks whether the subsets of a candidate of n items, other than the two sets it was joined from, are
+ * frequent.
  */
-typedef struct LevelSets {
-    int **sets;
-    int numSets;
-    int setSize;
-} LevelSets;
+typedef int (*SubsetCheck)(const ItemsetMap *supports, const int *set, int n);
 
 /**
- * @brief Prints a message to stderr and exits the program. Works with var args similar to printf.
- *
- * @param format Message to print.
- * @param ... Var args. Use is similar to printf.
+ * @brief Writes the items of an item set that are in an antecedent mask, followed by the items that are not.
  */
-static void fatalError(const char *format, ...) {
-    fprintf(stderr, "Fatal error: ");
-    va_list args;
-    va_start(args, format);
-    vfprintf(stderr, format, args);
-    va_end(args);
-    exit(EXIT_FAILURE);
-}
+typedef void (*MaskExpansion)(uint64_t subsetMask, const int *set, int setSize, int *cols);
 
 /**
- * @brief Prints a warning message to stderr.
- *
- * @param format Message to print
- * @param ... Var args. Use is similar to printf.
+ * @brief The kernels of a level: instances compiled for the size of its item sets where it is at most
+ * MAX_SPECIALIZED_SIZE, and generic loops otherwise. Selected once per level with levelKernels.
  */
-static void warning(const char *format, ...) {
-    fprintf(stderr, "Warning: ");
-    va_list args;
-    va_start(args, format);
-    vfprintf(stderr, format, args);
-    va_end(args);
-}
+typedef struct LevelKernels {
+    AndCountKernel andCount;
+    SubsetCheck subsetsExist;
+    MaskExpansion expandMask;
+} LevelKernels;
 
-/**
- * @brief Utility function to ensure malloc is not called with incorrect values. Verifies that malloc correctly
- * allocates memory.
- *
- * @param size Number of bytes to allocate.
- * @return void* Pointer to the allocated memory.
- */
-static void *safeMalloc(int size) {
-    void *p = malloc(size);
-    if (p == NULL) {
-        fatalError("safeMalloc(%d) failed.\n", size);
-    }
-    return p;
-}
-
-inline static void mapPut(char *key, int val) {
-    ENTRY item = {key, val};
-    hsearch(item, ENTER);
-}
-
-inline static int mapGet(char *key) {
-    ENTRY item;
-    ENTRY *result;
-    item.key = key;
-    result = hsearch(item, FIND);
-    free(key);
-    return result == NULL ? -1 : (int)result->data;
-}
-
-/**
- * @brief Allocates an integer matrix in such a way that it is continuous in memory and only needs a single free.
- *
- * @param width Width the matrix should have.
- * @param height Height the matrix should have.
- * @return int** Int matrix.
- */
-static int **allocIntMatrix(int width, int height) {
-    int **matrix = safeMalloc(height * sizeof(int *) + width * height * sizeof(int));
-    int *p = (int *)(matrix + height);
-    for (int y = 0; y < height; y++) {
-        matrix[y] = p + width * y;
-    }
-    return matrix;
-}
-
-/**
- * @brief Converts a set of integers to a string representation. The set {0,2,3} will be converted "023".
- *
- * @param set  The set to convert.
- * @param size Number of elements in the set.
- * @return char* Pointer to the string representation of the set.
- */
-static char *setToString(const int *set, int size) {
-    char *buf = malloc(BUFFER_LEN * sizeof(char));
-    char *tmp = buf;
-    for (int i = 0; i < size; i++) {
-        tmp += snprintf(tmp, BUFFER_LEN, "%d", set[i]);
-    }
-    return buf;
-}
-
-/**
- * @brief Frees the memory used by a level set.
- *
- * @param LevelSets The level sets to free.
- */
-static void freeLevelSet(LevelSets *LevelSets) {
-    free(LevelSets->sets);
-    free(LevelSets);
-}
-
-/**
- * @brief Frees the memory used by the table data.
- *
- * @param data The TableData to free.
- */
-static void freeCSV(TableData *data) {
-    free(data->headers[0]);
-    free(data->headers);
-    free(data->data);
-    free(data);
-}
+// maskOrder[m] lists the positions of the bits set in m, followed by the others, both in ascending order
+static unsigned char maskOrder[1 << MAX_SPECIALIZED_SIZE][MAX_SPECIALIZED_SIZE];
 
 #ifdef PRINT_UTILS
 
@@ -183,7 +110,7 @@ static void printTableData(const TableData *data) {
     printf("\n");
     for (int y = 0; y < data->numRows; y++) {
         for (int x = 0; x < data->numCols; x++) {
-            printf("%d, ", data->data[y][x]);
+            printf("%d, ", tableHasItem(data, y, x));
         }
         printf("\n");
     }
@@ -192,279 +119,671 @@ static void printTableData(const TableData *data) {
 #endif
 
 /**
- * @brief Prints a formatted association rule in the format `{A,B,C} => {D} Confidence: 0.6`. Every printed association
- * rule is alligned with the previous one.
+ * @brief Calculates the support for a given set. Note that it only counts the number of rows/
  *
- * @param numItemsLeft Number of items in the antecedent. In the example of `{A,B,C} => {D}`, this would be 3.
- * @param numItemsRight Number of items in the consequent. In the example of `{A,B,C} => {D}`, this would be 1.
- * @param cols Columns in the complete set. In the example of `{A,B,C} => {D}`,, this set would contain {A, B, C, D}.
- * @param data TableData* Table where each row signifies a transaction and each column a product. An entry in this table
- * is either 1 or 0, depending on whether the product occured in the provided transacion.
- * @param confidence The confidence value to print.
+ * @param ctx Mining context containing the data to count in. If the context has bitsets, the support is the number of
+ * set bits in the intersection of the bitsets of the items in the set, which must all have one.
+ * @param kernel The kernel that intersects the bitsets, such as the one of the level.
+ * @param set The set to calculate the support of.
+ * @param setSize The number of elements in the set.
+ * @return int Number of transactions the complete set occurs in.
  */
-static void printAssociationRule(int numItemsLeft, int numItemsRight, const int *cols, const TableData *data,
-                                 float confidence) {
-    static char buffer1[BUFFER_LEN];
-    char *curBuffer = buffer1;
-    for (int i = 0; i < numItemsLeft; i++) {
-        curBuffer += sprintf(curBuffer, "%s", data->headers[cols[i]]);
-        if (i != numItemsLeft - 1) {
-            curBuffer += sprintf(curBuffer, ", ");
-        }
+static int calcSupport(const MiningContext *ctx, AndCountKernel kernel, const int *set, int setSize) {
+    if (setSize == 1 && ctx->data->itemSupports) {
+        return ctx->data->itemSupports[set[0]];
     }
-    curBuffer += sprintf(curBuffer, "}");
-    printf("{%-60s => {", buffer1);
-    // Reset and reuse buffer
-    curBuffer = buffer1;
-    for (int i = 0; i < numItemsRight; i++) {
-        curBuffer += sprintf(curBuffer, "%s", data->headers[cols[numItemsLeft + i]]);
-        if (i != numItemsRight - 1) {
-            curBuffer += sprintf(curBuffer, ", ");
+    if (ctx->bitsets) {
+        return bitsetKernelSupport(ctx->bitsets, kernel, set, setSize);
+    }
+    const TableData *data = ctx->data;
+    int support = 0;
+    #pragma omp parallel for reduction(+:support)
+    for (int y = 0; y < data->numRows; y++) {
+        int supported = 1;
+        for (int x = 0; x < setSize; x++) {
+            if (!tableHasItem(data, y, set[x])) {
+                supported = 0;
+                break;
+            }
         }
+        support += supported;
     }
-    curBuffer += sprintf(curBuffer, "}");
-    printf("%-30s%s%.1lf\n", buffer1, "Confidence: ", confidence * 100);
+    return support;
 }
 
 /**
- * @brief Reads data from a CSV into a TableData struct. The CSV file is assumed to have a header. Each row signifies a
- * transaction and each column a product. An entry in this table is either a single character or empty, depending on
- * whether the product occured in the provided transacion.
+ * @brief Performs a prune step on the given level sets. It does this by calculating the support of every item set and
+ * leaving only those that satisfy the given minimum support. The supports of single items are counted in one scan over
+ * the rows, as the bitsets are only built for the items that turn out to be frequent.
  *
- * @param path Path to the CSV file.
- * @return TableData* Table where each row signifies a transaction and each column a product. An entry in this table is
- * either 1 or 0, depending on whether the product occured in the provided transacion.
+ * @param levelSet The level set to prune.
+ * @param ctx Mining context containing the data to count the supports in.
+ * @param minSupportRows The minimum number of rows an item set must occur in for it to be added to the level set.
  */
-static TableData *readCSV(const char *path) {
-    FILE *csvFile = fopen(path, "r");
-    char *headerLine = NULL;
-    size_t headerLength = 0;
-    int numRead = getline(&headerLine, &headerLength, csvFile);
-    if (numRead == -1) {
-        warning("Invalid CSV file. Could not read header of file at path: %s\n", path);
-        return NULL;
+static void prune(LevelSets *levelSet, const MiningContext *ctx, int minSupportRows) {
+    PhaseTimer timer;
+    startPhase(&timer);
+    int *supports = safeMalloc(levelSet->numSets * sizeof(int));
+    if (ctx->shards) {
+        countShardSupports(ctx->shards, levelSet->sets, levelSet->numSets, levelSet->setSize, supports);
+    } else if (levelSet->setSize == 1) {
+        int *itemSupports = safeMalloc(ctx->data->numCols * sizeof(int));
+        countItemSupports(ctx->data, itemSupports);
+        for (int c = 0; c < levelSet->numSets; c++) {
+            supports[c] = itemSupports[levelSet->sets[c][0]];
+        }
+        free(itemSupports);
+    } else {
+        AndCountKernel kernel = andCountKernel(levelSet->setSize);
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int c = 0; c < levelSet->numSets; c++) {
+            // SetSize = k
+            supports[c] = calcSupport(ctx, kernel, levelSet->sets[c], levelSet->setSize);
+        }
     }
-    int numCols = 0;
-    // #pragma omp parallel for
-    for (int i = 0; i < numRead; i++) {
-        if (headerLine[i] == ',' || headerLine[i] == '\n') {
-            numCols++;
+    int setIdx = 0;
+    for (int c = 0; c < levelSet->numSets; c++) {
+        if (supports[c] >= minSupportRows) {
+            itemsetMapPut(ctx->supports, levelSet->sets[c], levelSet->setSize, supports[c]);
+            // Overwrite columns
+            levelSet->sets[setIdx++] = levelSet->sets[c];
         }
     }
-    char **headers = safeMalloc(numCols * sizeof(char *));
+    free(supports);
+    addCandidates(levelSet->setSize, levelSet->numSets, 0, levelSet->numSets - setIdx);
+    levelSet->numSets = setIdx;
+    endPhase(&timer, PHASE_COUNT, levelSet->setSize);
+    printLevelSize(ctx, levelSet->setSize, setIdx);
+}
 
-    int currentCol = 1;
-    headers[0] = headerLine;
-    for (int i = 0; i < numRead; i++) {
-        if (headerLine[i] == ',' || headerLine[i] == '\n') {
-            headerLine[i] = '\0';
-            if (i != numRead - 1) {
-                headers[currentCol++] = &headerLine[i + 1];
-            }
+static inline __attribute__((always_inline)) int subsetsExistBody(const ItemsetMap *supports, const int *set, int n) {
+    // By induction all smaller subsets are frequent once the (n-1)-subsets are. The subsets without the last or the
+    // second-to-last item are the two sets the candidate was joined from, so only the others need to be looked up.
+    if (n < 3) {
+        return 1;
+    }
+    int subset[n];
+    memcpy(subset, set + 1, (n - 1) * sizeof(int));
+    for (int skip = 0; skip < n - 2; skip++) {
+        // The subset without item skip differs from the previous one, without item skip - 1, in a single position
+        if (skip > 0) {
+            subset[skip - 1] = set[skip - 1];
         }
+        if (itemsetMapGet(supports, subset, n - 1) == -1) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int subsetsExist(const ItemsetMap *supports, const int *set, int n) { return subsetsExistBody(supports, set, n); }
+
+/**
+ * @brief Writes the items of an item set in the order of maskOrder. Only for sets of at most MAX_SPECIALIZED_SIZE
+ * items.
+ */
+static inline __attribute__((always_inline)) void expandMaskBody(uint64_t subsetMask, const int *set, int setSize,
+                                                                 int *cols) {
+    const unsigned char *order = maskOrder[subsetMask];
+    for (int i = 0; i < setSize; i++) {
+        cols[i] = set[order[i]];
     }
+}
 
-    long int dataStartPos = ftell(csvFile);
-    int numRows = 0;
-    while (!feof(csvFile)) {
-        if (fgetc(csvFile) == '\n') {
-            numRows++;
+/**
+ * @brief Expands the antecedent mask of an item set of any size bit by bit.
+ */
+static void expandMask(uint64_t subsetMask, const int *set, int setSize, int *cols) {
+    int numLeft = 0;
+    int numRight = __builtin_popcountll(subsetMask);
+    for (int i = 0; i < setSize; i++) {
+        if (subsetMask & 1) {
+            cols[numLeft++] = set[i];
+        } else {
+            cols[numRight++] = set[i];
         }
+        subsetMask >>= 1;
     }
+}
 
-    int **data = allocIntMatrix(numCols, numRows);
+#define DEFINE_LEVEL_KERNELS(size)                                                                  \
+    static int subsetsExist##size(const ItemsetMap *supports, const int *set, int n) {              \
+        (void)n;                                                                                    \
+        return subsetsExistBody(supports, set, size);                                               \
+    }                                                                                               \
+    static void expandMask##size(uint64_t subsetMask, const int *set, int setSize, int *cols) {     \
+        (void)setSize;                                                                              \
+        expandMaskBody(subsetMask, set, size, cols);                                                \
+    }
 
-    fseek(csvFile, dataStartPos, SEEK_SET);
+DEFINE_LEVEL_KERNELS(1)
+DEFINE_LEVEL_KERNELS(2)
+DEFINE_LEVEL_KERNELS(3)
+DEFINE_LEVEL_KERNELS(4)
+DEFINE_LEVEL_KERNELS(5)
+DEFINE_LEVEL_KERNELS(6)
+DEFINE_LEVEL_KERNELS(7)
+DEFINE_LEVEL_KERNELS(8)
 
-    for (int r = 0; r < numRows; r++) {
-        for (int c = 0; c < numCols; c++) {
-            char ch = fgetc(csvFile);
-            if (ch == ',' || ch == '\n') {
-                data[r][c] = 0;
-            } else {
-                data[r][c] = 1;
-                fgetc(csvFile);
-            }
+static const SubsetCheck fixedSubsetChecks[MAX_SPECIALIZED_SIZE + 1] = {
+    subsetsExist,  subsetsExist1, subsetsExist2, subsetsExist3, subsetsExist4,
+    subsetsExist5, subsetsExist6, subsetsExist7, subsetsExist8};
+static const MaskExpansion fixedMaskExpansions[MAX_SPECIALIZED_SIZE + 1] = {
+    expandMask,  expandMask1, expandMask2, expandMask3, expandMask4,
+    expandMask5, expandMask6, expandMask7, expandMask8};
+
+/**
+ * @brief Fills maskOrder when the program starts.
+ */
+__attribute__((constructor)) static void initMaskOrder(void) {
+    for (int mask = 0; mask < 1 << MAX_SPECIALIZED_SIZE; mask++) {
+        int numLeft = 0;
+        int numRight = __builtin_popcount(mask);
+        for (int i = 0; i < MAX_SPECIALIZED_SIZE; i++) {
+            maskOrder[mask][mask >> i & 1 ? numLeft++ : numRight++] = i;
         }
     }
-
-    fclose(csvFile);
-    TableData *csv = malloc(sizeof(TableData));
-    csv->headers = headers;
-    csv->data = data;
-    csv->numRows = numRows;
-    csv->numCols = numCols;
-    return csv;
 }
 
 /**
- * @brief Calculates the support for a given set. Note that it only counts the number of rows/
+ * @brief Selects the kernels for the item sets of a level.
  *
- * @param data Table where each row signifies a transaction and each column a product. An entry in this table is either
- * 1 or 0, depending on whether the product occured in the provided transacion.
- * @param set The set to calculate the support of.
- * @param setSize The number of elements in the set.
- * @return int Number of transactions the complete set occurs in.
+ * @param setSize The size of the item sets of the level.
+ * @return LevelKernels The kernels of the level.
  */
-static int calcSupport(const TableData *data, const int *set, int setSize) {
-    int support = 0;
-    #pragma omp parallel for reduction(+:support)
-    for (int y = 0; y < data->numRows; y++) {
-        int supported = 1;
-        for (int x = 0; x < setSize; x++) {
-            if (data->data[y][set[x]] == 0) {
-                supported = 0;
-                break;
-            }
+static LevelKernels levelKernels(int setSize) {
+    LevelKernels kernels = {andCountKernel(setSize), subsetsExist, expandMask};
+    if (setSize <= MAX_SPECIALIZED_SIZE) {
+        kernels.subsetsExist = fixedSubsetChecks[setSize];
+        kernels.expandMask = fixedMaskExpansions[setSize];
+    }
+    return kernels;
+}
+
+#ifdef USE_TRANSACTION_REDUCTION
+static int compareSets(const void *a, const void *b, void *setSize) {
+    const int *setA = *(int *const *)a;
+    const int *setB = *(int *const *)b;
+    for (int i = 0; i < *(int *)setSize; i++) {
+        if (setA[i] != setB[i]) {
+            return setA[i] < setB[i] ? -1 : 1;
         }
-        support += supported;
     }
-    return support;
+    return 0;
 }
 
 /**
- * @brief Performs a prune step on the given level sets. It does this by calculating the support of every item set and
- * leaving only those that satisfy the given minimum support.
+ * @brief Counts the candidates of a level on a reduced transaction list, and then shrinks the list for the next level
+ * by dropping the items and rows that can not be part of any of its candidates. The candidates are translated to the
+ * dense item ids of the list, which changes their order, so they are counted in id order and their supports are put
+ * back in the order of the level set.
  *
- * @param levelSet The level set to prune.
- * @param data Table where each row signifies a transaction and each column a product. An entry in this table is either
- * 1 or 0, depending on whether the product occured in the provided transacion.
- * @param minSupportRows The minimum number of rows an item set must occur in for it to be added to the level set.
+ * @param levelSet The candidates to count.
+ * @param transactions The reduced transaction list to count in. Shrunk afterwards.
+ * @param supports Output array with an entry per candidate.
  */
-static void prune(LevelSets *levelSet, const TableData *data, int minSupportRows) {
-    int setIdx = 0;
-    for (int c = 0; c < levelSet->numSets; c++) {
-        // SetSize = k
-        int support = calcSupport(data, levelSet->sets[c], levelSet->setSize);
-        if (support >= minSupportRows) {
-            mapPut(setToString(levelSet->sets[c], levelSet->setSize), support);
-            // Overwrite columns
-            levelSet->sets[setIdx++] = levelSet->sets[c];
+static void countReducedCandidates(const LevelSets *levelSet, TransactionList *transactions, int *supports) {
+    int n = levelSet->numSets, k = levelSet->setSize;
+    int *ids = safeMalloc((size_t)n * k * sizeof(int));
+    int **sets = safeMalloc(n * sizeof(int *));
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < n; c++) {
+        sets[c] = ids + (size_t)c * k;
+        for (int i = 0; i < k; i++) {
+            sets[c][i] = transactions->itemIds[levelSet->sets[c][i]];
         }
+        sortInts(sets[c], k);
     }
-    levelSet->numSets = setIdx;
-    printf("Size of large itemsets l(%d) %d\n", levelSet->setSize, setIdx);
+    qsort_r(sets, n, sizeof(int *), compareSets, &k);
+
+    int *idSupports = safeMalloc(n * sizeof(int));
+    int *itemHits = safeMalloc((transactions->rowStart[transactions->numRows] + 1) * sizeof(int));
+    CandidateTrie *trie = createCandidateTrie(sets, n, k);
+    countTrieSupportsAndHits(trie, transactions, idSupports, itemHits);
+    freeCandidateTrie(trie);
+    for (int c = 0; c < n; c++) {
+        supports[(sets[c] - ids) / k] = idSupports[c];
+    }
+
+    // Every item of a candidate of the next level is part of k of its subsets, which are all candidates of this level
+    PhaseTimer timer;
+    startPhase(&timer);
+    reduceTransactionList(transactions, itemHits, k, k + 1);
+    endPhase(&timer, PHASE_INDEX, k);
+    free(itemHits);
+    free(idSupports);
+    free(sets);
+    free(ids);
 }
+#endif
 
-#ifdef USE_ANTI_MONOTONICITY_SUPPORT
-int subsetsExist(const int *set, int n) {
-    int subsetNum = (1 << n) - 1;   // -1 to skip the set itself
-    static int subset[MAX_LEVELS];  // setSize is small enough to allocate on the stack
-    while (subsetNum-- > 0) {
-        int subsetMask = subsetNum;
-        int numLeft = 0;
+/**
+ * @brief Counts the supports of all candidates of a level at once and removes the candidates that do not satisfy the
+ * minimum support. Performs the same pruning as prune, but counts the candidates in a single scan over the transactions
+ * using a prefix trie, in a single pass over the bitset tiles, or sends them to the shard workers of the context to be
+ * counted there.
+ *
+ * @param levelSet The candidates to count and prune. The sets must be sorted.
+ * @param ctx Mining context containing the transactions to count in.
+ * @param minSupportRows The minimum number of rows an item set must occur in for it to be kept.
+ */
+static void countCandidates(LevelSets *levelSet, const MiningContext *ctx, int minSupportRows) {
+    PhaseTimer timer;
+    startPhase(&timer);
+    int *supports = safeMalloc(levelSet->numSets * sizeof(int));
+    if (ctx->shards) {
+        countShardSupports(ctx->shards, levelSet->sets, levelSet->numSets, levelSet->setSize, supports);
+    } else if (ctx->tiles) {
+        countTiledSupports(ctx->tiles, levelSet->sets, levelSet->numSets, levelSet->setSize, supports);
+#ifdef USE_TRANSACTION_REDUCTION
+    } else if (ctx->transactions->itemIds) {
+        countReducedCandidates(levelSet, ctx->transactions, supports);
+#endif
+    } else {
+        CandidateTrie *trie = createCandidateTrie(levelSet->sets, levelSet->numSets, levelSet->setSize);
+        countTrieSupports(trie, ctx->transactions, supports);
+        freeCandidateTrie(trie);
+    }
 
-        for (int i = 0; i < n && subsetMask; i++) {
-            if (subsetMask && subsetMask & 1) {
-                subset[numLeft++] = set[i];
+    // The sets are stored contiguously, so move the surviving sets down instead of only overwriting the row pointers
+    int k = levelSet->setSize;
+    int setIdx = 0;
+    for (int c = 0; c < levelSet->numSets; c++) {
+        if (supports[c] >= minSupportRows) {
+            itemsetMapPut(ctx->supports, levelSet->sets[c], k, supports[c]);
+            if (setIdx != c) {
+                memcpy(levelSet->sets[setIdx], levelSet->sets[c], k * sizeof(int));
             }
-            subsetMask >>= 1;
-        }
-        if (numLeft == 0) {
-            break;
-        }
-        if (mapGet(setToString(subset, numLeft)) == -1) {
-            return 0;
+            setIdx++;
         }
     }
-    return 1;
+    free(supports);
+    addCandidates(k, 0, 0, levelSet->numSets - setIdx);
+    levelSet->numSets = setIdx;
+    endPhase(&timer, PHASE_COUNT, k);
+    printLevelSize(ctx, k, setIdx);
 }
-#endif
 
 /**
  * @brief Performs a self join and prune step. Calculates the level sets at level k.
  *
+ * Two sets of level k-1 can only be joined if they share their first k-2 items, i.e. if they belong to the same prefix
+ * equivalence class. As the sets are sorted, such a class is a consecutive range of sets. Every set is joined with the
+ * sets after it in its class; these units of work are distributed dynamically over the threads. Each thread writes its
+ * candidates to its own buffer, after which the buffers are merged in the order of the first set of every join. The
+ * result is therefore sorted and identical to a serial run, regardless of the number of threads.
+ *
+ * With COUNTING_BITSET every candidate is counted as soon as it is generated. With COUNTING_TRIE or COUNTING_TILED, or
+ * when the context has shard workers, all candidates are collected first and then counted together.
+ *
  * @param levelSetK_1 Level set at level k-1
  * @param k number of the new level. Equal to the index of the new level + 1
- * @param data Table where each row signifies a transaction and each column a product. An entry in this table is either
- * 1 or 0, depending on whether the product occured in the provided transacion.
+ * @param ctx Mining context containing the data to count the supports in.
  * @param minSupportRows The minimum number of rows an item set must occur in for it to be added to the level set.
  * @return LevelSets* Thew newly generated level sets at level k. NULL if no frequent item sets were found.
  */
-static LevelSets *selfJoin(const LevelSets *levelSetK_1, int k, const TableData *data, int minSupportRows) {
+static LevelSets *selfJoin(const LevelSets *levelSetK_1, int k, const MiningContext *ctx, int minSupportRows) {
     int n = levelSetK_1->numSets;
-    int numNewSets = (n * (n + 1)) / 2;
     int **setsAtLevelK_1 = levelSetK_1->sets;
-    int setIdx = 0;
-    int **setsAtLevelK = allocIntMatrix(k, numNewSets);
-    #pragma omp parallel for
-    for (int fs = 0; fs < levelSetK_1->numSets - 1; fs++) {
-        for (int ss = fs + 1; ss < levelSetK_1->numSets; ss++) {
-            for (int k_1 = 0; k_1 < k - 2; k_1++) {
-                if (setsAtLevelK_1[fs][k_1] != setsAtLevelK_1[ss][k_1]) {
-                    // First k-2 elements do not match, so continue with iteration of the outer for loop
-                    // One of the few valid use cases of the goto statement :o
-                    // I feel like a dinosaur though
-                    #pragma omp flush  // Adiciona uma instrução flush após o goto para garantir consistência
-                    goto continue_outer_loop;
+    if (n < 2) {
+        return NULL;
+    }
+
+    // classEnd[fs] is one past the last set that has the same first k-2 items as set fs
+    int *classEnd = safeMalloc(n * sizeof(int));
+    classEnd[n - 1] = n;
+    for (int fs = n - 2; fs >= 0; fs--) {
+        int samePrefix = memcmp(setsAtLevelK_1[fs], setsAtLevelK_1[fs + 1], (k - 2) * sizeof(int)) == 0;
+        classEnd[fs] = samePrefix ? classEnd[fs + 1] : fs + 1;
+    }
+
+    // For every first set: the thread that joined it and the range of its candidates in the buffer of that thread
+    int *segmentThread = safeMalloc(n * sizeof(int));
+    int *segmentStart = safeMalloc(n * sizeof(int));
+    int *segmentCount = safeCalloc(n, sizeof(int));
+    int numThreads = omp_get_max_threads();
+    int countLater = ctx->counting != COUNTING_BITSET || ctx->shards;
+    CandidateBuffer *buffers = safeCalloc(numThreads, sizeof(CandidateBuffer));
+    LevelKernels kernels = levelKernels(k);
+
+    PhaseTimer timer;
+    startPhase(&timer);
+    #pragma omp parallel
+    {
+        int thread = omp_get_thread_num();
+        CandidateBuffer *buffer = &buffers[thread];
+        int candidate[k];
+        long long generated = 0, prunedBySubset = 0, prunedBySupport = 0;
+        double subsetSec = 0, countSec = 0, busyStart = busyClock();
+        #pragma omp for schedule(dynamic) nowait
+        for (int fs = 0; fs < n - 1; fs++) {
+            segmentThread[fs] = thread;
+            segmentStart[fs] = buffer->numSets;
+            memcpy(candidate, setsAtLevelK_1[fs], (k - 1) * sizeof(int));
+            for (int ss = fs + 1; ss < classEnd[fs]; ss++) {
+                // Generate new set
+                candidate[k - 1] = setsAtLevelK_1[ss][k - 2];
+                generated++;
+#ifdef USE_ANTI_MONOTONICITY_SUPPORT
+                double subsetStart = busyClock();
+                int subsetsFrequent = kernels.subsetsExist(ctx->supports, candidate, k);
+                subsetSec += busyClock() - subsetStart;
+                if (!subsetsFrequent) {
+                    prunedBySubset++;
+                    continue;
+                }
+#endif
+                if (countLater) {
+                    appendCandidate(buffer, candidate, k);
+                    continue;
+                }
+                // Immediately prune any invalid generated sets
+                double countStart = busyClock();
+                int support = calcSupport(ctx, kernels.andCount, candidate, k);
+                countSec += busyClock() - countStart;
+                if (support >= minSupportRows) {
+                    itemsetMapPut(ctx->supports, candidate, k, support);
+                    appendCandidate(buffer, candidate, k);
+                } else {
+                    prunedBySupport++;
                 }
             }
-            // Generate new set
-            #pragma omp parallel for
-            for (int i = 0; i < k - 1; i++) {
-                setsAtLevelK[setIdx][i] = setsAtLevelK_1[fs][i];
-            }
-            setsAtLevelK[setIdx][k - 1] = setsAtLevelK_1[ss][k - 2];
-#ifdef USE_ANTI_MONOTONICITY_SUPPORT
-            if (!subsetsExist(setsAtLevelK[setIdx], k)) {
-                continue;
+            segmentCount[fs] = buffer->numSets - segmentStart[fs];
+        }
+        addThreadBusy(PHASE_JOIN, k, busyClock() - busyStart - subsetSec - countSec);
+        addThreadBusy(PHASE_SUBSET_CHECK, k, subsetSec);
+        addThreadBusy(PHASE_COUNT, k, countSec);
+        addCandidates(k, generated, prunedBySubset, prunedBySupport);
+    }
+
+    // Merge the buffers in the order of the first sets
+    int *segmentOffset = classEnd;  // No longer needed, so reuse it
+    int numNewSets = 0;
+    for (int fs = 0; fs < n; fs++) {
+        segmentOffset[fs] = numNewSets;
+        numNewSets += segmentCount[fs];
+    }
+    LevelSets *levelSet = NULL;
+    if (numNewSets > 0) {
+        levelSet = createLevelSets(ctx->arena, numNewSets, k);
+        int **setsAtLevelK = levelSet->sets;
+        #pragma omp parallel for schedule(static)
+        for (int fs = 0; fs < n - 1; fs++) {
+            if (segmentCount[fs] > 0) {
+                const int *src = buffers[segmentThread[fs]].sets + (size_t)segmentStart[fs] * k;
+                memcpy(setsAtLevelK[segmentOffset[fs]], src, (size_t)segmentCount[fs] * k * sizeof(int));
             }
+        }
+    }
+    endPhase(&timer, PHASE_JOIN, k);
+    if (levelSet) {
+        if (countLater) {
+            countCandidates(levelSet, ctx, minSupportRows);
+        } else {
+            printLevelSize(ctx, k, numNewSets);
+        }
+        if (levelSet->numSets == 0) {
+            // The storage is released together with the arena
+            levelSet = NULL;
+        }
+    }
+
+    for (int t = 0; t < numThreads; t++) {
+        free(buffers[t].sets);
+    }
+    free(buffers);
+    free(segmentThread);
+    free(segmentStart);
+    free(segmentCount);
+    free(classEnd);
+    return levelSet;
+}
+
+LevelSets *countPairs(const LevelSets *levelSet1, const MiningContext *ctx, int minSupportRows) {
+    const TableData *data = ctx->data;
+    int m = levelSet1->numSets;
+    if (m < 2) {
+        return NULL;
+    }
+    // Index of every column among the frequent items, -1 for infrequent items
+    int *frequentIdx = safeMalloc(data->numCols * sizeof(int));
+    for (int c = 0; c < data->numCols; c++) {
+        frequentIdx[c] = -1;
+    }
+    for (int i = 0; i < m; i++) {
+        frequentIdx[levelSet1->sets[i][0]] = i;
+    }
+    TransactionList *reduced = NULL;
+    const int *itemIdx = frequentIdx;  // Index among the frequent items of every item of a row
+    int numRows = data->numRows;
+#ifdef USE_TRANSACTION_REDUCTION
+    int *idIdx = NULL;
+    if (ctx->transactions && ctx->transactions->itemIds) {
+        reduced = ctx->transactions;
+        idIdx = safeMalloc((reduced->numItemIds + 1) * sizeof(int));
+        for (int id = 0; id < reduced->numItemIds; id++) {
+            idIdx[id] = frequentIdx[reduced->itemColumns[id]];
+        }
+        itemIdx = idIdx;
+        numRows = reduced->numRows;
+    }
 #endif
+    // The count of pair (i, j) with i < j is stored at rowOffset[i] + j
+    size_t numPairs = (size_t)m * (m - 1) / 2;
+    ptrdiff_t *rowOffset = safeMalloc(m * sizeof(ptrdiff_t));
+    for (int i = 0; i < m; i++) {
+        rowOffset[i] = (ptrdiff_t)i * (2 * m - i - 1) / 2 - i - 1;
+    }
 
-            // Immediately prune any invalid generated sets
-            // If the generated set is invalid, the setIdx is not incremented and it will be overriden in the next
-            // iteration
-            int support = calcSupport(data, setsAtLevelK[setIdx], k);
-            if (support >= minSupportRows) {
-                mapPut(setToString(setsAtLevelK[setIdx], k), support);
-                setIdx++;
+    PhaseTimer timer;
+    startPhase(&timer);
+    int numThreads = omp_get_max_threads();
+    int privateCounts = numThreads > 1 && numPairs * numThreads * sizeof(int) <= TRIANGLE_MEMORY_BUDGET;
+    int numArrays = privateCounts ? numThreads : 1;
+    int **counts = safeMalloc(numArrays * sizeof(int *));
+    for (int t = 0; t < numArrays; t++) {
+        counts[t] = safeCalloc(numPairs, sizeof(int));
+    }
+
+    #pragma omp parallel
+    {
+        int *threadCounts = counts[privateCounts ? omp_get_thread_num() : 0];
+        int *items = safeMalloc(m * sizeof(int));
+        int *rowBuffer = safeMalloc(data->numCols * sizeof(int));
+        double busyStart = busyClock();
+        #pragma omp for schedule(static) nowait
+        for (int y = 0; y < numRows; y++) {
+            int rowSize, weight = 1;
+            const int *row;
+            if (reduced) {
+                row = reduced->items + reduced->rowStart[y];
+                rowSize = reduced->rowStart[y + 1] - reduced->rowStart[y];
+                weight = reduced->weights[y];
+            } else {
+                row = tableRowItems(data, y, rowBuffer, &rowSize);
+            }
+            int numItems = 0;
+            for (int i = 0; i < rowSize; i++) {
+                if (itemIdx[row[i]] >= 0) {
+                    items[numItems++] = itemIdx[row[i]];
+                }
             }
+            if (reduced) {
+                // The ids are ordered on support, while the pairs are indexed in column order
+                sortInts(items, numItems);
+            }
+            for (int a = 0; a < numItems - 1; a++) {
+                int *pairCounts = threadCounts + rowOffset[items[a]];
+                for (int b = a + 1; b < numItems; b++) {
+                    if (privateCounts || numThreads == 1) {
+                        pairCounts[items[b]] += weight;
+                    } else {
+                        #pragma omp atomic
+                        pairCounts[items[b]] += weight;
+                    }
+                }
+            }
+        }
+        addThreadBusy(PHASE_COUNT, 2, busyClock() - busyStart);
+        free(items);
+        free(rowBuffer);
+    }
+    int *pairCounts = counts[0];
+    #pragma omp parallel for schedule(static)
+    for (size_t p = 0; p < numPairs; p++) {
+        for (int t = 1; t < numArrays; t++) {
+            pairCounts[p] += counts[t][p];
         }
-    continue_outer_loop:;
     }
 
-    if (setIdx == 0) {
-        free(setsAtLevelK);
-        return NULL;
+    int numNewSets = 0;
+    for (size_t p = 0; p < numPairs; p++) {
+        numNewSets += pairCounts[p] >= minSupportRows;
     }
-    LevelSets *levelSet = safeMalloc(sizeof(LevelSets));
-    levelSet->sets = setsAtLevelK;
-    levelSet->numSets = setIdx;
-    levelSet->setSize = k;
-    printf("Size of large itemsets l(%d) %d\n", k, setIdx);
+    LevelSets *levelSet = NULL;
+    if (numNewSets > 0) {
+        levelSet = createLevelSets(ctx->arena, numNewSets, 2);
+        int **setsAtLevel2 = levelSet->sets;
+        int setIdx = 0;
+        for (int i = 0; i < m - 1; i++) {
+            for (int j = i + 1; j < m; j++) {
+                int support = pairCounts[rowOffset[i] + j];
+                if (support >= minSupportRows) {
+                    setsAtLevel2[setIdx][0] = levelSet1->sets[i][0];
+                    setsAtLevel2[setIdx][1] = levelSet1->sets[j][0];
+                    itemsetMapPut(ctx->supports, setsAtLevel2[setIdx], 2, support);
+                    setIdx++;
+                }
+            }
+        }
+    }
+    addCandidates(2, numPairs, 0, numPairs - numNewSets);
+    endPhase(&timer, PHASE_COUNT, 2);
+#ifdef USE_TRANSACTION_REDUCTION
+    if (reduced) {
+        // Every pair of frequent items is a candidate, so only the rows that are too short for level 3 can go
+        startPhase(&timer);
+        reduceTransactionList(reduced, NULL, 0, 3);
+        endPhase(&timer, PHASE_INDEX, 2);
+    }
+    free(idIdx);
+#endif
+
+    for (int t = 0; t < numArrays; t++) {
+        free(counts[t]);
+    }
+    free(counts);
+    free(rowOffset);
+    free(frequentIdx);
     return levelSet;
 }
 
+/**
+ * @brief Builds the bitsets of a number of items into the context, unless it already has the bitsets of the table or
+ * USE_VERTICAL_BITSETS is not defined.
+ *
+ * @param ctx The mining context.
+ * @param items The columns to build a bitset for, such as the frequent items.
+ * @param numItems Number of columns in items.
+ */
+static void buildFrequentBitsets(MiningContext *ctx, const int *items, int numItems) {
+#ifdef USE_VERTICAL_BITSETS
+    if (!ctx->bitsets) {
+        ctx->bitsets = createBitsetTable(ctx->data, items, numItems);
+    }
+#else
+    (void)ctx;
+    (void)items;
+    (void)numItems;
+#endif
+}
+
 /**
  * @brief Generates the level sets. Note that the level sets work with column indices instead of column names for
  * performance reasons.
  *
  * @param finalLevel The number of level sets generated will be written to this pointer.
- * @param data Table where each row signifies a transaction and each column a product. An entry in this table is either
- * 1 or 0, depending on whether the product occured in the provided transacion.
+ * @param ctx Mining context containing the data to count the supports in.
  * @param minSupportRows The minimum number of rows an item set must occur in for it to be added to the level set.
  * @return LevelSets** Provides for each of the finalLevel levels a number of sets that satisfy the minimum support
  * criterion. At a given level k, the size of each set is k elements.
  */
-static LevelSets **createFrequentItemSets(int *finalLevel, const TableData *data, int minSupportRows) {
+static LevelSets **createFrequentItemSets(int *finalLevel, MiningContext *ctx, int minSupportRows) {
+    const TableData *data = ctx->data;
     int level = 0;
-    int **setsAtLevel1 = allocIntMatrix(level + 1, data->numCols);
+    LevelSets *set1 = createLevelSets(ctx->arena, data->numCols, level + 1);
     for (int i = 0; i < data->numCols; i++) {
-        setsAtLevel1[i][level] = i;
+        set1->sets[i][level] = i;
     }
-    LevelSets *set1 = safeMalloc(sizeof(LevelSets));
-    set1->sets = setsAtLevel1;
-    set1->numSets = data->numCols;
-    set1->setSize = level + 1;
 
-    prune(set1, data, minSupportRows);
+    prune(set1, ctx, minSupportRows);
+    if (ctx->shards) {
+        keepShardItems(ctx->shards, set1->sets, set1->numSets);
+    } else if (ctx->counting == COUNTING_TRIE) {
+        // Infrequent items can never be part of a candidate, so leave them out of the transactions
+        PhaseTimer timer;
+        startPhase(&timer);
+#ifdef USE_TRANSACTION_REDUCTION
+        int *supports = safeMalloc(data->numCols * sizeof(int));
+        for (int c = 0; c < data->numCols; c++) {
+            supports[c] = -1;
+        }
+        for (int i = 0; i < set1->numSets; i++) {
+            supports[set1->sets[i][0]] = itemsetMapGet(ctx->supports, set1->sets[i], 1);
+        }
+        // Every candidate from level 2 on has at least two items
+        ctx->transactions = createReducedTransactionList(data, supports, 2);
+        free(supports);
+#else
+        int *frequent = safeCalloc(data->numCols, sizeof(int));
+        for (int i = 0; i < set1->numSets; i++) {
+            frequent[set1->sets[i][0]] = 1;
+        }
+        ctx->transactions = createTransactionList(data, frequent);
+        free(frequent);
+#endif
+        endPhase(&timer, PHASE_INDEX, 0);
+    } else {
+        // Only the frequent items can be part of a candidate, so only they get bitsets
+        PhaseTimer timer;
+        startPhase(&timer);
+        int *frequent = safeMalloc((set1->numSets + 1) * sizeof(int));
+        for (int i = 0; i < set1->numSets; i++) {
+            frequent[i] = set1->sets[i][0];
+        }
+        if (ctx->counting == COUNTING_TILED) {
+            ctx->tiles = createBitsetTiles(data, frequent, set1->numSets);
+        } else {
+            buildFrequentBitsets(ctx, frequent, set1->numSets);
+        }
+        free(frequent);
+        endPhase(&timer, PHASE_INDEX, 0);
+    }
 
-    LevelSets **sets = safeMalloc(MAX_LEVELS * sizeof(LevelSets));
+    // A frequent item set holds every frequent item at most once, which bounds the number of levels
+    LevelSets **sets = arenaAlloc(ctx->arena, (set1->numSets + 1) * sizeof(LevelSets *));
     sets[level] = set1;
-    for (int i = 0; i < MAX_LEVELS; i++) {
+    while (1) {
         level++;
+        if (ctx->maxLevel && level >= ctx->maxLevel) {
+            // The sets of this level would have more than maxLevel items
+            break;
+        }
         // The prune step is merged with the selfJoin starting at k=2
-        LevelSets *setK = selfJoin(sets[level - 1], level + 1, data, minSupportRows);
+#ifdef USE_TRIANGULAR_LEVEL2
+        // The shard workers hold the transactions, so the pairs are counted there like any other candidates
+        LevelSets *setK;
+        if (level == 1 && !ctx->shards) {
+            setK = countPairs(sets[0], ctx, minSupportRows);
+            if (setK) {
+                printLevelSize(ctx, 2, setK->numSets);
+            }
+        } else {
+            setK = selfJoin(sets[level - 1], level + 1, ctx, minSupportRows);
+        }
+#else
+        LevelSets *setK = selfJoin(sets[level - 1], level + 1, ctx, minSupportRows);
+#endif
         if (!setK) {
             // No item sets generated
             break;
@@ -475,130 +794,316 @@ static LevelSets **createFrequentItemSets(int *finalLevel, const TableData *data
     return sets;
 }
 
+#ifdef USE_ANTI_MONOTONICITY_CONFIDENCE
 /**
- * @brief Calculates the confidence of an association rule.
+ * @brief Checks whether a rule of an item set can be skipped because a rule with a larger antecedent already failed.
+ * If X => I \ X does not satisfy the minimum confidence, neither does any rule whose antecedent is a subset of X, as
+ * its antecedent has at least the support of X. The masks are visited in descending order, so all supersets of a mask
+ * have been visited before it and it suffices to look at the supersets with one more item.
  *
- * @param set The set containing the full association rules. The first numLeft items are the antecedent, the rest belong
- * to the consequent.
- * @param numLeft Number of items in the antecedent.
- * @param setSupport The support of the entire set. Provided here so that it doesn't need to be recalculated all the
- * time.
- * @return float Confidence. For the rule {A, B} => {C} this will return support(A, B, C) / support(A, B)
+ * @param blocked Flag per antecedent mask of the item set: 1 if the mask or one of its supersets failed.
+ * @param subsetMask The antecedent mask to check. Is flagged in blocked if it can be skipped.
+ * @param setSize The size of the item set.
+ * @return int 1 if the rule can be skipped, 0 otherwise.
  */
-inline static float confidence(const int *set, int numLeft, int setSupport) {
-    return setSupport / (float)mapGet(setToString(set, numLeft));
-}
-
-#ifdef USE_ANTI_MONOTONICITY_CONFIDENCE
-void pruneSubsets(const int *set, int n) {
-    int subsetNum = (1 << n);
-    static int subset[MAX_LEVELS + 1];  // setSize is small enough to allocate on the stack
-
-    while (subsetNum-- > 0) {
-        int subsetMask = subsetNum;
-        int numLeft = 0;
-        for (int i = 0; i < n && subsetMask; i++) {
-            if (subsetMask && subsetMask & 1) {
-                subset[numLeft++] = i;
-            }
-            subsetMask >>= 1;
+static int antecedentBlocked(unsigned char *blocked, uint64_t subsetMask, int setSize) {
+    for (int i = 0; i < setSize; i++) {
+        uint64_t superset = subsetMask | (uint64_t)1 << i;
+        if (superset != subsetMask && blocked[superset]) {
+            blocked[subsetMask] = 1;
+            return 1;
         }
-        mapPut(setToString(subset, numLeft), -1);
     }
+    return 0;
 }
 #endif
 
 /**
- * @brief Checks for all subsets of a given set whether the corresponding association rule satisfies the minimum
- * confidence. If so, it will print the rule.
+ * @brief Looks up the support of a subset of a frequent item set. Only closed or maximal item sets are stored in their
+ * modes, so the support of any other subset is counted in the data.
+ *
+ * @param ctx Mining context containing the data and the supports of the stored item sets.
+ * @param set The subset. Must be sorted.
+ * @param setSize The number of elements in the subset.
+ * @return int Number of transactions the subset occurs in.
+ */
+static int subsetSupport(const MiningContext *ctx, const int *set, int setSize) {
+    int support = itemsetMapGet(ctx->supports, set, setSize);
+    return support >= 0 || ctx->itemSetMode == ITEMSETS_ALL ? support : calcSupport(ctx, andCount, set, setSize);
+}
+
+/**
+ * @brief Checks whether the association rule with the given antecedent satisfies the minimum confidence. If so, it
+ * will print the rule.
  *
+ * @param out The buffer to print the rule to.
  * @param subsetMask  Mask used to determine which elements from the set end up in the antecedent.
- * @param set The set to generate the subsets of.
+ * @param expandMask Splits the set by the mask, for sets of setSize items.
+ * @param set The set to generate the rule of.
  * @param setSize The size of the set.
- * @param data Table where each row signifies a transaction and each column a product. An entry in this table is either
- * 1 or 0, depending on whether the product occured in the provided transacion.
+ * @param ctx Mining context containing the data, the supports of all frequent item sets and the output sink.
  * @param minConfidence The minimum confidence that an association rule must have for it to be sent to the output.
  * @param setSupport The support of the provided set.
+ * @return int 0 if the rule does not satisfy the minimum confidence, 1 otherwise.
  */
-static void checkSubsets(int subsetMask, const int *set, int setSize, const TableData *data, float minConfidence,
-                         int setSupport) {
-#ifdef USE_ANTI_MONOTONICITY_CONFIDENCE
-    if (mapGet(setToString(set, setSize)) == -1) {
-        return;
-    }
-#endif
+static int checkSubsets(OutputBuffer *out, uint64_t subsetMask, MaskExpansion expandMask, const int *set, int setSize,
+                        const MiningContext *ctx, float minConfidence, int setSupport) {
     // Big brain; the number of 1s in the subsetNum indicates the number of items in the antecedent. As such, we can
     // calculate the start position of the consequent.
-    int numRight = __builtin_popcount(subsetMask);
-    if (numRight >= setSize || numRight == 0) {
-        return;
+    int numLeft = __builtin_popcountll(subsetMask);
+    if (numLeft >= setSize || numLeft == 0) {
+        return 1;
     }
-    int numLeft = 0;
-    static int cols[MAX_LEVELS];  // setSize is small enough to allocate on the stack
-    for (int i = 0; i < setSize; i++) {
-        if (subsetMask && subsetMask & 1) {
-            cols[numLeft++] = set[i];
-        } else {
-            cols[numRight++] = set[i];
+    int cols[setSize];
+    expandMask(subsetMask, set, setSize, cols);
+
+    // For the rule {A, B} => {C} the confidence is support(A, B, C) / support(A, B)
+    int leftSupport = subsetSupport(ctx, cols, numLeft);
+    if (setSupport / (float)leftSupport < minConfidence) {
+        return 0;
+    }
+    if (ctx->output->format != OUTPUT_NONE) {
+        // The text format does not show the lift, so the consequent is only looked up for the other formats
+        int rightSupport = ctx->output->format == OUTPUT_TEXT
+                               ? 0
+                               : subsetSupport(ctx, cols + numLeft, setSize - numLeft);
+        appendRule(out, ctx->output, ctx->data, cols, numLeft, setSize - numLeft, setSupport, leftSupport,
+                   rightSupport);
+    }
+    return 1;
+}
+
+/**
+ * @brief Prints all association rules of a single frequent item set that satisfy the minimum confidence.
+ *
+ * @param out The buffer to print the rules to.
+ * @param set The item set.
+ * @param setSize The size of the set. Must be less than MAX_RULE_SET_SIZE.
+ * @param ctx Mining context containing the data, the supports of all frequent item sets and the output sink.
+ * @param minConfidence The minimum confidence that an association rule must have for it to be sent to the output.
+ * @param expandMask Splits the set by an antecedent mask, for sets of setSize items.
+ * @param blocked Pruning state with room for 2^setSize flags. NULL if the set is too large to prune.
+ */
+static void generateSetRules(OutputBuffer *out, const int *set, int setSize, const MiningContext *ctx,
+                             float minConfidence, MaskExpansion expandMask, unsigned char *blocked) {
+    int setSupport = itemsetMapGet(ctx->supports, set, setSize);
+    uint64_t subsetMask = ((uint64_t)1 << setSize) - 1;  // The set itself is not a valid antecedent
+#ifdef USE_ANTI_MONOTONICITY_CONFIDENCE
+    if (blocked) {
+        memset(blocked, 0, (size_t)1 << setSize);
+    }
+#endif
+    while (--subsetMask > 0) {
+#ifdef USE_ANTI_MONOTONICITY_CONFIDENCE
+        if (blocked && antecedentBlocked(blocked, subsetMask, setSize)) {
+            continue;
         }
-        subsetMask >>= 1;
+        if (!checkSubsets(out, subsetMask, expandMask, set, setSize, ctx, minConfidence, setSupport) && blocked) {
+            blocked[subsetMask] = 1;
+        }
+#else
+        checkSubsets(out, subsetMask, expandMask, set, setSize, ctx, minConfidence, setSupport);
+#endif
     }
+}
 
-    float conf = confidence(cols, numLeft, setSupport);
-    if (conf >= minConfidence) {
-        printAssociationRule(numLeft, setSize - numLeft, cols, data, conf);
-    } else {
+void formatLevelRules(const LevelSets *set, const MiningContext *ctx, float minConfidence, OrderedOutput *output) {
+    int setSize = set->setSize;
+    int numSets = set->numSets;
+    if (setSize >= MAX_RULE_SET_SIZE) {
+        warning("Skipping the association rules of item sets with more than 63 items.\n");
+        resetOrderedOutput(output, 0);
+        return;
+    }
+    resetOrderedOutput(output, numSets);
+    MaskExpansion expandMask = levelKernels(setSize).expandMask;
+    PhaseTimer timer;
+    startPhase(&timer);
+    #pragma omp parallel
+    {
+        unsigned char *blocked = NULL;
 #ifdef USE_ANTI_MONOTONICITY_CONFIDENCE
-        // Prune any subsets by the anti-monotonicity rule of the confidence
-        // TODO: only prune sets of size - 1?
-        pruneSubsets(cols, numLeft);
+        if (setSize <= MAX_PRUNED_SET_SIZE) {
+            blocked = safeMalloc((size_t)1 << setSize);
+        }
 #endif
+        double busyStart = busyClock();
+        #pragma omp for schedule(dynamic, 16) nowait
+        for (int i = 0; i < numSets; i++) {
+            OutputBuffer *buffer = beginSegment(output, i);
+            generateSetRules(buffer, set->sets[i], setSize, ctx, minConfidence, expandMask, blocked);
+            endSegment(output, i);
+        }
+        addThreadBusy(PHASE_RULES, setSize, busyClock() - busyStart);
+        free(blocked);
     }
+    endPhase(&timer, PHASE_RULES, setSize);
 }
 
 /**
- * @brief Generates association rules in the form `{A,B,C} => {D} Confidence: 0.6` from the provided level sets and
- * data. The hash table from <search.h> is assumed to contain all supports of the to-be-calculated subsets of the level
- * sets.
+ * @brief Generates association rules in the form `{A,B,C} => {D} Confidence: 0.6` from the provided level sets. The
+ * rules of a level are formatted in parallel and written in the order of the item sets, so the output does not depend
+ * on the number of threads.
  *
  * @param sets The level sets. Provides for each of the n levels a number of sets that satisfy the minimum support
  * criterion. At a given level k, the size of each set is k elements.
  * @param n Number of level sets.
- * @param data Table where each row signifies a transaction and each column a product. An entry in this table is either
- * 1 or 0, depending on whether the product occured in the provided transacion.
+ * @param ctx Mining context containing the column names, the supports of all frequent item sets and the output sink.
  * @param minConfidence The minimum confidence that an association rule must have for it to be sent to the output.
+ * @param output Per-thread buffers to format the rules in.
  */
-static void generateAssociationRules(LevelSets **sets, int n, const TableData *data, float minConfidence) {
-    for (int i = n - 1; i > 0; i--) {
-        LevelSets *set = sets[i];
-        int setSize = set->setSize;
-        int numSets = set->numSets;
-        int initialSubsetNum = (1 << setSize) - 1;  // -1 to prevent the set itself
-        for (int i = 0; i < numSets; i++) {
-            int subsetNum = initialSubsetNum;
-            int setSupport = mapGet(setToString(set->sets[i], setSize));
-#ifdef USE_ANTI_MONOTONICITY_CONFIDENCE
-            if (mapGet(setToString(set->sets[i], setSize)) == -1) {
-                continue;
-            }
-#endif
-            while (subsetNum-- > 0) {
-                checkSubsets(subsetNum, set->sets[i], setSize, data, minConfidence, setSupport);
-            }
+static void generateAssociationRules(LevelSets **sets, int n, const MiningContext *ctx, float minConfidence,
+                                     OrderedOutput *output) {
+    for (int l = n - 1; l > 0; l--) {
+        formatLevelRules(sets[l], ctx, minConfidence, output);
+        PhaseTimer timer;
+        startPhase(&timer);
+        flushOrderedOutput(ctx->output, output);
+        endPhase(&timer, PHASE_OUTPUT, l + 1);
+    }
+}
+
+/**
+ * @brief Writes every frequent item set with its support, level by level, in the format of the output sink of the
+ * context. The item sets of a level are formatted in parallel.
+ *
+ * @param sets The level sets.
+ * @param n Number of level sets.
+ * @param ctx Mining context containing the column names, the supports of all frequent item sets and the output sink.
+ * @param output Per-thread buffers to format the item sets in.
+ */
+static void writeFrequentItemSets(LevelSets **sets, int n, const MiningContext *ctx, OrderedOutput *output) {
+    for (int l = 0; l < n; l++) {
+        const LevelSets *set = sets[l];
+        PhaseTimer timer;
+        startPhase(&timer);
+        resetOrderedOutput(output, set->numSets);
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int i = 0; i < set->numSets; i++) {
+            OutputBuffer *buffer = beginSegment(output, i);
+            int support = itemsetMapGet(ctx->supports, set->sets[i], set->setSize);
+            appendItemSet(buffer, ctx->output, ctx->data, set->sets[i], set->setSize, support);
+            endSegment(output, i);
         }
+        flushOrderedOutput(ctx->output, output);
+        endPhase(&timer, PHASE_OUTPUT, l + 1);
+    }
+}
+
+void writeMiningResults(LevelSets **sets, int n, const MiningContext *ctx, float minConfidence) {
+    for (int l = 0; l < n; l++) {
+        addFrequent(l + 1, sets[l]->numSets);
+    }
+    addMapUsage(itemsetMapSize(ctx->supports), itemsetMapCapacity(ctx->supports));
+    OrderedOutput output;
+    initOrderedOutput(&output);
+    writeOutputHeader(ctx->output, ctx->data);
+    if (ctx->output->format == OUTPUT_TEXT) {
+        fputs("\n", ctx->output->file);
+    } else if (ctx->output->format != OUTPUT_NONE) {
+        writeFrequentItemSets(sets, n, ctx, &output);
+    }
+    generateAssociationRules(sets, n, ctx, minConfidence, &output);
+    freeOrderedOutput(&output);
+    fflush(ctx->output->file);
+}
+
+void initMiningContext(MiningContext *ctx, const TableData *data, CountingMode counting) {
+    ctx->data = data;
+    ctx->bitsets = NULL;
+    ctx->counting = counting;
+    ctx->transactions = NULL;
+    ctx->tiles = NULL;
+    ctx->arena = createArena(ARENA_CHUNK_SIZE);
+    ctx->quiet = 0;
+    ctx->shards = NULL;
+    ctx->output = NULL;
+    ctx->maxLevel = 0;
+    ctx->itemSetMode = ITEMSETS_ALL;
+    // The map grows on its own; the number of products is merely a lower bound on the number of frequent item sets.
+    ctx->supports = createItemsetMap(data->numCols);
+#ifdef USE_VERTICAL_BITSETS
+    ctx->bitsets = data->bitsets;
+#endif
+}
+
+void freeMiningContext(MiningContext *ctx) {
+    if (ctx->bitsets && ctx->bitsets != ctx->data->bitsets) {
+        freeBitsetTable(ctx->bitsets);
+    }
+    if (ctx->transactions) {
+        freeTransactionList(ctx->transactions);
+    }
+    if (ctx->tiles) {
+        freeBitsetTiles(ctx->tiles);
+    }
+    // A mining result may have taken over the supports and the level sets
+    if (ctx->supports) {
+        freeItemsetMap(ctx->supports);
+    }
+    if (ctx->arena) {
+        freeArena(ctx->arena);
     }
 }
 
 /**
- * @brief Performs the apriori algorithms on the data located at the csv Path and prints all the corresponding
- * association rules.
+ * @brief Builds the bitsets of the items that occur in at least minSupportRows rows of the table of a context, for the
+ * closed and maximal search, which tests tids against them. Eclat and FP-Growth mine on tid-lists and on the rows.
  *
- * @param csvPath Table where each row signifies a transaction and each column a product. An entry in this table is
- * either 1 or 0, depending on whether the product occured in the provided transacion.
- * @param minSupport The minimum support a frequent item set must have.
- * @param minConfidence The minimum confidence an association rule must have to be printed.
+ * @param ctx The mining context.
+ * @param minSupportRows The minimum number of rows an item must occur in to get a bitset.
  */
-void apriori(TableData *data, float minSupport, float minConfidence) {
+static void buildEngineBitsets(MiningContext *ctx, int minSupportRows) {
+    const TableData *data = ctx->data;
+    if (ctx->bitsets) {
+        return;
+    }
+    PhaseTimer timer;
+    startPhase(&timer);
+    int *supports = safeMalloc(data->numCols * sizeof(int));
+    countItemSupports(data, supports);
+    int numFrequent = 0;
+    for (int c = 0; c < data->numCols; c++) {
+        if (supports[c] >= minSupportRows) {
+            supports[numFrequent++] = c;
+        }
+    }
+    buildFrequentBitsets(ctx, supports, numFrequent);
+    free(supports);
+    endPhase(&timer, PHASE_INDEX, 0);
+}
+
+LevelSets **mineFrequentItemSets(int *finalLevel, MiningContext *ctx, MiningEngine engine, int minSupportRows) {
+    PhaseTimer timer;
+    startPhase(&timer);
+    if (ctx->itemSetMode != ITEMSETS_ALL) {
+        buildEngineBitsets(ctx, minSupportRows);
+    }
+    LevelSets **sets;
+    if (ctx->itemSetMode != ITEMSETS_ALL) {
+        sets = closedFrequentItemSets(finalLevel, ctx, minSupportRows);
+    } else if (engine == ENGINE_ECLAT) {
+        sets = eclatFrequentItemSets(finalLevel, ctx, minSupportRows);
+    } else if (engine == ENGINE_FPGROWTH) {
+        sets = fpGrowthFrequentItemSets(finalLevel, ctx, minSupportRows);
+    } else {
+        sets = createFrequentItemSets(finalLevel, ctx, minSupportRows);
+    }
+    endPhase(&timer, PHASE_MINE, 0);
+    return sets;
+}
+
+void initMiningOptions(MiningOptions *options) {
+    options->minSupport = DEFAULT_MIN_SUPPORT;
+    options->minConfidence = DEFAULT_MIN_CONFIDENCE;
+    options->engine = ENGINE_APRIORI;
+    options->counting = COUNTING_BITSET;
+    options->numThreads = 0;
+    options->maxLevel = 0;
+    options->itemSetMode = ITEMSETS_ALL;
+}
+
+void apriori(TableData *data, const MiningOptions *options, const OutputSink *output) {
     if (!data) {
         warning("No data preset in the provided data variable.");
         return;
@@ -607,42 +1112,57 @@ void apriori(TableData *data, float minSupport, float minConfidence) {
         warning("No data preset in the provided data variable.");
         return;
     }
-    int n = data->numRows > data->numCols ? data->numRows : data->numCols;
-    int hashTableSize = 1;
-    // Needs to be big enough to contain the hashes of the supports
-    // The next power of 2 larger than the number of transactions/products seems to be a good starting point.
-    while (hashTableSize < n) {
-        hashTableSize <<= 1;
-    }
-    hcreate(hashTableSize);
+    int previousThreads = setMiningThreads(options->numThreads);
+    MiningContext ctx;
+    initMiningContext(&ctx, data, options->counting);
+    ctx.output = output;
+    ctx.maxLevel = options->maxLevel;
+    ctx.itemSetMode = options->itemSetMode;
 
     int numLevels;
-    int minSupportRows = data->numRows * minSupport;
-    LevelSets **sets = createFrequentItemSets(&numLevels, data, minSupportRows);
-    printf("\n");
-    generateAssociationRules(sets, numLevels, data, minConfidence);
+    int minSupportRows = data->numRows * options->minSupport;
+    LevelSets **sets = mineFrequentItemSets(&numLevels, &ctx, options->engine, minSupportRows);
+    writeMiningResults(sets, numLevels, &ctx, options->minConfidence);
 
-    // Clean up
-    for (int i = 0; i < numLevels; i++) {
-        LevelSets *set = sets[i];
-        freeLevelSet(set);
-    }
-    free(sets);
-    hdestroy();
+    freeMiningContext(&ctx);
+    setMiningThreads(previousThreads);
 }
 
-/**
- * @brief Performs the apriori algorithms on the data located at the csv Path and prints all the corresponding
- * association rules.
- *
- * @param csvPath Path to a csv file. The CSV file is assumed to have a header. Each row signifies a
- * transaction and each column a product. An entry in this table is either a single character or empty, depending on
- * whether the product occured in the provided transacion.
- * @param minSupport The minimum support a frequent item set must have.
- * @param minConfidence The minimum confidence an association rule must have to be printed.
- */
-void aprioriCSV(const char *csvPath, float minSupport, float minConfidence) {
+void aprioriCSV(const char *csvPath, const MiningOptions *options, const OutputSink *output) {
     TableData *data = readCSV(csvPath);
-    apriori(data, minSupport, minConfidence);
+    apriori(data, options, output);
     freeCSV(data);
 }
+
+void aprioriBaskets(const char *basketPath, const MiningOptions *options, const OutputSink *output) {
+    TableData *data = readBaskets(basketPath);
+    apriori(data, options, output);
+    freeBaskets(data);
+}
+
+void aprioriSharded(TableData *data, const MiningOptions *options, int numWorkers, const OutputSink *output) {
+    if (!data || data->numRows == 0 || data->numCols == 0) {
+        warning("No data preset in the provided data variable.");
+        return;
+    }
+    int previousThreads = setMiningThreads(options->numThreads);
+    // The workers count on their own copy of the rows, so the coordinator builds no bitsets or transactions
+    MiningContext ctx = {.data = data, .counting = COUNTING_TRIE, .maxLevel = options->maxLevel};
+    ctx.supports = createItemsetMap(data->numCols);
+    ctx.arena = createArena(ARENA_CHUNK_SIZE);
+    ctx.shards = startShardWorkers(data, numWorkers);
+    ctx.output = output;
+
+    int numLevels;
+    int minSupportRows = data->numRows * options->minSupport;
+    PhaseTimer timer;
+    startPhase(&timer);
+    LevelSets **sets = createFrequentItemSets(&numLevels, &ctx, minSupportRows);
+    endPhase(&timer, PHASE_MINE, 0);
+    stopShardWorkers(ctx.shards);
+    ctx.shards = NULL;
+    writeMiningResults(sets, numLevels, &ctx, options->minConfidence);
+
+    freeMiningContext(&ctx);
+    setMiningThreads(previousThreads);
+}
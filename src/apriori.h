@@ -1,26 +1,152 @@
 #ifndef APRIORI_H
 #define APRIORI_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+struct Arena;
+struct ItemsetMap;
+struct OutputSink;
+
 /**
- * @brief Struct that describes a table containing integer data.
+ * @brief Struct that describes a table containing integer data. The table is either stored dense, with a 0 or 1 for
+ * every cell, or sparse, with only the columns of the non-zero cells of every row.
  */
 typedef struct TableData {
     int numRows;  // Excluding header
     int numCols;
     char **headers;
-    int **data;
+    int **data;        // Dense cells. NULL if the table is sparse.
+    size_t *rowStart;  // Sparse rows: the columns of row y are items[rowStart[y]] up to items[rowStart[y + 1]]
+    int *items;        // Columns of every sparse row in ascending order. NULL if the table is dense.
+    struct BitsetTable *bitsets;    // Prebuilt vertical form, e.g. from a dataset cache. NULL if it must be built.
+    struct TidListTable *tidLists;  // Prebuilt item-major form, e.g. from a dataset cache. NULL if not available.
+    const int *itemSupports;        // Support of every column if known up front. NULL otherwise.
 } TableData;
 
 /**
- * @brief Performs the apriori algorithms on the data located at the csv Path and prints all the corresponding
- * association rules.
+ * @brief Strategies for counting the supports of the candidate item sets of a level.
+ */
+typedef enum CountingMode {
+    COUNTING_BITSET,  // Count every candidate separately on the vertical bitsets
+    COUNTING_TRIE,    // Store all candidates of a level in a prefix trie and count them in one scan over the transactions
+    COUNTING_TILED,   // Count all candidates of a level against one cache-sized tile of the bitsets at a time
+} CountingMode;
+
+/**
+ * @brief Algorithms that can be used to mine the frequent item sets.
+ */
+typedef enum MiningEngine {
+    ENGINE_APRIORI,  // Level-wise candidate generation and counting
+    ENGINE_ECLAT,    // Depth-first search over vertical tid-lists and diffsets
+    ENGINE_FPGROWTH, // Pattern growth on a compressed FP-tree, without candidate generation
+} MiningEngine;
+
+/**
+ * @brief Which of the frequent item sets are mined.
+ */
+typedef enum ItemSetMode {
+    ITEMSETS_ALL,      // Every frequent item set
+    ITEMSETS_CLOSED,   // Only the frequent item sets without a superset of the same support
+    ITEMSETS_MAXIMAL,  // Only the frequent item sets without a frequent superset
+} ItemSetMode;
+
+/**
+ * @brief Settings of a mining run.
+ */
+typedef struct MiningOptions {
+    float minSupport;         // The minimum support a frequent item set must have, as a fraction of the rows
+    float minConfidence;      // The minimum confidence an association rule must have
+    MiningEngine engine;      // The algorithm used to mine the frequent item sets
+    CountingMode counting;    // The strategy used to count the supports of candidates. Only used by ENGINE_APRIORI.
+    int numThreads;           // Number of OpenMP threads to mine with. 0 uses the current OpenMP default.
+    int maxLevel;             // Size of the largest item sets to mine. 0 mines item sets of any size.
+    ItemSetMode itemSetMode;  // Which frequent item sets to mine. Only ITEMSETS_ALL can be mined incrementally,
+                              // partitioned or sharded.
+} MiningOptions;
+
+/**
+ * @brief A frequent item set of a mining result.
+ */
+typedef struct FrequentItemSet {
+    const int *items;  // Column indices in ascending order
+    int size;
+    int support;       // Number of rows the set occurs in
+} FrequentItemSet;
+
+/**
+ * @brief An association rule of a mining result.
+ */
+typedef struct AssociationRule {
+    const int *items;  // The antecedent followed by the consequent, as column indices
+    int numLeft;       // Number of items in the antecedent
+    int numRight;      // Number of items in the consequent
+    int support;       // Number of rows the complete set occurs in
+    float confidence;  // support(antecedent and consequent) / support(antecedent)
+    double lift;       // confidence / (support(consequent) / numRows)
+} AssociationRule;
+
+/**
+ * @brief The frequent item sets and association rules of a mining run. Owns all of its memory and does not refer to the
+ * table it was mined from.
+ */
+typedef struct MiningResult {
+    int numRows;                // Number of rows of the table
+    FrequentItemSet *itemSets;  // Level by level, in lexicographic order within a level
+    size_t numItemSets;
+    AssociationRule *rules;     // In the order they are written by apriori
+    size_t numRules;
+    ItemSetMode itemSetMode;      // Which frequent item sets the result holds
+    struct ItemsetMap *supports;  // Support of every item set of the result, see itemSetSupport
+    struct Arena *arena;          // Storage of the items of the item sets and rules
+} MiningResult;
+
+/**
+ * @brief Sets options to their defaults: a minimum support of 0.005, a minimum confidence of 0.6, the apriori engine
+ * with bitset counting, the default number of threads, no maximum level and all frequent item sets.
+ *
+ * @param options The options to initialise.
+ */
+void initMiningOptions(MiningOptions *options);
+
+/**
+ * @brief Mines the frequent item sets and association rules of a table and returns them instead of writing them. Every
+ * call has its own state, so several tables can be mined at once from different threads.
+ *
+ * @param data Table where each row signifies a transaction and each column a product.
+ * @param options Settings of the run. The number of threads applies to the calling thread only.
+ * @return MiningResult* The results. Must be freed with freeMiningResult. NULL if the table is empty.
+ */
+MiningResult *mineAssociationRules(const TableData *data, const MiningOptions *options);
+
+/**
+ * @brief Looks up the support of an item set in a mining result.
+ *
+ * @param result The mining result.
+ * @param items Column indices of the items of the set, in any order.
+ * @param numItems Number of items in the set.
+ * @return int The number of rows the set occurs in, or -1 if the set is not frequent. For a result of closed item
+ * sets, this is the largest support of the closed supersets of the set. A result of maximal item sets only knows the
+ * supports of the maximal sets themselves and returns -1 for their subsets.
+ */
+int itemSetSupport(const MiningResult *result, const int *items, int numItems);
+
+/**
+ * @brief Frees a mining result.
+ *
+ * @param result The result to free.
+ */
+void freeMiningResult(MiningResult *result);
+
+/**
+ * @brief Performs the apriori algorithms on the provided data and prints all the corresponding association rules.
  *
- * @param csvPath Table where each row signifies a transaction and each column a product. An entry in this table is
+ * @param data Table where each row signifies a transaction and each column a product. An entry in this table is
  * either 1 or 0, depending on whether the product occured in the provided transacion.
- * @param minSupport The minimum support a frequent item set must have.
- * @param minConfidence The minimum confidence an association rule must have to be printed.
+ * @param options Settings of the run.
+ * @param output Where to write the frequent item sets and the rules, and in which format.
  */
-void apriori(TableData *data, float minSupport, float minConfidence);
+void apriori(TableData *data, const MiningOptions *options, const struct OutputSink *output);
 
 /**
  * @brief Performs the apriori algorithms on the data located at the csv Path and prints all the corresponding
@@ -29,9 +155,89 @@ void apriori(TableData *data, float minSupport, float minConfidence);
  * @param csvPath Path to a csv file. The CSV file is assumed to have a header. Each row signifies a
  * transaction and each column a product. An entry in this table is either a single character or empty, depending on
  * whether the product occured in the provided transacion.
- * @param minSupport The minimum support a frequent item set must have.
- * @param minConfidence The minimum confidence an association rule must have to be printed.
+ * @param options Settings of the run.
+ * @param output Where to write the frequent item sets and the rules, and in which format.
+ */
+void aprioriCSV(const char *csvPath, const MiningOptions *options, const struct OutputSink *output);
+
+/**
+ * @brief Performs the apriori algorithms on the baskets in the file located at basketPath and prints all the
+ * corresponding association rules. The transactions are kept in a sparse form and never expanded to a dense table.
+ *
+ * @param basketPath Path to a basket file. Every line of the file is a transaction and lists the items it contains,
+ * separated by spaces, tabs or commas, as in the FIMI .dat format. The file has no header.
+ * @param options Settings of the run.
+ * @param output Where to write the frequent item sets and the rules, and in which format.
+ */
+void aprioriBaskets(const char *basketPath, const MiningOptions *options, const struct OutputSink *output);
+
+/**
+ * @brief Performs the apriori algorithms on the data located at the csv Path without loading it into memory at once,
+ * and prints all the corresponding association rules. Uses the SON algorithm: the rows are split into partitions that
+ * fit in the memory budget, every partition is mined on its own at a proportionally scaled minimum support, and final
+ * passes over the partitions count the global supports of the union of the local frequent item sets, in as many
+ * batches as the budget requires. The output is the same as that of aprioriCSV.
+ *
+ * @param csvPath Path to a csv file. The CSV file is assumed to have a header. Each row signifies a transaction and
+ * each column a product.
+ * @param options Settings of the run. The engine is used to mine the partitions.
+ * @param memoryBudget Number of bytes the rows of a partition, the data structures built from them and the candidates
+ * may take. Only exceeded, with a warning, when the local frequent item sets do not fit.
+ * @param output Where to write the frequent item sets and the rules, and in which format.
+ */
+void aprioriCSVPartitioned(const char *csvPath, const MiningOptions *options, size_t memoryBudget,
+                           const struct OutputSink *output);
+
+/**
+ * @brief Performs the apriori algorithms on the data located at the csv Path and prints all the corresponding
+ * association rules, reusing the results of a previous run on the same file. Rows are assumed to only ever be appended
+ * to the file. The frequent item sets of a run and their supports are kept in a state file, together with the number of
+ * rows they were mined from. The next run only reads the rows after these and updates the item sets following the FUP
+ * algorithm: the old rows are only read again to count item sets that were not frequent before but may have become
+ * frequent through the new rows. Without a usable state file, all rows are mined. The output is the same as that of
+ * aprioriCSV.
+ *
+ * @param csvPath Path to a csv file. The CSV file is assumed to have a header. Each row signifies a transaction and
+ * each column a product.
+ * @param statePath Path to the state file. It is read if it exists and belongs to the csv file, and is then replaced
+ * by the state after this run.
+ * @param options Settings of the run. The engine is only used if all rows are mined.
+ * @param output Where to write the frequent item sets and the rules, and in which format.
+ */
+void aprioriCSVIncremental(const char *csvPath, const char *statePath, const MiningOptions *options,
+                           const struct OutputSink *output);
+
+/**
+ * @brief Performs the apriori algorithms on the provided data with the support counting spread over worker processes,
+ * and prints all the corresponding association rules. The rows are split into a shard per worker. This process acts as
+ * the coordinator: it generates the candidates of every level, broadcasts them to the workers and sums the counts they
+ * send back. The output is the same as that of apriori with ENGINE_APRIORI.
+ *
+ * @param data Table where each row signifies a transaction and each column a product.
+ * @param options Settings of the run. The engine and counting mode are ignored.
+ * @param numWorkers Number of local worker processes to fork.
+ * @param output Where to write the frequent item sets and the rules, and in which format.
+ */
+void aprioriSharded(TableData *data, const MiningOptions *options, int numWorkers, const struct OutputSink *output);
+
+/**
+ * @brief Performs the apriori algorithms on a random sample of the rows of the provided data, and prints all the
+ * corresponding association rules with their exact supports. Follows Toivonen's sampling algorithm: the sample is mined
+ * with the provided engine at a minimum support that is lowered by the Hoeffding bound of the miss probability, and a
+ * single pass over all rows then counts the exact supports of the item sets that are frequent in the sample and of
+ * their negative border, the sets that are not frequent in the sample while all of their subsets are. Every reported
+ * item set is frequent in the complete data. A frequent set of the negative border shows that larger frequent item sets
+ * may be missing, which is reported with a warning.
+ *
+ * @param data Table where each row signifies a transaction and each column a product.
+ * @param options Settings of the run. The engine is used to mine the sample.
+ * @param sampleRows Number of rows to sample. All rows are used if the table has fewer.
+ * @param seed Seed of the random number generator that selects the rows.
+ * @param missProbability The chance that a single frequent item set is not frequent in the sample, between 0 and 1.
+ * Smaller values lower the minimum support of the sample further, at the cost of more candidates.
+ * @param output Where to write the frequent item sets and the rules, and in which format.
  */
-void aprioriCSV(const char *csvPath, float minSupport, float minConfidence);
+void aprioriSampled(TableData *data, const MiningOptions *options, int sampleRows, uint64_t seed,
+                    double missProbability, const struct OutputSink *output);
 
 #endif  // APRIORI_H
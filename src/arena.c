@@ -0,0 +1,65 @@
+#include "arena.h"
+
+#include <stdlib.h>
+
+#include "utils.h"
+
+#define ARENA_ALIGNMENT 16
+
+typedef struct Chunk {
+    struct Chunk *next;
+    size_t used;
+    size_t capacity;
+    _Alignas(ARENA_ALIGNMENT) unsigned char memory[];
+} Chunk;
+
+struct Arena {
+    Chunk *chunks;  // Most recent chunk first
+    size_t chunkSize;
+    size_t reserved;
+};
+
+Arena *createArena(size_t chunkSize) {
+    Arena *arena = safeMalloc(sizeof(Arena));
+    arena->chunks = NULL;
+    arena->chunkSize = chunkSize;
+    arena->reserved = 0;
+    return arena;
+}
+
+void *arenaAlloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    Chunk *chunk = arena->chunks;
+    if (!chunk || chunk->used + size > chunk->capacity) {
+        size_t capacity = size > arena->chunkSize ? size : arena->chunkSize;
+        chunk = safeMalloc(sizeof(Chunk) + capacity);  // malloc aligns to at least ARENA_ALIGNMENT bytes
+        chunk->used = 0;
+        chunk->capacity = capacity;
+        if (arena->chunks && size > arena->chunkSize) {
+            // Keep bumping in the current chunk; the oversized chunk is only used for this allocation
+            chunk->used = capacity;
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+            arena->reserved += capacity;
+            return chunk->memory;
+        }
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->reserved += capacity;
+    }
+    void *p = chunk->memory + chunk->used;
+    chunk->used += size;
+    return p;
+}
+
+size_t arenaReserved(const Arena *arena) { return arena->reserved; }
+
+void freeArena(Arena *arena) {
+    Chunk *chunk = arena->chunks;
+    while (chunk) {
+        Chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena);
+}
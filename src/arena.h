@@ -0,0 +1,41 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * @brief Bump allocator. Memory is handed out from large chunks and can only be released all at once, by freeing the
+ * arena. Not thread-safe: allocations must be made from a single thread at a time.
+ */
+typedef struct Arena Arena;
+
+/**
+ * @brief Creates an empty arena.
+ *
+ * @param chunkSize Size of the chunks the arena allocates in bytes. Larger allocations get a chunk of their own.
+ * @return Arena* The arena. Must be freed with freeArena.
+ */
+Arena *createArena(size_t chunkSize);
+
+/**
+ * @brief Allocates memory from an arena. The memory is aligned to 16 bytes and is valid until the arena is freed.
+ *
+ * @param arena The arena to allocate from.
+ * @param size Number of bytes to allocate.
+ * @return void* Pointer to the allocated memory.
+ */
+void *arenaAlloc(Arena *arena, size_t size);
+
+/**
+ * @brief Returns the total number of bytes the arena has reserved from the system.
+ */
+size_t arenaReserved(const Arena *arena);
+
+/**
+ * @brief Frees an arena and all memory allocated from it.
+ *
+ * @param arena The arena to free.
+ */
+void freeArena(Arena *arena);
+
+#endif  // ARENA_H
@@ -0,0 +1,306 @@
+#include "baskets.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mappedfile.h"
+#include "utils.h"
+
+#define INITIAL_DICTIONARY_CAPACITY 1024  // Number of slots of an empty dictionary. Must be a power of two.
+#define INITIAL_CHUNK_CAPACITY 1024
+
+/**
+ * @brief Open addressing hash table that numbers the item names in the order in which they are added. The names are
+ * not copied; they point into the mapped file.
+ */
+typedef struct Dictionary {
+    const char **names;  // Name of every id
+    int *lengths;        // Length of the name of every id
+    uint64_t *hashes;    // Hash of the name of every id, kept for rehashing
+    int *slots;          // Id stored in every slot, -1 for empty slots
+    int numNames;
+    size_t capacity;  // Number of slots. Always at least twice the number of names.
+} Dictionary;
+
+/**
+ * @brief The transactions of a single chunk of the file. The items are ids in the dictionary of the chunk.
+ */
+typedef struct BasketChunk {
+    Dictionary dict;
+    int *rowSizes;
+    int numRows;
+    int rowCapacity;
+    int *items;
+    size_t numItems;
+    size_t itemCapacity;
+} BasketChunk;
+
+/**
+ * @brief Hashes an item name with FNV-1a.
+ */
+static uint64_t hashName(const char *name, int length) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void initDictionary(Dictionary *dict) {
+    dict->capacity = INITIAL_DICTIONARY_CAPACITY;
+    dict->numNames = 0;
+    dict->names = safeMalloc(dict->capacity / 2 * sizeof(char *));
+    dict->lengths = safeMalloc(dict->capacity / 2 * sizeof(int));
+    dict->hashes = safeMalloc(dict->capacity / 2 * sizeof(uint64_t));
+    dict->slots = safeMalloc(dict->capacity * sizeof(int));
+    memset(dict->slots, -1, dict->capacity * sizeof(int));
+}
+
+static void freeDictionary(Dictionary *dict) {
+    free(dict->names);
+    free(dict->lengths);
+    free(dict->hashes);
+    free(dict->slots);
+}
+
+/**
+ * @brief Doubles the number of slots of a dictionary and reinserts all ids.
+ */
+static void growDictionary(Dictionary *dict) {
+    dict->capacity *= 2;
+    dict->names = realloc(dict->names, dict->capacity / 2 * sizeof(char *));
+    dict->lengths = realloc(dict->lengths, dict->capacity / 2 * sizeof(int));
+    dict->hashes = realloc(dict->hashes, dict->capacity / 2 * sizeof(uint64_t));
+    free(dict->slots);
+    dict->slots = safeMalloc(dict->capacity * sizeof(int));
+    if (!dict->names || !dict->lengths || !dict->hashes) {
+        fatalError("Could not grow the item dictionary to %zu slots.\n", dict->capacity);
+    }
+    memset(dict->slots, -1, dict->capacity * sizeof(int));
+    size_t mask = dict->capacity - 1;
+    for (int id = 0; id < dict->numNames; id++) {
+        size_t slot = dict->hashes[id] & mask;
+        while (dict->slots[slot] != -1) {
+            slot = (slot + 1) & mask;
+        }
+        dict->slots[slot] = id;
+    }
+}
+
+/**
+ * @brief Looks up the id of an item name, adding the name to the dictionary if it is not yet present.
+ *
+ * @param dict The dictionary.
+ * @param name The item name. Does not need to be null-terminated.
+ * @param length Length of the name.
+ * @param hash Hash of the name, as calculated by hashName.
+ * @return int The id of the name.
+ */
+static int dictionaryId(Dictionary *dict, const char *name, int length, uint64_t hash) {
+    size_t mask = dict->capacity - 1;
+    size_t slot = hash & mask;
+    int id;
+    while ((id = dict->slots[slot]) != -1) {
+        if (dict->hashes[id] == hash && dict->lengths[id] == length && memcmp(dict->names[id], name, length) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (dict->numNames == INT_MAX) {
+        fatalError("More than %d distinct items.\n", INT_MAX);
+    }
+    id = dict->numNames++;
+    dict->names[id] = name;
+    dict->lengths[id] = length;
+    dict->hashes[id] = hash;
+    dict->slots[slot] = id;
+    if ((size_t)dict->numNames * 2 >= dict->capacity) {
+        growDictionary(dict);
+    }
+    return id;
+}
+
+static inline int isSeparator(char c) { return c == ' ' || c == '\t' || c == ','; }
+
+/**
+ * @brief Parses the non-empty lines of a chunk into transactions of item ids local to the chunk. The items of every
+ * transaction are sorted and free of duplicates.
+ *
+ * @param start Start of the chunk. Must be the start of a line.
+ * @param end End of the chunk.
+ * @param chunk The chunk to fill. Must be zero-initialised.
+ */
+static void parseChunk(const char *start, const char *end, BasketChunk *chunk) {
+    initDictionary(&chunk->dict);
+    chunk->rowCapacity = INITIAL_CHUNK_CAPACITY;
+    chunk->rowSizes = safeMalloc(chunk->rowCapacity * sizeof(int));
+    chunk->itemCapacity = INITIAL_CHUNK_CAPACITY;
+    chunk->items = safeMalloc(chunk->itemCapacity * sizeof(int));
+
+    const char *next;
+    for (const char *line = start; line < end; line = next) {
+        const char *lineEnd = findLineEnd(line, end, &next);
+        size_t rowStart = chunk->numItems;
+        const char *p = line;
+        while (p < lineEnd) {
+            while (p < lineEnd && isSeparator(*p)) {
+                p++;
+            }
+            const char *name = p;
+            while (p < lineEnd && !isSeparator(*p)) {
+                p++;
+            }
+            if (p == name) {
+                break;
+            }
+            if (chunk->numItems == chunk->itemCapacity) {
+                chunk->itemCapacity *= 2;
+                chunk->items = realloc(chunk->items, chunk->itemCapacity * sizeof(int));
+                if (!chunk->items) {
+                    fatalError("Could not grow the item buffer to %zu items.\n", chunk->itemCapacity);
+                }
+            }
+            int length = p - name;
+            chunk->items[chunk->numItems++] = dictionaryId(&chunk->dict, name, length, hashName(name, length));
+        }
+        if (chunk->numItems == rowStart) {
+            continue;
+        }
+
+        // Sort and remove duplicates
+        int *row = chunk->items + rowStart;
+        int rowSize = chunk->numItems - rowStart;
+        sortInts(row, rowSize);
+        int numUnique = 1;
+        for (int i = 1; i < rowSize; i++) {
+            if (row[i] != row[numUnique - 1]) {
+                row[numUnique++] = row[i];
+            }
+        }
+        chunk->numItems = rowStart + numUnique;
+        if (chunk->numRows == chunk->rowCapacity) {
+            chunk->rowCapacity *= 2;
+            chunk->rowSizes = realloc(chunk->rowSizes, chunk->rowCapacity * sizeof(int));
+            if (!chunk->rowSizes) {
+                fatalError("Could not grow the row buffer to %d rows.\n", chunk->rowCapacity);
+            }
+        }
+        chunk->rowSizes[chunk->numRows++] = numUnique;
+    }
+}
+
+TableData *readBaskets(const char *path) {
+    MappedFile file;
+    if (!mapFile(path, &file)) {
+        return NULL;
+    }
+    const char **chunkStart;
+    int numChunks = splitLines(file.start, file.end, &chunkStart);
+
+    // First pass: parse every chunk with its own dictionary
+    BasketChunk *chunks = safeCalloc(numChunks, sizeof(BasketChunk));
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < numChunks; i++) {
+        parseChunk(chunkStart[i], chunkStart[i + 1], &chunks[i]);
+    }
+
+    // Merge the dictionaries in file order, so that the columns are numbered by first appearance
+    Dictionary dict;
+    initDictionary(&dict);
+    int **localToGlobal = safeMalloc(numChunks * sizeof(int *));
+    size_t *chunkRow = safeMalloc((numChunks + 1) * sizeof(size_t));
+    size_t *chunkItem = safeMalloc((numChunks + 1) * sizeof(size_t));
+    chunkRow[0] = 0;
+    chunkItem[0] = 0;
+    for (int i = 0; i < numChunks; i++) {
+        const Dictionary *local = &chunks[i].dict;
+        localToGlobal[i] = safeMalloc((local->numNames > 0 ? local->numNames : 1) * sizeof(int));
+        for (int id = 0; id < local->numNames; id++) {
+            localToGlobal[i][id] = dictionaryId(&dict, local->names[id], local->lengths[id], local->hashes[id]);
+        }
+        chunkRow[i + 1] = chunkRow[i] + chunks[i].numRows;
+        chunkItem[i + 1] = chunkItem[i] + chunks[i].numItems;
+    }
+    if (chunkRow[numChunks] > INT_MAX) {
+        fatalError("The basket file at path %s has more than %d transactions.\n", path, INT_MAX);
+    }
+    int numRows = chunkRow[numChunks];
+    size_t numItems = chunkItem[numChunks];
+
+    // Second pass: translate the items of every chunk to the global columns
+    size_t *rowStart = safeMalloc(((size_t)numRows + 1) * sizeof(size_t));
+    int *items = safeMalloc((numItems + 1) * sizeof(int));
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < numChunks; i++) {
+        const BasketChunk *chunk = &chunks[i];
+        size_t offset = chunkItem[i];
+        const int *localItems = chunk->items;
+        for (int r = 0; r < chunk->numRows; r++) {
+            int rowSize = chunk->rowSizes[r];
+            int *row = items + offset;
+            rowStart[chunkRow[i] + r] = offset;
+            for (int j = 0; j < rowSize; j++) {
+                row[j] = localToGlobal[i][localItems[j]];
+            }
+            sortInts(row, rowSize);
+            localItems += rowSize;
+            offset += rowSize;
+        }
+    }
+    rowStart[numRows] = numItems;
+
+    // The names still point into the mapped file, so copy them before unmapping it
+    int numCols = dict.numNames;
+    size_t namesLength = 0;
+    for (int c = 0; c < numCols; c++) {
+        namesLength += dict.lengths[c] + 1;
+    }
+    char *names = safeMalloc(namesLength > 0 ? namesLength : 1);
+    char **headers = safeMalloc((numCols > 0 ? numCols : 1) * sizeof(char *));
+    headers[0] = names;  // Also when there are no columns, so that the buffer is freed
+    for (int c = 0; c < numCols; c++) {
+        headers[c] = names;
+        memcpy(names, dict.names[c], dict.lengths[c]);
+        names[dict.lengths[c]] = '\0';
+        names += dict.lengths[c] + 1;
+    }
+
+    for (int i = 0; i < numChunks; i++) {
+        freeDictionary(&chunks[i].dict);
+        free(chunks[i].rowSizes);
+        free(chunks[i].items);
+        free(localToGlobal[i]);
+    }
+    freeDictionary(&dict);
+    free(localToGlobal);
+    free(chunks);
+    free(chunkRow);
+    free(chunkItem);
+    free(chunkStart);
+    unmapFile(&file);
+
+    TableData *baskets = safeMalloc(sizeof(TableData));
+    baskets->headers = headers;
+    baskets->data = NULL;
+    baskets->numRows = numRows;
+    baskets->numCols = numCols;
+    baskets->rowStart = rowStart;
+    baskets->items = items;
+    baskets->bitsets = NULL;
+    baskets->tidLists = NULL;
+    baskets->itemSupports = NULL;
+    return baskets;
+}
+
+void freeBaskets(TableData *data) {
+    if (!data) {
+        return;
+    }
+    free(data->headers[0]);
+    free(data->headers);
+    free(data->rowStart);
+    free(data->items);
+    free(data);
+}
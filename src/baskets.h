@@ -0,0 +1,28 @@
+#ifndef BASKETS_H
+#define BASKETS_H
+
+#include "apriori.h"
+
+/**
+ * @brief Reads a file of baskets into a sparse TableData struct. Every non-empty line is a transaction and lists the
+ * items it contains, separated by spaces, tabs or commas. This covers the FIMI .dat format, where the items are
+ * integers, as well as lines of item names. There is no header; every distinct item becomes a column, numbered in the
+ * order in which the items first appear in the file. An item that occurs more than once on a line is counted once.
+ *
+ * The file is memory-mapped and split into chunks that start at a line boundary. Every chunk is parsed in parallel
+ * with its own item dictionary, after which the dictionaries are merged in file order.
+ *
+ * @param path Path to the basket file.
+ * @return TableData* Sparse table with a column for every item. NULL if the file could not be read. Must be freed with
+ * freeBaskets.
+ */
+TableData *readBaskets(const char *path);
+
+/**
+ * @brief Frees the memory used by a table that was read with readBaskets.
+ *
+ * @param data The TableData to free.
+ */
+void freeBaskets(TableData *data);
+
+#endif  // BASKETS_H
@@ -0,0 +1,204 @@
+#include "bitset.h"
+
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "kernels.h"
+#include "metrics.h"
+#include "table.h"
+#include "utils.h"
+
+#define WORDS_PER_LINE (BITSET_ALIGNMENT / sizeof(uint64_t))
+
+BitsetTable *createBitsetTable(const TableData *data, const int *items, int numItems) {
+    BitsetTable *table = safeMalloc(sizeof(BitsetTable));
+    table->numItems = items ? numItems : data->numCols;
+    table->numRows = data->numRows;
+    table->itemIdx = items ? createItemIndex(data->numCols, items, numItems) : NULL;
+    size_t numWords = ((size_t)data->numRows + 63) / 64;
+    table->numWords = (numWords + WORDS_PER_LINE - 1) / WORDS_PER_LINE * WORDS_PER_LINE;
+    size_t tableWords = (size_t)table->numItems * table->numWords + 1;
+    table->words = safeAlignedCalloc(BITSET_ALIGNMENT, tableWords * sizeof(uint64_t));
+
+    // Every thread fills complete words, so no two threads ever write to the same word.
+    const int *itemIdx = table->itemIdx;
+    #pragma omp parallel
+    {
+        int *rowBuffer = safeMalloc(data->numCols * sizeof(int));
+        #pragma omp for schedule(static)
+        for (size_t w = 0; w < numWords; w++) {
+            int rowStart = w * 64;
+            int rowEnd = rowStart + 64 < data->numRows ? rowStart + 64 : data->numRows;
+            for (int y = rowStart; y < rowEnd; y++) {
+                int numItems;
+                const int *row = tableRowItems(data, y, rowBuffer, &numItems);
+                uint64_t bit = (uint64_t)1 << (y - rowStart);
+                for (int i = 0; i < numItems; i++) {
+                    int idx = itemIdx ? itemIdx[row[i]] : row[i];
+                    if (idx >= 0) {
+                        table->words[(size_t)idx * table->numWords + w] |= bit;
+                    }
+                }
+            }
+        }
+        free(rowBuffer);
+    }
+    return table;
+}
+
+void freeBitsetTable(BitsetTable *table) {
+    free(table->itemIdx);
+    free(table->words);
+    free(table);
+}
+
+int bitsetSupport(const BitsetTable *table, const int *set, int setSize) {
+    return bitsetKernelSupport(table, andCount, set, setSize);
+}
+
+int bitsetKernelSupport(const BitsetTable *table, AndCountKernel kernel, const int *set, int setSize) {
+    const uint64_t *vectors[setSize];
+    for (int i = 0; i < setSize; i++) {
+        vectors[i] = itemBitset(table, set[i]);
+    }
+    return kernel(vectors, setSize, table->numWords);
+}
+
+BitsetTiles *createBitsetTiles(const TableData *data, const int *items, int numItems) {
+    BitsetTiles *tiles = safeMalloc(sizeof(BitsetTiles));
+    tiles->numItems = numItems;
+    tiles->itemIdx = createItemIndex(data->numCols, items, numItems);
+
+    // A tile takes half of the L2 cache, which leaves room for the intersections of the prefixes and the counts
+    size_t numWords = ((size_t)data->numRows + 63) / 64;
+    long cacheBytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    size_t tileBytes = cacheBytes > 0 ? (size_t)cacheBytes / 2 : BITSET_TILE_BYTES;
+    size_t tileWords = tileBytes / sizeof(uint64_t) / (numItems > 0 ? numItems : 1) / WORDS_PER_LINE * WORDS_PER_LINE;
+    tileWords = tileWords < WORDS_PER_LINE ? WORDS_PER_LINE : tileWords;
+    size_t paddedWords = (numWords + WORDS_PER_LINE - 1) / WORDS_PER_LINE * WORDS_PER_LINE;
+    tileWords = tileWords > paddedWords && paddedWords > 0 ? paddedWords : tileWords;
+    tiles->tileWords = tileWords;
+    tiles->numTiles = (numWords + tileWords - 1) / tileWords;
+    tiles->words = safeAlignedMalloc(BITSET_ALIGNMENT, (tiles->numTiles * numItems + 1) * tileWords * sizeof(uint64_t));
+
+    // Written with the same static schedule as countTiledSupports reads them, so every page is first touched, and thus
+    // placed, by the thread that counts on it
+    #pragma omp parallel
+    {
+        int *rowBuffer = safeMalloc(data->numCols * sizeof(int));
+        #pragma omp for schedule(static)
+        for (size_t t = 0; t < tiles->numTiles; t++) {
+            uint64_t *tile = tiles->words + t * numItems * tileWords;
+            memset(tile, 0, numItems * tileWords * sizeof(uint64_t));
+            size_t rowStart = t * tileWords * 64;
+            size_t rowEnd = rowStart + tileWords * 64 < (size_t)data->numRows ? rowStart + tileWords * 64
+                                                                               : (size_t)data->numRows;
+            for (size_t y = rowStart; y < rowEnd; y++) {
+                int rowSize;
+                const int *row = tableRowItems(data, y, rowBuffer, &rowSize);
+                size_t offset = y - rowStart;
+                uint64_t bit = (uint64_t)1 << (offset % 64);
+                for (int i = 0; i < rowSize; i++) {
+                    int idx = tiles->itemIdx[row[i]];
+                    if (idx >= 0) {
+                        tile[idx * tileWords + offset / 64] |= bit;
+                    }
+                }
+            }
+        }
+        free(rowBuffer);
+    }
+    return tiles;
+}
+
+void freeBitsetTiles(BitsetTiles *tiles) {
+    free(tiles->itemIdx);
+    free(tiles->words);
+    free(tiles);
+}
+
+/**
+ * @brief Counts a range of candidates against a single tile.
+ *
+ * @param tiles The tiles.
+ * @param tile Index of the tile.
+ * @param sets The candidate sets. Must be sorted lexicographically.
+ * @param numSets Number of candidate sets.
+ * @param setSize Number of elements in every set.
+ * @param kernel Kernel that intersects the bitsets of a set of at most 2 items, or of the prefix and the last item.
+ * @param prefix Buffer of tiles->tileWords words for the intersection of all but the last item of a candidate.
+ * @param counts The count of every candidate is incremented by its support in the tile.
+ */
+static void countTile(const BitsetTiles *tiles, size_t tile, int **sets, int numSets, int setSize,
+                      AndCountKernel kernel, uint64_t *prefix, int *counts) {
+    size_t tileWords = tiles->tileWords;
+    const uint64_t *words = tiles->words + tile * tiles->numItems * tileWords;
+    const uint64_t *vectors[setSize];
+    for (int c = 0; c < numSets; c++) {
+        const int *set = sets[c];
+        for (int i = 0; i < setSize; i++) {
+            vectors[i] = words + (size_t)tiles->itemIdx[set[i]] * tileWords;
+        }
+        if (setSize <= 2) {
+            counts[c] += kernel(vectors, setSize, tileWords);
+            continue;
+        }
+        // Consecutive candidates usually come from the same join and share all but their last item
+        if (c == 0 || memcmp(set, sets[c - 1], (setSize - 1) * sizeof(int)) != 0) {
+            for (size_t w = 0; w < tileWords; w++) {
+                prefix[w] = vectors[0][w] & vectors[1][w];
+            }
+            for (int i = 2; i < setSize - 1; i++) {
+                for (size_t w = 0; w < tileWords; w++) {
+                    prefix[w] &= vectors[i][w];
+                }
+            }
+        }
+        const uint64_t *pair[2] = {prefix, vectors[setSize - 1]};
+        counts[c] += kernel(pair, 2, tileWords);
+    }
+}
+
+void countTiledSupports(const BitsetTiles *tiles, int **sets, int numSets, int setSize, int *supports) {
+    int numThreads = omp_get_max_threads();
+    AndCountKernel kernel = andCountKernel(setSize <= 2 ? setSize : 2);
+    size_t numTiles = tiles->numTiles;
+    size_t numChunks = numTiles >= (size_t)numThreads || numTiles == 0 ? 1 : (numThreads + numTiles - 1) / numTiles;
+    size_t batchSize = TILE_COUNT_BUDGET / sizeof(int) / numThreads;
+    batchSize = batchSize > 0 ? batchSize : 1;
+    memset(supports, 0, numSets * sizeof(int));
+    int **counts = safeCalloc(numThreads, sizeof(int *));
+    for (int batch = 0; batch < numSets; batch += batchSize) {
+        int batchSets = (size_t)(numSets - batch) < batchSize ? numSets - batch : (int)batchSize;
+        #pragma omp parallel
+        {
+            int thread = omp_get_thread_num();
+            counts[thread] = safeCalloc(batchSets, sizeof(int));
+            uint64_t *prefix = safeAlignedMalloc(BITSET_ALIGNMENT, tiles->tileWords * sizeof(uint64_t));
+            double busyStart = busyClock();
+            // Unit u covers a chunk of the candidates on tile u / numChunks
+            #pragma omp for schedule(static) nowait
+            for (size_t unit = 0; unit < numTiles * numChunks; unit++) {
+                size_t chunk = unit % numChunks;
+                int from = batchSets * chunk / numChunks;
+                int to = batchSets * (chunk + 1) / numChunks;
+                countTile(tiles, unit / numChunks, sets + batch + from, to - from, setSize, kernel, prefix,
+                          counts[thread] + from);
+            }
+            addThreadBusy(PHASE_COUNT, setSize, busyClock() - busyStart);
+            free(prefix);
+            // All counts must be complete before they are summed
+            #pragma omp barrier
+            #pragma omp for schedule(static)
+            for (int c = 0; c < batchSets; c++) {
+                for (int t = 0; t < omp_get_num_threads(); t++) {
+                    supports[batch + c] += counts[t][c];
+                }
+            }
+            free(counts[thread]);
+        }
+    }
+    free(counts);
+}
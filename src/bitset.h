@@ -0,0 +1,127 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "apriori.h"
+#include "kernels.h"
+
+#define BITSET_ALIGNMENT 64  // Bitsets are aligned to (and padded to a multiple of) a cache line.
+#define BITSET_TILE_BYTES (1 << 19)  // Size of a tile if the size of the L2 cache is unknown
+#define TILE_COUNT_BUDGET (1 << 28)  // Max bytes used by the per-thread count arrays of countTiledSupports
+
+/**
+ * @brief Vertical representation of a TableData. Every included item (column) has a packed bitset with one bit per
+ * transaction. Bit r of the bitset of item c is set if item c occurs in transaction r. All bitsets are stored back to
+ * back in a single allocation.
+ */
+typedef struct BitsetTable {
+    int numItems;     // Number of bitsets
+    int numRows;
+    size_t numWords;  // Number of 64-bit words per item bitset. Padded to a multiple of BITSET_ALIGNMENT bytes.
+    int *itemIdx;     // Bitset of every column, -1 for columns without one. NULL if every column has one, in order.
+    uint64_t *words;
+} BitsetTable;
+
+/**
+ * @brief Builds the vertical bitset representation of some or all columns of the provided table in a single scan over
+ * its rows. On sparse data, leaving out the infrequent items keeps the table far below numCols * numRows bits.
+ *
+ * @param data Table where each row signifies a transaction and each column a product. An entry in this table is either
+ * 1 or 0, depending on whether the product occured in the provided transacion.
+ * @param items The columns to build a bitset for. NULL to build one for every column.
+ * @param numItems Number of columns in items. Ignored if items is NULL.
+ * @return BitsetTable* The bitset table. Must be freed with freeBitsetTable.
+ */
+BitsetTable *createBitsetTable(const TableData *data, const int *items, int numItems);
+
+/**
+ * @brief Frees the memory used by a bitset table.
+ *
+ * @param table The bitset table to free.
+ */
+void freeBitsetTable(BitsetTable *table);
+
+/**
+ * @brief Retrieves the bitset of a single item.
+ *
+ * @param table The bitset table.
+ * @param item Index of the item (column). Must have a bitset in the table.
+ * @return const uint64_t* Pointer to the first of table->numWords words of the bitset.
+ */
+static inline const uint64_t *itemBitset(const BitsetTable *table, int item) {
+    size_t idx = table->itemIdx ? table->itemIdx[item] : item;
+    return table->words + idx * table->numWords;
+}
+
+/**
+ * @brief Calculates the support of a set by counting the bits in the intersection of the bitsets of its items.
+ *
+ * @param table The bitset table.
+ * @param set The set to calculate the support of.
+ * @param setSize The number of elements in the set.
+ * @return int Number of transactions the complete set occurs in.
+ */
+int bitsetSupport(const BitsetTable *table, const int *set, int setSize);
+
+/**
+ * @brief Calculates the support of a set like bitsetSupport, but with a given kernel, such as one that andCountKernel
+ * returns for the size of the set.
+ *
+ * @param table The bitset table.
+ * @param kernel The kernel that intersects the bitsets.
+ * @param set The set to calculate the support of.
+ * @param setSize The number of elements in the set.
+ * @return int Number of transactions the complete set occurs in.
+ */
+int bitsetKernelSupport(const BitsetTable *table, AndCountKernel kernel, const int *set, int setSize);
+
+/**
+ * @brief Bitsets of a number of items, cut into tiles of rows that fit in the L2 cache. A tile holds the
+ * words of its rows for every item back to back, so counting all candidates of a level against one tile only reads it
+ * from memory once. The tiles are written by the threads that count on them, so that on NUMA systems every tile lives
+ * on the node of its thread.
+ */
+typedef struct BitsetTiles {
+    int numItems;      // Number of items in the tiles
+    int *itemIdx;      // Index within the tiles of every column, -1 for columns that are not included
+    size_t numTiles;
+    size_t tileWords;  // Number of 64-bit words per item in a tile. A multiple of BITSET_ALIGNMENT bytes.
+    uint64_t *words;   // Item i of tile t starts at words + (t * numItems + i) * tileWords
+} BitsetTiles;
+
+/**
+ * @brief Builds the bitsets of a number of items straight from the rows of a table, cut into tiles of about half the L2
+ * cache each. Every tile is filled from its own rows, so no full bitset table is needed.
+ *
+ * @param data The table.
+ * @param items The columns to include.
+ * @param numItems Number of columns to include.
+ * @return BitsetTiles* The tiles. Must be freed with freeBitsetTiles.
+ */
+BitsetTiles *createBitsetTiles(const TableData *data, const int *items, int numItems);
+
+/**
+ * @brief Frees the memory used by bitset tiles.
+ *
+ * @param tiles The tiles to free.
+ */
+void freeBitsetTiles(BitsetTiles *tiles);
+
+/**
+ * @brief Calculates the support of a number of candidates tile by tile. Every thread takes a tile and counts all
+ * candidates against it into its own count array before moving on; the arrays are summed at the end. If there are
+ * fewer tiles than threads, the candidates are split over the threads of a tile as well. Candidates that share all
+ * but their last item share the intersection of those items. If the count arrays would not fit in TILE_COUNT_BUDGET,
+ * the candidates are counted in batches.
+ *
+ * @param tiles The tiles. Must include every item of the candidates.
+ * @param sets The candidate sets. Must be sorted lexicographically.
+ * @param numSets Number of candidate sets.
+ * @param setSize Number of elements in every set.
+ * @param supports Output array with an entry per candidate.
+ */
+void countTiledSupports(const BitsetTiles *tiles, int **sets, int numSets, int setSize, int *supports);
+
+#endif  // BITSET_H
@@ -0,0 +1,280 @@
+#include "closed.h"
+
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "eclat.h"
+#include "utils.h"
+
+/**
+ * @brief A frequent item with its tidset.
+ */
+typedef struct ClosedItem {
+    int item;
+    int *tids;
+    int numTids;
+} ClosedItem;
+
+/**
+ * @brief State of a single thread during the depth-first search. Items are referred to by their index in items.
+ */
+typedef struct ClosedState {
+    const MiningContext *ctx;
+    int minSupportRows;
+    const ClosedItem *items;  // The frequent items, in column order
+    int numItems;
+    LevelBuffers *levels;     // Sets found by this thread
+    char *inSet;              // Flag per item: the item is part of the current set
+    int *set;                 // Items of the current set, in the order they were added
+    int *sorted;              // Room to sort the columns of the current set before recording it
+} ClosedState;
+
+/**
+ * @brief Checks whether a tid-list is a subset of the tidset of an item, i.e. whether every row of the list contains
+ * the item.
+ */
+static int containsTids(const ClosedState *state, int item, const int *tids, int numTids) {
+    const ClosedItem *closedItem = &state->items[item];
+    if (closedItem->numTids < numTids) {
+        return 0;
+    }
+    if (state->ctx->bitsets) {
+        const uint64_t *bitset = itemBitset(state->ctx->bitsets, closedItem->item);
+        for (int i = 0; i < numTids; i++) {
+            if (!(bitset[tids[i] / 64] >> (tids[i] % 64) & 1)) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    const int *other = closedItem->tids;
+    int j = 0;
+    for (int i = 0; i < numTids; i++) {
+        while (j < closedItem->numTids && other[j] < tids[i]) {
+            j++;
+        }
+        if (j == closedItem->numTids || other[j] != tids[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Checks whether at least minSupportRows rows of a tid-list contain an item, stopping as soon as the answer is
+ * known.
+ */
+static int frequentWith(const ClosedState *state, int item, const int *tids, int numTids) {
+    const ClosedItem *closedItem = &state->items[item];
+    const uint64_t *bitset = state->ctx->bitsets ? itemBitset(state->ctx->bitsets, closedItem->item) : NULL;
+    int needed = state->minSupportRows;
+    int j = 0;
+    for (int i = 0; i < numTids && needed > 0 && numTids - i >= needed; i++) {
+        if (bitset) {
+            needed -= bitset[tids[i] / 64] >> (tids[i] % 64) & 1;
+            continue;
+        }
+        while (j < closedItem->numTids && closedItem->tids[j] < tids[i]) {
+            j++;
+        }
+        needed -= j < closedItem->numTids && closedItem->tids[j] == tids[i];
+    }
+    return needed <= 0;
+}
+
+/**
+ * @brief Records the current set in the level buffers of the thread and in the support map.
+ */
+static void recordSet(ClosedState *state, int setSize, int support) {
+    // The items are numbered in column order, so sorting the items sorts the columns
+    memcpy(state->sorted, state->set, setSize * sizeof(int));
+    sortInts(state->sorted, setSize);
+    for (int i = 0; i < setSize; i++) {
+        state->sorted[i] = state->items[state->sorted[i]].item;
+    }
+    appendToLevel(state->levels, state->sorted, setSize);
+    itemsetMapPut(state->ctx->supports, state->sorted, setSize, support);
+}
+
+static int extendSet(ClosedState *state, int setSize, int item, const int *tids, int numTids);
+
+/**
+ * @brief Mines everything below a closed set: all its prefix-preserving closure extensions with items after its core
+ * item, recursively. In the closed mode the set itself is recorded; in the maximal mode only if no item at all extends
+ * it to a frequent set.
+ *
+ * @param state State of the current thread.
+ * @param setSize Number of items in the closed set, held in state->set.
+ * @param core The item that was added last to reach this set. Only later items are used to extend it.
+ * @param tids The rows the set occurs in.
+ * @param numTids Number of rows the set occurs in.
+ */
+static void mineClosedSet(ClosedState *state, int setSize, int core, const int *tids, int numTids) {
+    int maxLevel = state->ctx->maxLevel;
+    int maximal = state->ctx->itemSetMode == ITEMSETS_MAXIMAL;
+    if (!maximal && (!maxLevel || setSize <= maxLevel)) {
+        recordSet(state, setSize, numTids);
+    }
+    int hasFrequentExtension = 0;
+    for (int e = core + 1; e < state->numItems && (maximal || !maxLevel || setSize < maxLevel); e++) {
+        if (!state->inSet[e] && extendSet(state, setSize, e, tids, numTids)) {
+            hasFrequentExtension = 1;
+            if (maximal && maxLevel && setSize >= maxLevel) {
+                // Larger sets are not reported, and this set has a frequent superset
+                break;
+            }
+        }
+    }
+    if (!maximal || hasFrequentExtension) {
+        return;
+    }
+    // The items before the core item were skipped by the search, but can still extend the set
+    for (int i = 0; i < core; i++) {
+        if (!state->inSet[i] && frequentWith(state, i, tids, numTids)) {
+            return;
+        }
+    }
+    recordSet(state, setSize, numTids);
+}
+
+/**
+ * @brief Extends the current closed set with an item and, if the result is frequent, computes its closure. The closure
+ * is mined if it does not add any item before the extending item that is not in the set yet; otherwise the same closed
+ * set is reached from another parent.
+ *
+ * @param state State of the current thread.
+ * @param setSize Number of items in the current set.
+ * @param item The item to extend the set with.
+ * @param tids The rows the current set occurs in.
+ * @param numTids Number of rows the current set occurs in.
+ * @return int 1 if the extended set is frequent, 0 otherwise.
+ */
+static int extendSet(ClosedState *state, int setSize, int item, const int *tids, int numTids) {
+    const ClosedItem *closedItem = &state->items[item];
+    int *childTids = safeMalloc((numTids < closedItem->numTids ? numTids : closedItem->numTids) * sizeof(int) + 1);
+    int numChildTids = intersectTids(tids, numTids, closedItem->tids, closedItem->numTids, childTids);
+    int maxLevel = state->ctx->maxLevel;
+    if (numChildTids < state->minSupportRows || (maxLevel && setSize >= maxLevel)) {
+        // Sets beyond the maximum level are not mined; only whether the extension is frequent matters
+        free(childTids);
+        return numChildTids >= state->minSupportRows;
+    }
+    int childSize = setSize;
+    state->set[childSize++] = item;
+    state->inSet[item] = 1;
+    int prefixPreserved = 1;
+    for (int i = 0; i < state->numItems; i++) {
+        if (!state->inSet[i] && containsTids(state, i, childTids, numChildTids)) {
+            if (i < item) {
+                prefixPreserved = 0;
+                break;
+            }
+            state->set[childSize++] = i;
+            state->inSet[i] = 1;
+        }
+    }
+    if (prefixPreserved && (!maxLevel || childSize <= maxLevel)) {
+        mineClosedSet(state, childSize, item, childTids, numChildTids);
+    }
+    for (int i = setSize; i < childSize; i++) {
+        state->inSet[state->set[i]] = 0;
+    }
+    free(childTids);
+    return 1;
+}
+
+LevelSets **closedFrequentItemSets(int *finalLevel, const MiningContext *ctx, int minSupportRows) {
+    const TableData *data = ctx->data;
+    int numThreads = omp_get_max_threads();
+    LevelBuffers *levels = safeCalloc(numThreads, sizeof(LevelBuffers));
+
+    // Only the frequent items have bitsets, so their tidsets are extracted once their supports are known
+    int *supports = safeMalloc(data->numCols * sizeof(int));
+    countItemSupports(data, supports);
+    ClosedItem *items = safeMalloc(data->numCols * sizeof(ClosedItem));
+    #pragma omp parallel
+    {
+        int *scratch = safeMalloc((data->numRows + 1) * sizeof(int));
+        #pragma omp for schedule(dynamic)
+        for (int c = 0; c < data->numCols; c++) {
+            items[c] = (ClosedItem){c, NULL, supports[c]};
+            if (supports[c] >= minSupportRows) {
+                int numTids = extractTids(ctx, c, scratch);
+                items[c].tids = safeMalloc(numTids * sizeof(int) + 1);
+                memcpy(items[c].tids, scratch, numTids * sizeof(int));
+            }
+        }
+        free(scratch);
+    }
+    free(supports);
+    int numItems = 0;
+    for (int c = 0; c < data->numCols; c++) {
+        if (items[c].numTids >= minSupportRows) {
+            items[numItems++] = items[c];
+        }
+    }
+
+    // The root is the closure of the empty set: the items that occur in every row
+    int *rootTids = safeMalloc((data->numRows + 1) * sizeof(int));
+    for (int y = 0; y < data->numRows; y++) {
+        rootTids[y] = y;
+    }
+    char *rootSet = safeCalloc(numItems + 1, 1);
+    int rootSize = 0;
+    for (int i = 0; i < numItems; i++) {
+        rootSet[i] = items[i].numTids == data->numRows;
+        rootSize += rootSet[i];
+    }
+    int numExtensions = data->numRows >= minSupportRows ? numItems : 0;
+    #pragma omp parallel
+    {
+        ClosedState state = {ctx, minSupportRows, items, numItems, levels + omp_get_thread_num(),
+                             safeMalloc(numItems + 1), safeMalloc((numItems + 1) * sizeof(int)),
+                             safeMalloc((numItems + 1) * sizeof(int))};
+        memcpy(state.inSet, rootSet, numItems + 1);
+        int setSize = 0;
+        for (int i = 0; i < numItems; i++) {
+            if (rootSet[i]) {
+                state.set[setSize++] = i;
+            }
+        }
+        #pragma omp single nowait
+        {
+            // Every item is frequent with the root, so the root is only maximal if it holds all frequent items
+            int maximal = ctx->itemSetMode == ITEMSETS_MAXIMAL;
+            if (rootSize > 0 && numExtensions > 0 && (!maximal || rootSize == numItems) &&
+                (!ctx->maxLevel || rootSize <= ctx->maxLevel)) {
+                recordSet(&state, rootSize, data->numRows);
+            }
+        }
+        #pragma omp for schedule(dynamic)
+        for (int e = 0; e < numExtensions; e++) {
+            if (!rootSet[e] && (!ctx->maxLevel || rootSize < ctx->maxLevel)) {
+                extendSet(&state, setSize, e, rootTids, data->numRows);
+            }
+        }
+        free(state.inSet);
+        free(state.set);
+        free(state.sorted);
+    }
+    free(rootSet);
+    free(rootTids);
+    for (int i = 0; i < numItems; i++) {
+        free(items[i].tids);
+    }
+    free(items);
+
+    // Closed sets of any size can be missing, including single items
+    static const CandidateBuffer empty = {NULL, 0, 0};
+    const CandidateBuffer **level1Buffers = safeMalloc(numThreads * sizeof(CandidateBuffer *));
+    for (int t = 0; t < numThreads; t++) {
+        level1Buffers[t] = levels[t].numLevels > 0 ? &levels[t].levels[0] : &empty;
+    }
+    LevelSets *level1 = mergeSortedLevelSet(ctx->arena, level1Buffers, numThreads, 1);
+    free(level1Buffers);
+    if (!level1) {
+        level1 = createLevelSets(ctx->arena, 0, 1);
+    }
+    return gatherLevelSets(ctx, level1, levels, numThreads, finalLevel);
+}
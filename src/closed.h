@@ -0,0 +1,21 @@
+#ifndef CLOSED_H
+#define CLOSED_H
+
+#include "mining.h"
+
+/**
+ * @brief Generates the level sets of only the closed or only the maximal frequent item sets, depending on
+ * ctx->itemSetMode. Uses prefix-preserving closure extension (LCM): the search moves from a closed set straight to the
+ * closure of each of its extensions, so the non-closed sets in between are never generated, and every closed set is
+ * reached from exactly one parent. Maximal sets are the closed sets without a frequent extension. The extensions of the
+ * empty set are mined in parallel.
+ *
+ * @param finalLevel The number of level sets generated will be written to this pointer.
+ * @param ctx Mining context containing the data to mine. Receives the supports of the closed or maximal sets.
+ * @param minSupportRows The minimum number of rows an item set must occur in for it to be frequent.
+ * @return LevelSets** Provides for each of the finalLevel levels the sorted closed or maximal sets of that size. Levels
+ * can be empty.
+ */
+LevelSets **closedFrequentItemSets(int *finalLevel, const MiningContext *ctx, int minSupportRows);
+
+#endif  // CLOSED_H
@@ -0,0 +1,167 @@
+#include "csv.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mappedfile.h"
+#include "utils.h"
+
+/**
+ * @brief Allocates an integer matrix in such a way that it is continuous in memory and only needs a single free.
+ *
+ * @param width Width the matrix should have.
+ * @param height Height the matrix should have.
+ * @return int** Int matrix.
+ */
+static int **allocIntMatrix(int width, int height) {
+    int **matrix = safeMalloc(height * sizeof(int *) + (size_t)width * height * sizeof(int));
+    int *p = (int *)(matrix + height);
+    for (int y = 0; y < height; y++) {
+        matrix[y] = p + (size_t)width * y;
+    }
+    return matrix;
+}
+
+char **parseCSVHeader(const char *line, const char *lineEnd, int *numCols) {
+    size_t length = lineEnd - line;
+    char *headerLine = safeMalloc(length + 1);
+    memcpy(headerLine, line, length);
+    headerLine[length] = '\0';
+
+    int cols = 1;
+    for (size_t i = 0; i < length; i++) {
+        cols += headerLine[i] == ',';
+    }
+    char **headers = safeMalloc(cols * sizeof(char *));
+    int currentCol = 1;
+    headers[0] = headerLine;
+    for (size_t i = 0; i < length; i++) {
+        if (headerLine[i] == ',') {
+            headerLine[i] = '\0';
+            headers[currentCol++] = &headerLine[i + 1];
+        }
+    }
+    *numCols = cols;
+    return headers;
+}
+
+/**
+ * @brief Counts the non-empty lines of a chunk.
+ *
+ * @param start Start of the chunk. Must be the start of a line.
+ * @param end End of the chunk.
+ * @return size_t The number of non-empty lines.
+ */
+static size_t countRows(const char *start, const char *end) {
+    size_t numRows = 0;
+    const char *next;
+    for (const char *line = start; line < end; line = next) {
+        numRows += findLineEnd(line, end, &next) > line;
+    }
+    return numRows;
+}
+
+/**
+ * @brief Parses the non-empty lines of a chunk into consecutive rows of the table. Cells beyond the number of columns are
+ * ignored and missing cells are treated as empty.
+ *
+ * @param start Start of the chunk. Must be the start of a line.
+ * @param end End of the chunk.
+ * @param rows The rows to write to, one for every non-empty line.
+ * @param numCols Number of columns of the table.
+ */
+static void parseRows(const char *start, const char *end, int **rows, int numCols) {
+    int r = 0;
+    const char *next;
+    for (const char *line = start; line < end; line = next) {
+        const char *lineEnd = findLineEnd(line, end, &next);
+        if (lineEnd == line) {
+            continue;
+        }
+        int *row = rows[r++];
+        int c = 0;
+        const char *cellStart = line;
+        for (const char *p = line; p < lineEnd && c < numCols; p++) {
+            if (*p == ',') {
+                row[c++] = p > cellStart;
+                cellStart = p + 1;
+            }
+        }
+        if (c < numCols) {
+            row[c++] = lineEnd > cellStart;
+        }
+        for (; c < numCols; c++) {
+            row[c] = 0;
+        }
+    }
+}
+
+TableData *parseCSVRows(const char *start, const char *end, char **headers, int numCols) {
+    const char **chunkStart;
+    int numChunks = splitLines(start, end, &chunkStart);
+
+    // First pass: count the rows of every chunk to know where its rows start in the table
+    size_t *chunkRow = safeMalloc((numChunks + 1) * sizeof(size_t));
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < numChunks; i++) {
+        chunkRow[i + 1] = countRows(chunkStart[i], chunkStart[i + 1]);
+    }
+    chunkRow[0] = 0;
+    for (int i = 0; i < numChunks; i++) {
+        chunkRow[i + 1] += chunkRow[i];
+    }
+    if (chunkRow[numChunks] > INT_MAX) {
+        fatalError("A CSV file has more than %d rows.\n", INT_MAX);
+    }
+    int numRows = chunkRow[numChunks];
+
+    // Second pass: parse every chunk straight into its rows
+    int **data = allocIntMatrix(numCols, numRows);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < numChunks; i++) {
+        parseRows(chunkStart[i], chunkStart[i + 1], data + chunkRow[i], numCols);
+    }
+    free(chunkRow);
+    free(chunkStart);
+
+    TableData *csv = safeMalloc(sizeof(TableData));
+    csv->headers = headers;
+    csv->data = data;
+    csv->numRows = numRows;
+    csv->numCols = numCols;
+    csv->rowStart = NULL;
+    csv->items = NULL;
+    csv->bitsets = NULL;
+    csv->tidLists = NULL;
+    csv->itemSupports = NULL;
+    return csv;
+}
+
+void freeCSVRows(TableData *data) {
+    free(data->data);
+    free(data);
+}
+
+TableData *readCSV(const char *path) {
+    MappedFile file;
+    if (!mapFile(path, &file)) {
+        return NULL;
+    }
+    const char *dataStart;
+    int numCols;
+    char **headers = parseCSVHeader(file.start, findLineEnd(file.start, file.end, &dataStart), &numCols);
+    TableData *csv = parseCSVRows(dataStart, file.end, headers, numCols);
+    unmapFile(&file);
+    return csv;
+}
+
+void freeCSV(TableData *data) {
+    if (!data) {
+        return;
+    }
+    free(data->headers[0]);
+    free(data->headers);
+    free(data->data);
+    free(data);
+}
@@ -0,0 +1,57 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include "apriori.h"
+
+/**
+ * @brief Reads data from a CSV into a TableData struct. The CSV file is assumed to have a header. Each row signifies a
+ * transaction and each column a product. An entry in this table is either empty or any non-empty text, depending on
+ * whether the product occured in the provided transacion. Both LF and CRLF line endings are accepted and empty lines are
+ * skipped.
+ *
+ * The file is memory-mapped and split into chunks that start at a line boundary. The chunks are parsed in parallel
+ * straight into the rows of the table.
+ *
+ * @param path Path to the CSV file.
+ * @return TableData* Table where each row signifies a transaction and each column a product. An entry in this table is
+ * either 1 or 0, depending on whether the product occured in the provided transacion. NULL if the file could not be
+ * read. Must be freed with freeCSV.
+ */
+TableData *readCSV(const char *path);
+
+/**
+ * @brief Copies the header line of a CSV file and splits it into the column names.
+ *
+ * @param line Start of the header line.
+ * @param lineEnd End of the content of the header line, excluding the line terminator.
+ * @param numCols The number of columns will be written to this pointer.
+ * @return char** The column names. headers[0] points to the start of the single buffer holding all names.
+ */
+char **parseCSVHeader(const char *line, const char *lineEnd, int *numCols);
+
+/**
+ * @brief Parses a range of lines of a CSV file into a dense table, in parallel. Empty lines are skipped.
+ *
+ * @param start Start of the range. Must be the start of a line after the header.
+ * @param end End of the range.
+ * @param headers The column names, as returned by parseCSVHeader. The table only refers to them.
+ * @param numCols Number of columns.
+ * @return TableData* The table holding the rows of the range. Must be freed with freeCSVRows.
+ */
+TableData *parseCSVRows(const char *start, const char *end, char **headers, int numCols);
+
+/**
+ * @brief Frees a table returned by parseCSVRows. The column names are not freed.
+ *
+ * @param data The TableData to free.
+ */
+void freeCSVRows(TableData *data);
+
+/**
+ * @brief Frees the memory used by the table data.
+ *
+ * @param data The TableData to free.
+ */
+void freeCSV(TableData *data);
+
+#endif  // CSV_H
@@ -0,0 +1,308 @@
+#include "datasetcache.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitset.h"
+#include "mappedfile.h"
+#include "mining.h"
+#include "tidlists.h"
+#include "transactions.h"
+#include "utils.h"
+
+#define CACHE_MAGIC "APRCACHE"
+#define CACHE_VERSION 2
+#define CACHE_ALIGNMENT BITSET_ALIGNMENT  // Every section starts at a multiple of this, so the bitsets stay aligned
+
+/**
+ * @brief Location of a section in the cache file, in bytes.
+ */
+typedef struct CacheSection {
+    uint64_t offset;
+    uint64_t size;
+} CacheSection;
+
+/**
+ * @brief Header at the start of a cache file.
+ */
+typedef struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t wordSize;  // sizeof(size_t) of the writer, as the row offsets are stored as size_t
+    uint64_t numRows;
+    uint64_t numCols;
+    uint64_t numItems;  // Total number of columns over all rows
+    uint64_t numWords;  // Number of words per bitset
+    CacheSection nameOffsets;  // Offset of the name of every column in the names section
+    CacheSection names;        // Null-terminated column names, back to back
+    CacheSection supports;     // Support of every column as int
+    CacheSection rowStart;     // numRows + 1 row offsets into the items section as size_t
+    CacheSection items;        // Columns of every row in ascending order as int
+    CacheSection bitsets;      // numWords words for every column. Empty if the tid-lists are stored instead.
+    CacheSection listStart;    // numCols + 1 offsets into the tids section as size_t. Empty if the bitsets are stored.
+    CacheSection tids;         // Rows of every column in ascending order as int. Empty if the bitsets are stored.
+} CacheHeader;
+
+/**
+ * @brief A table loaded from a cache, together with the memory that backs it.
+ */
+typedef struct CachedTable {
+    TableData table;  // Must be the first member, so that the table can be converted back to the cache
+    BitsetTable bitsets;
+    TidListTable tidLists;
+    MappedFile file;
+} CachedTable;
+
+/**
+ * @brief Places a section of the provided size right after the previous one.
+ *
+ * @param section The section to place.
+ * @param size Size of the section in bytes.
+ * @param position Current end of the file. Is moved to the end of the section.
+ */
+static void placeSection(CacheSection *section, uint64_t size, uint64_t *position) {
+    section->offset = (*position + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+    section->size = size;
+    *position = section->offset + size;
+}
+
+/**
+ * @brief Writes a section to the file, preceded by the padding that aligns it.
+ *
+ * @param file The file to write to.
+ * @param section The section to write.
+ * @param buffer Contents of the section. May be NULL if the section is empty.
+ * @param position Current end of the file. Is moved to the end of the section.
+ * @return int 1 on success, 0 if the write failed.
+ */
+static int writeSection(FILE *file, const CacheSection *section, const void *buffer, uint64_t *position) {
+    static const char padding[CACHE_ALIGNMENT];
+    size_t numPadding = section->offset - *position;
+    *position = section->offset + section->size;
+    return fwrite(padding, 1, numPadding, file) == numPadding &&
+           (section->size == 0 || fwrite(buffer, 1, section->size, file) == section->size);
+}
+
+/**
+ * @brief Calculates the number of words per bitset of a table, padded like those of a BitsetTable.
+ */
+static uint64_t cacheBitsetWords(uint64_t numRows) {
+    return ((numRows + 63) / 64 * sizeof(uint64_t) + BITSET_ALIGNMENT - 1) / BITSET_ALIGNMENT * BITSET_ALIGNMENT /
+           sizeof(uint64_t);
+}
+
+int writeDatasetCache(const TableData *data, const char *path) {
+    // Build the representations the table does not have yet
+    TransactionList *rows = NULL;
+    const size_t *rowStart = data->rowStart;
+    const int *items = data->items;
+    if (data->data) {
+        rows = createTransactionList(data, NULL);
+        rowStart = rows->rowStart;
+        items = rows->items;
+    }
+    int *supports = safeMalloc((data->numCols > 0 ? data->numCols : 1) * sizeof(int));
+    countItemSupports(data, supports);
+    uint64_t *nameOffsets = safeMalloc((data->numCols > 0 ? data->numCols : 1) * sizeof(uint64_t));
+    uint64_t namesSize = 0;
+    for (int c = 0; c < data->numCols; c++) {
+        nameOffsets[c] = namesSize;
+        namesSize += strlen(data->headers[c]) + 1;
+    }
+    char *names = safeMalloc(namesSize > 0 ? namesSize : 1);
+    for (int c = 0; c < data->numCols; c++) {
+        strcpy(names + nameOffsets[c], data->headers[c]);
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(CacheHeader));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.wordSize = sizeof(size_t);
+    header.numRows = data->numRows;
+    header.numCols = data->numCols;
+    header.numItems = rowStart[data->numRows];
+    header.numWords = cacheBitsetWords(header.numRows);
+
+    // The bitsets take a bit per column and row, the tid-lists an int per non-zero cell: store the smaller of the two
+    uint64_t bitsetsSize = header.numCols * header.numWords * sizeof(uint64_t);
+    uint64_t tidListsSize = (header.numCols + 1) * sizeof(size_t) + header.numItems * sizeof(int);
+    BitsetTable *bitsets = NULL;
+    TidListTable *tidLists = NULL;
+    if (bitsetsSize < tidListsSize) {
+        bitsets = data->bitsets && !data->bitsets->itemIdx ? data->bitsets : createBitsetTable(data, NULL, 0);
+    } else {
+        tidLists = data->tidLists && !data->tidLists->itemIdx ? data->tidLists : createTidListTable(data, NULL, 0);
+    }
+    uint64_t position = sizeof(CacheHeader);
+    placeSection(&header.nameOffsets, header.numCols * sizeof(uint64_t), &position);
+    placeSection(&header.names, namesSize, &position);
+    placeSection(&header.supports, header.numCols * sizeof(int), &position);
+    placeSection(&header.rowStart, (header.numRows + 1) * sizeof(size_t), &position);
+    placeSection(&header.items, header.numItems * sizeof(int), &position);
+    placeSection(&header.bitsets, bitsets ? bitsetsSize : 0, &position);
+    placeSection(&header.listStart, tidLists ? (header.numCols + 1) * sizeof(size_t) : 0, &position);
+    placeSection(&header.tids, tidLists ? header.numItems * sizeof(int) : 0, &position);
+
+    int success = 0;
+    FILE *file = fopen(path, "wb");
+    if (file) {
+        position = sizeof(CacheHeader);
+        success = fwrite(&header, sizeof(CacheHeader), 1, file) == 1 &&
+                  writeSection(file, &header.nameOffsets, nameOffsets, &position) &&
+                  writeSection(file, &header.names, names, &position) &&
+                  writeSection(file, &header.supports, supports, &position) &&
+                  writeSection(file, &header.rowStart, rowStart, &position) &&
+                  writeSection(file, &header.items, items, &position) &&
+                  writeSection(file, &header.bitsets, bitsets ? bitsets->words : NULL, &position) &&
+                  writeSection(file, &header.listStart, tidLists ? tidLists->listStart : NULL, &position) &&
+                  writeSection(file, &header.tids, tidLists ? tidLists->tids : NULL, &position);
+        success = fclose(file) == 0 && success;
+    }
+    if (!success) {
+        warning("Could not write the dataset cache to path: %s\n", path);
+    }
+
+    free(nameOffsets);
+    free(names);
+    free(supports);
+    if (bitsets && bitsets != data->bitsets) {
+        freeBitsetTable(bitsets);
+    }
+    if (tidLists && tidLists != data->tidLists) {
+        freeTidListTable(tidLists);
+    }
+    if (rows) {
+        freeTransactionList(rows);
+    }
+    return success;
+}
+
+/**
+ * @brief Checks whether a section lies within the file, is aligned and has the expected size.
+ */
+static int validSection(const CacheSection *section, uint64_t expectedSize, size_t fileSize) {
+    return section->offset % CACHE_ALIGNMENT == 0 && section->size == expectedSize && section->offset <= fileSize &&
+           section->size <= fileSize - section->offset;
+}
+
+/**
+ * @brief Checks whether the header describes a cache that can be used by this build.
+ */
+static int validHeader(const CacheHeader *header, size_t fileSize) {
+    if (memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 || header->version != CACHE_VERSION ||
+        header->wordSize != sizeof(size_t) || header->numRows > INT_MAX || header->numCols > INT_MAX) {
+        return 0;
+    }
+    // Exactly one of the bitsets and the tid-lists is stored
+    int hasBitsets = header->bitsets.size > 0 || header->listStart.size == 0;
+    return header->numWords == cacheBitsetWords(header->numRows) &&
+           validSection(&header->nameOffsets, header->numCols * sizeof(uint64_t), fileSize) &&
+           validSection(&header->names, header->names.size, fileSize) &&
+           validSection(&header->supports, header->numCols * sizeof(int), fileSize) &&
+           validSection(&header->rowStart, (header->numRows + 1) * sizeof(size_t), fileSize) &&
+           validSection(&header->items, header->numItems * sizeof(int), fileSize) &&
+           validSection(&header->bitsets, hasBitsets ? header->numCols * header->numWords * sizeof(uint64_t) : 0,
+                        fileSize) &&
+           validSection(&header->listStart, hasBitsets ? 0 : (header->numCols + 1) * sizeof(size_t), fileSize) &&
+           validSection(&header->tids, hasBitsets ? 0 : header->numItems * sizeof(int), fileSize);
+}
+
+/**
+ * @brief Checks whether a list of lists stored back to back, such as the rows or the tid-lists, can be indexed safely:
+ * the offsets must be non-decreasing and end at the number of entries, and every entry must lie below the given bound.
+ *
+ * @param start numLists + 1 offsets into entries.
+ * @param numLists Number of lists.
+ * @param entries The entries of all lists.
+ * @param numEntries Number of entries.
+ * @param bound Every entry must be at least 0 and less than this.
+ * @return int 1 if the lists are valid, 0 otherwise.
+ */
+static int validLists(const size_t *start, uint64_t numLists, const int *entries, uint64_t numEntries,
+                      uint64_t bound) {
+    if (start[numLists] != numEntries) {
+        return 0;
+    }
+    int valid = 1;
+    #pragma omp parallel for schedule(static) reduction(&&:valid)
+    for (uint64_t i = 0; i < numLists; i++) {
+        valid = valid && start[i] <= start[i + 1];
+    }
+    #pragma omp parallel for schedule(static) reduction(&&:valid)
+    for (uint64_t i = 0; i < numEntries; i++) {
+        valid = valid && entries[i] >= 0 && (uint64_t)entries[i] < bound;
+    }
+    return valid;
+}
+
+TableData *loadDatasetCache(const char *path) {
+    MappedFile file;
+    if (!mapFile(path, &file)) {
+        return NULL;
+    }
+    const CacheHeader *header = (const CacheHeader *)file.start;
+    // A truncated or corrupted cache must be rejected here, as the rows and tid-lists are used without bounds checks
+    if (file.size < sizeof(CacheHeader) || !validHeader(header, file.size) ||
+        !validLists((const size_t *)(file.start + header->rowStart.offset), header->numRows,
+                    (const int *)(file.start + header->items.offset), header->numItems, header->numCols) ||
+        (header->listStart.size > 0 &&
+         !validLists((const size_t *)(file.start + header->listStart.offset), header->numCols,
+                     (const int *)(file.start + header->tids.offset), header->numItems, header->numRows))) {
+        warning("The file at path %s is not a valid dataset cache.\n", path);
+        unmapFile(&file);
+        return NULL;
+    }
+
+    // The only allocation that depends on the size of the data: the pointer to every column name
+    int numCols = header->numCols;
+    const uint64_t *nameOffsets = (const uint64_t *)(file.start + header->nameOffsets.offset);
+    const char *names = file.start + header->names.offset;
+    char **headers = safeMalloc((numCols > 0 ? numCols : 1) * sizeof(char *));
+    for (int c = 0; c < numCols; c++) {
+        if (nameOffsets[c] >= header->names.size || names[header->names.size - 1] != '\0') {
+            warning("The file at path %s is not a valid dataset cache.\n", path);
+            free(headers);
+            unmapFile(&file);
+            return NULL;
+        }
+        headers[c] = (char *)names + nameOffsets[c];
+    }
+
+    CachedTable *cache = safeMalloc(sizeof(CachedTable));
+    cache->file = file;
+    cache->bitsets.numItems = numCols;
+    cache->bitsets.numRows = header->numRows;
+    cache->bitsets.numWords = header->numWords;
+    cache->bitsets.itemIdx = NULL;
+    cache->bitsets.words = (uint64_t *)(file.start + header->bitsets.offset);
+    cache->tidLists.numItems = numCols;
+    cache->tidLists.numRows = header->numRows;
+    cache->tidLists.itemIdx = NULL;
+    cache->tidLists.listStart = (size_t *)(file.start + header->listStart.offset);
+    cache->tidLists.tids = (int *)(file.start + header->tids.offset);
+    TableData *table = &cache->table;
+    table->numRows = header->numRows;
+    table->numCols = numCols;
+    table->headers = headers;
+    table->data = NULL;
+    table->rowStart = (size_t *)(file.start + header->rowStart.offset);
+    table->items = (int *)(file.start + header->items.offset);
+    table->bitsets = header->bitsets.size > 0 ? &cache->bitsets : NULL;
+    table->tidLists = header->listStart.size > 0 ? &cache->tidLists : NULL;
+    table->itemSupports = (const int *)(file.start + header->supports.offset);
+    return table;
+}
+
+void freeDatasetCache(TableData *data) {
+    if (!data) {
+        return;
+    }
+    CachedTable *cache = (CachedTable *)data;
+    free(data->headers);
+    unmapFile(&cache->file);
+    free(cache);
+}
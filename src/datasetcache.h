@@ -0,0 +1,36 @@
+#ifndef DATASETCACHE_H
+#define DATASETCACHE_H
+
+#include "apriori.h"
+
+/**
+ * @brief Writes a table to a binary dataset cache. The cache holds the column names, the support of every column, the
+ * sparse rows of the table and a vertical form of every column, each in the exact layout used in memory. The vertical
+ * form is whichever is smaller: the bitsets for dense tables, or the tid-lists for sparse ones, such as baskets over
+ * many products. A cache is only valid on machines with the same endianness and word size as the one that wrote it.
+ *
+ * @param data The table to write. Can be dense or sparse.
+ * @param path Path of the cache file to create. An existing file is overwritten.
+ * @return int 1 if the cache was written, 0 otherwise. A warning is printed in the latter case.
+ */
+int writeDatasetCache(const TableData *data, const char *path);
+
+/**
+ * @brief Loads a table from a binary dataset cache. The file is memory-mapped and its buffers are used in place; only
+ * the array of column name pointers is allocated. The returned table is sparse and comes with its column supports and
+ * either its bitsets or its tid-lists, so the mining does not need to build them.
+ *
+ * @param path Path to a cache file written by writeDatasetCache.
+ * @return TableData* The table. NULL if the file could not be read or is not a valid cache, which includes caches whose
+ * rows or tid-lists would index out of bounds. Must be freed with freeDatasetCache.
+ */
+TableData *loadDatasetCache(const char *path);
+
+/**
+ * @brief Frees a table that was loaded with loadDatasetCache and unmaps its file.
+ *
+ * @param data The TableData to free.
+ */
+void freeDatasetCache(TableData *data);
+
+#endif  // DATASETCACHE_H
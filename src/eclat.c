@@ -0,0 +1,269 @@
+#include "eclat.h"
+
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "table.h"
+#include "tidlists.h"
+#include "utils.h"
+
+/**
+ * @brief Member of a prefix equivalence class: the item that extends the prefix of the class, the support of the
+ * extended set and either its tidset or its diffset, depending on the representation of the class.
+ */
+typedef struct EclatNode {
+    int item;
+    int support;
+    int *tids;
+    int numTids;
+} EclatNode;
+
+/**
+ * @brief State of a single thread during the depth-first search.
+ */
+typedef struct EclatState {
+    const MiningContext *ctx;
+    int minSupportRows;
+    LevelBuffers *levels;     // Frequent sets found by this thread
+    int *scratch;             // numRows ints used to compute tid-lists before their size is known
+} EclatState;
+
+int intersectTids(const int *a, int numA, const int *b, int numB, int *out) {
+    int i = 0, j = 0, n = 0;
+    while (i < numA && j < numB) {
+        if (a[i] < b[j]) {
+            i++;
+        } else if (a[i] > b[j]) {
+            j++;
+        } else {
+            out[n++] = a[i];
+            i++;
+            j++;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Computes the difference a \ b of two sorted tid-lists.
+ *
+ * @return int Number of tids written to out.
+ */
+static int differenceTids(const int *a, int numA, const int *b, int numB, int *out) {
+    int i = 0, j = 0, n = 0;
+    while (i < numA) {
+        if (j == numB || a[i] < b[j]) {
+            out[n++] = a[i++];
+        } else if (a[i] > b[j]) {
+            j++;
+        } else {
+            i++;
+            j++;
+        }
+    }
+    return n;
+}
+
+static int *copyTids(const int *tids, int numTids) {
+    int *copy = safeMalloc((numTids > 0 ? numTids : 1) * sizeof(int));
+    memcpy(copy, tids, numTids * sizeof(int));
+    return copy;
+}
+
+/**
+ * @brief Records a frequent item set in the level buffers of the thread and in the support map.
+ */
+static void recordSet(EclatState *state, const int *set, int setSize, int support) {
+    appendToLevel(state->levels, set, setSize);
+    itemsetMapPut(state->ctx->supports, set, setSize, support);
+}
+
+static void mineClass(EclatState *state, int *prefix, int depth, EclatNode *members, int numMembers,
+                      int isDiff);
+
+/**
+ * @brief Extends member i of a class with all later members of the class and recursively mines the resulting class.
+ * prefix[0 .. depth - 1] is the prefix of the class.
+ *
+ * For tidsets, t(PXY) = t(PX) & t(PY). For diffsets, d(PXY) = d(PY) \ d(PX). In both cases the support of PXY follows
+ * from the size of its list. A class switches to diffsets when these are smaller in total than the tidsets.
+ */
+static void extendMember(EclatState *state, int *prefix, int depth, const EclatNode *members,
+                         int numMembers, int i, int isDiff) {
+    const EclatNode *member = &members[i];
+    prefix[depth] = member->item;
+    // The sets recorded here have depth + 2 items; at the maximum level they are not extended any further
+    int maxLevel = state->ctx->maxLevel;
+    int extend = !maxLevel || depth + 2 < maxLevel;
+    EclatNode *children = safeMalloc((numMembers - i) * sizeof(EclatNode));
+    int numChildren = 0;
+    size_t sumTids = 0;
+    size_t sumDiffs = 0;
+    for (int j = i + 1; j < numMembers; j++) {
+        const EclatNode *other = &members[j];
+        // Every frequent pair is in the support map, and PXY can only be frequent if XY is. The members of a top-level
+        // class all form a frequent pair with its item already.
+        int pair[2] = {member->item, other->item};
+        if (depth > 0 && itemsetMapGet(state->ctx->supports, pair, 2) < 0) {
+            continue;
+        }
+        int numTids, support;
+        if (isDiff) {
+            numTids = differenceTids(other->tids, other->numTids, member->tids, member->numTids, state->scratch);
+            support = member->support - numTids;
+        } else {
+            numTids = intersectTids(member->tids, member->numTids, other->tids, other->numTids, state->scratch);
+            support = numTids;
+        }
+        if (support < state->minSupportRows) {
+            continue;
+        }
+        prefix[depth + 1] = other->item;
+        recordSet(state, prefix, depth + 2, support);
+        if (!extend) {
+            continue;
+        }
+        children[numChildren++] = (EclatNode){other->item, support, copyTids(state->scratch, numTids), numTids};
+        sumTids += support;
+        sumDiffs += member->support - support;
+    }
+
+    int childIsDiff = isDiff;
+    if (!isDiff && sumDiffs < sumTids) {
+        // The class got dense: switch to diffsets d(PXY) = t(PX) \ t(PXY)
+        for (int c = 0; c < numChildren; c++) {
+            EclatNode *child = &children[c];
+            int numDiffs = differenceTids(member->tids, member->numTids, child->tids, child->numTids, state->scratch);
+            free(child->tids);
+            child->tids = copyTids(state->scratch, numDiffs);
+            child->numTids = numDiffs;
+        }
+        childIsDiff = 1;
+    }
+    if (numChildren > 1) {
+        mineClass(state, prefix, depth + 1, children, numChildren, childIsDiff);
+    }
+    for (int c = 0; c < numChildren; c++) {
+        free(children[c].tids);
+    }
+    free(children);
+}
+
+/**
+ * @brief Mines all item sets in a prefix equivalence class depth-first. Only the tid-lists along the current path are
+ * kept in memory.
+ */
+static void mineClass(EclatState *state, int *prefix, int depth, EclatNode *members, int numMembers,
+                      int isDiff) {
+    for (int i = 0; i < numMembers - 1; i++) {
+        extendMember(state, prefix, depth, members, numMembers, i, isDiff);
+    }
+}
+
+int extractTids(const MiningContext *ctx, int item, int *tids) {
+    int numTids = 0;
+    if (ctx->data->tidLists) {
+        const int *list = itemTids(ctx->data->tidLists, item, &numTids);
+        memcpy(tids, list, numTids * sizeof(int));
+    } else if (ctx->bitsets && (!ctx->bitsets->itemIdx || ctx->bitsets->itemIdx[item] >= 0)) {
+        const uint64_t *bitset = itemBitset(ctx->bitsets, item);
+        for (size_t w = 0; w < ctx->bitsets->numWords; w++) {
+            uint64_t word = bitset[w];
+            while (word) {
+                tids[numTids++] = w * 64 + __builtin_ctzll(word);
+                word &= word - 1;
+            }
+        }
+    } else {
+        for (int y = 0; y < ctx->data->numRows; y++) {
+            if (tableHasItem(ctx->data, y, item)) {
+                tids[numTids++] = y;
+            }
+        }
+    }
+    return numTids;
+}
+
+LevelSets **eclatFrequentItemSets(int *finalLevel, const MiningContext *ctx, int minSupportRows) {
+    const TableData *data = ctx->data;
+    int numThreads = omp_get_max_threads();
+    LevelBuffers *levels = safeCalloc(numThreads, sizeof(LevelBuffers));
+
+    // Level 1: the frequent items, with their tid-lists taken from the table or built for them alone
+    int *supports = safeMalloc(data->numCols * sizeof(int));
+    countItemSupports(data, supports);
+    int *frequent = safeMalloc((data->numCols + 1) * sizeof(int));
+    int numItems = 0;
+    for (int c = 0; c < data->numCols; c++) {
+        if (supports[c] >= minSupportRows) {
+            itemsetMapPut(ctx->supports, &c, 1, supports[c]);
+            frequent[numItems++] = c;
+        }
+    }
+    LevelSets *level1 = createLevelSets(ctx->arena, numItems, 1);
+    TidListTable *ownTids = data->tidLists ? NULL : createTidListTable(data, frequent, numItems);
+    const TidListTable *tidLists = data->tidLists ? data->tidLists : ownTids;
+    EclatNode *items = safeMalloc((numItems + 1) * sizeof(EclatNode));
+    for (int i = 0; i < numItems; i++) {
+        level1->sets[i][0] = frequent[i];
+        // Borrowed from the tid-list table; only the lists of the classes below the top level are owned
+        int numTids;
+        int *tids = (int *)itemTids(tidLists, frequent[i], &numTids);
+        items[i] = (EclatNode){frequent[i], supports[frequent[i]], tids, numTids};
+    }
+    free(supports);
+
+    // Level 2: all pairs are counted in a single scan, so that the top-level classes only intersect the tid-lists of the
+    // pairs that are known to be frequent. The partners of item i are partners[classStart[i] .. classStart[i + 1]).
+    int numClasses = ctx->maxLevel == 1 ? 0 : numItems;
+    LevelSets *pairs = numClasses > 0 ? countPairs(level1, ctx, minSupportRows) : NULL;
+    int numPairs = pairs ? pairs->numSets : 0;
+    int *frequentIdx = safeMalloc((data->numCols + 1) * sizeof(int));
+    for (int i = 0; i < numItems; i++) {
+        frequentIdx[frequent[i]] = i;
+    }
+    int *classStart = safeCalloc(numItems + 1, sizeof(int));
+    int *partners = safeMalloc((numPairs + 1) * sizeof(int));
+    for (int p = 0; p < numPairs; p++) {
+        classStart[frequentIdx[pairs->sets[p][0]] + 1]++;
+        partners[p] = frequentIdx[pairs->sets[p][1]];
+    }
+    for (int i = 0; i < numItems; i++) {
+        classStart[i + 1] += classStart[i];
+    }
+    free(frequentIdx);
+    free(frequent);
+
+    // Every top-level item (with its frequent partners) is an independent class, so they are mined in parallel
+    #pragma omp parallel
+    {
+        int thread = omp_get_thread_num();
+        EclatState state = {ctx, minSupportRows, levels + thread, safeMalloc((data->numRows + 1) * sizeof(int))};
+        int *prefix = safeMalloc((numItems + 1) * sizeof(int));  // A set can hold at most all frequent items
+        EclatNode *members = safeMalloc((numItems + 1) * sizeof(EclatNode));
+        #pragma omp for schedule(dynamic)
+        for (int i = 0; i < numClasses; i++) {
+            int numMembers = 1 + classStart[i + 1] - classStart[i];
+            if (numMembers < 2) {
+                continue;
+            }
+            members[0] = items[i];
+            for (int m = 1; m < numMembers; m++) {
+                members[m] = items[partners[classStart[i] + m - 1]];
+            }
+            extendMember(&state, prefix, 0, members, numMembers, 0, 0);
+        }
+        free(members);
+        free(prefix);
+        free(state.scratch);
+    }
+    free(partners);
+    free(classStart);
+    free(items);
+    if (ownTids) {
+        freeTidListTable(ownTids);
+    }
+
+    return gatherLevelSets(ctx, level1, levels, numThreads, finalLevel);
+}
@@ -0,0 +1,46 @@
+#ifndef ECLAT_H
+#define ECLAT_H
+
+#include "mining.h"
+
+/**
+ * @brief Generates the level sets using the Eclat algorithm. The item sets are mined depth-first over prefix equivalence
+ * classes on vertical tid-lists. Once the tid-lists of a class get dense, the class and its descendants switch to
+ * diffsets (dEclat). The pairs are counted up front in a single scan, like the apriori engine does, so every top-level
+ * class only holds the items that form a frequent pair with its item, and deeper classes skip the extensions whose last
+ * two items are not a frequent pair. The top-level classes are mined in parallel. The result is identical to that of
+ * the level-wise apriori approach: the same sorted level sets and the same supports in ctx->supports.
+ *
+ * @param finalLevel The number of level sets generated will be written to this pointer.
+ * @param ctx Mining context containing the data to mine.
+ * @param minSupportRows The minimum number of rows an item set must occur in for it to be added to the level set.
+ * @return LevelSets** Provides for each of the finalLevel levels a number of sets that satisfy the minimum support
+ * criterion. At a given level k, the size of each set is k elements.
+ */
+LevelSets **eclatFrequentItemSets(int *finalLevel, const MiningContext *ctx, int minSupportRows);
+
+/**
+ * @brief Extracts the tidset of an item from the prebuilt tid-lists of the table, from the bitset of the item or, if
+ * there is neither, from the rows of the table.
+ *
+ * @param ctx Mining context containing the data.
+ * @param item The item (column).
+ * @param tids Output array with room for all rows of the table. Receives the rows the item occurs in, in ascending
+ * order.
+ * @return int Number of tids written to tids.
+ */
+int extractTids(const MiningContext *ctx, int item, int *tids);
+
+/**
+ * @brief Computes the intersection of two sorted tid-lists.
+ *
+ * @param a The first tid-list.
+ * @param numA Number of tids in a.
+ * @param b The second tid-list.
+ * @param numB Number of tids in b.
+ * @param out Output array with room for the smaller of the two lists. May not overlap with a or b.
+ * @return int Number of tids written to out.
+ */
+int intersectTids(const int *a, int numA, const int *b, int numB, int *out);
+
+#endif  // ECLAT_H
@@ -0,0 +1,312 @@
+#define _GNU_SOURCE  // qsort_r
+#include "fpgrowth.h"
+
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "table.h"
+#include "utils.h"
+
+#define ROOT 0  // Index of the root node of every tree
+
+/**
+ * @brief Node of an FP-tree. Nodes refer to each other by index, so the node array can grow freely.
+ */
+typedef struct FPNode {
+    int item;     // Rank of the item within its tree
+    int count;    // Number of transactions that share the path from the root to this node
+    int parent;   // Parent node
+    int child;    // First child
+    int sibling;  // Next child of the parent
+    int next;     // Next node with the same item (node-link)
+} FPNode;
+
+/**
+ * @brief An FP-tree. Items are ranked by descending support within the tree, and every path from the root visits them
+ * in rank order, so that transactions sharing their most frequent items share a prefix.
+ */
+typedef struct FPTree {
+    FPNode *nodes;
+    int numNodes;
+    int capacity;
+    int numItems;
+    int *headers;     // First node of every item (head of its node-link)
+    int *rootChild;   // Child of the root for every item, for fast lookup in wide trees
+    int *supports;    // Support of every item
+    int *itemIds;     // Original column index of every item
+} FPTree;
+
+/**
+ * @brief State of a single thread while mining.
+ */
+typedef struct FPState {
+    const MiningContext *ctx;
+    int minSupportRows;
+    LevelBuffers *levels;  // Frequent sets found by this thread
+    int *set;              // Scratch space to sort a set in before recording it
+} FPState;
+
+static FPTree *createTree(int numItems, const int *supports, const int *itemIds) {
+    FPTree *tree = safeMalloc(sizeof(FPTree));
+    tree->capacity = 256;
+    tree->nodes = safeMalloc(tree->capacity * sizeof(FPNode));
+    tree->nodes[ROOT] = (FPNode){-1, 0, -1, -1, -1, -1};
+    tree->numNodes = 1;
+    tree->numItems = numItems;
+    tree->headers = safeMalloc(numItems * sizeof(int));
+    tree->rootChild = safeMalloc(numItems * sizeof(int));
+    tree->supports = safeMalloc(numItems * sizeof(int));
+    tree->itemIds = safeMalloc(numItems * sizeof(int));
+    for (int i = 0; i < numItems; i++) {
+        tree->headers[i] = -1;
+        tree->rootChild[i] = -1;
+    }
+    memcpy(tree->supports, supports, numItems * sizeof(int));
+    memcpy(tree->itemIds, itemIds, numItems * sizeof(int));
+    return tree;
+}
+
+static void freeTree(FPTree *tree) {
+    free(tree->nodes);
+    free(tree->headers);
+    free(tree->rootChild);
+    free(tree->supports);
+    free(tree->itemIds);
+    free(tree);
+}
+
+/**
+ * @brief Inserts a path into the tree.
+ *
+ * @param tree The tree to insert in.
+ * @param items Ranks of the items of the path, in ascending order.
+ * @param numItems Number of items in the path.
+ * @param count Number of transactions the path represents.
+ */
+static void insertPath(FPTree *tree, const int *items, int numItems, int count) {
+    int node = ROOT;
+    for (int i = 0; i < numItems; i++) {
+        int item = items[i];
+        int child = node == ROOT ? tree->rootChild[item] : tree->nodes[node].child;
+        if (node != ROOT) {
+            while (child != -1 && tree->nodes[child].item != item) {
+                child = tree->nodes[child].sibling;
+            }
+        }
+        if (child == -1) {
+            if (tree->numNodes == tree->capacity) {
+                tree->capacity *= 2;
+                tree->nodes = realloc(tree->nodes, tree->capacity * sizeof(FPNode));
+                if (!tree->nodes) {
+                    fatalError("Failed to grow the FP-tree to %d nodes.\n", tree->capacity);
+                }
+            }
+            child = tree->numNodes++;
+            tree->nodes[child] = (FPNode){item, 0, node, -1, tree->nodes[node].child, tree->headers[item]};
+            tree->nodes[node].child = child;
+            tree->headers[item] = child;
+            if (node == ROOT) {
+                tree->rootChild[item] = child;
+            }
+        }
+        tree->nodes[child].count += count;
+        node = child;
+    }
+}
+
+/**
+ * @brief Records a frequent item set in the level buffers of the thread and in the support map. The set is given in
+ * mining order and sorted on item index before it is stored.
+ */
+static void recordSet(FPState *state, const int *prefix, int setSize, int support) {
+    memcpy(state->set, prefix, setSize * sizeof(int));
+    sortInts(state->set, setSize);
+    appendToLevel(state->levels, state->set, setSize);
+    itemsetMapPut(state->ctx->supports, state->set, setSize, support);
+}
+
+static int compareBySupport(const void *a, const void *b, void *supports) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    int supportX = ((const int *)supports)[x];
+    int supportY = ((const int *)supports)[y];
+    if (supportX != supportY) {
+        return supportX > supportY ? -1 : 1;
+    }
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Ranks the frequent items by descending support. Ties are broken on the index of the item.
+ *
+ * @param supports Support of every item.
+ * @param n Number of items.
+ * @param minSupportRows Minimum support of a frequent item.
+ * @param order The frequent items are written to this array, most frequent first. Must have room for n items.
+ * @return int Number of frequent items.
+ */
+static int rankItems(const int *supports, int n, int minSupportRows, int *order) {
+    int numItems = 0;
+    for (int i = 0; i < n; i++) {
+        if (supports[i] >= minSupportRows) {
+            order[numItems++] = i;
+        }
+    }
+    qsort_r(order, numItems, sizeof(int), compareBySupport, (void *)supports);
+    return numItems;
+}
+
+/**
+ * @brief Builds the conditional FP-tree of an item from its conditional pattern base: the paths from the root to every
+ * node of the item, weighted by the count of that node. Items that are infrequent within the pattern base are left out.
+ *
+ * @return FPTree* The conditional tree, or NULL if no item in the pattern base is frequent.
+ */
+static FPTree *conditionalTree(const FPTree *tree, int item, int minSupportRows) {
+    // Pass 1: support of every (more frequent) item within the pattern base
+    int *supports = safeCalloc(item > 0 ? item : 1, sizeof(int));
+    for (int node = tree->headers[item]; node != -1; node = tree->nodes[node].next) {
+        int count = tree->nodes[node].count;
+        for (int a = tree->nodes[node].parent; a != ROOT; a = tree->nodes[a].parent) {
+            supports[tree->nodes[a].item] += count;
+        }
+    }
+    // Rank the frequent items by descending conditional support. Ties are broken on the rank in the parent tree.
+    int *order = safeMalloc((item > 0 ? item : 1) * sizeof(int));
+    int numItems = rankItems(supports, item, minSupportRows, order);
+    FPTree *cond = NULL;
+    if (numItems > 0) {
+        int *rank = safeMalloc(item * sizeof(int));
+        int *condSupports = safeMalloc(numItems * sizeof(int));
+        int *condIds = safeMalloc(numItems * sizeof(int));
+        for (int i = 0; i < item; i++) {
+            rank[i] = -1;
+        }
+        for (int r = 0; r < numItems; r++) {
+            rank[order[r]] = r;
+            condSupports[r] = supports[order[r]];
+            condIds[r] = tree->itemIds[order[r]];
+        }
+        cond = createTree(numItems, condSupports, condIds);
+        // Pass 2: insert the filtered and re-ranked paths
+        int *path = safeMalloc(numItems * sizeof(int));
+        for (int node = tree->headers[item]; node != -1; node = tree->nodes[node].next) {
+            int numPath = 0;
+            for (int a = tree->nodes[node].parent; a != ROOT; a = tree->nodes[a].parent) {
+                int r = rank[tree->nodes[a].item];
+                if (r >= 0) {
+                    path[numPath++] = r;
+                }
+            }
+            sortInts(path, numPath);
+            insertPath(cond, path, numPath, tree->nodes[node].count);
+        }
+        free(path);
+        free(rank);
+        free(condSupports);
+        free(condIds);
+    }
+    free(supports);
+    free(order);
+    return cond;
+}
+
+/**
+ * @brief Mines all frequent item sets that end in the given item of a tree: the item itself extended with prefix, and
+ * recursively everything in its conditional tree.
+ *
+ * @param state State of the current thread.
+ * @param tree The tree to mine.
+ * @param item Rank of the item in the tree.
+ * @param prefix Items (original column indices) the tree is conditioned on. The item is written at prefix[depth].
+ * @param depth Number of items in the prefix.
+ */
+static void mineItem(FPState *state, const FPTree *tree, int item, int *prefix, int depth) {
+    prefix[depth] = tree->itemIds[item];
+    if (depth > 0) {
+        recordSet(state, prefix, depth + 1, tree->supports[item]);
+    }
+    if (state->ctx->maxLevel && depth + 1 >= state->ctx->maxLevel) {
+        return;
+    }
+    FPTree *cond = conditionalTree(tree, item, state->minSupportRows);
+    if (!cond) {
+        return;
+    }
+    for (int i = cond->numItems - 1; i >= 0; i--) {
+        mineItem(state, cond, i, prefix, depth + 1);
+    }
+    freeTree(cond);
+}
+
+LevelSets **fpGrowthFrequentItemSets(int *finalLevel, const MiningContext *ctx, int minSupportRows) {
+    const TableData *data = ctx->data;
+    int numThreads = omp_get_max_threads();
+
+    // Pass 1: item supports. The frequent items are ranked by descending support, ties broken on column index.
+    int *supports = safeMalloc(data->numCols * sizeof(int));
+    countItemSupports(data, supports);
+    int *order = safeMalloc(data->numCols * sizeof(int));
+    int numItems = rankItems(supports, data->numCols, minSupportRows, order);
+    int *rank = safeMalloc(data->numCols * sizeof(int));
+    int *rankSupports = safeMalloc((numItems > 0 ? numItems : 1) * sizeof(int));
+    for (int c = 0; c < data->numCols; c++) {
+        rank[c] = -1;
+    }
+    for (int r = 0; r < numItems; r++) {
+        rank[order[r]] = r;
+        rankSupports[r] = supports[order[r]];
+    }
+
+    LevelSets *level1 = createLevelSets(ctx->arena, numItems, 1);
+    int idx = 0;
+    for (int c = 0; c < data->numCols; c++) {
+        if (rank[c] >= 0) {
+            level1->sets[idx++][0] = c;
+            itemsetMapPut(ctx->supports, &c, 1, supports[c]);
+        }
+    }
+
+    // Pass 2: insert the frequent items of every transaction, most frequent first
+    FPTree *tree = createTree(numItems, rankSupports, order);
+    int *path = safeMalloc((numItems > 0 ? numItems : 1) * sizeof(int));
+    int *rowBuffer = safeMalloc(data->numCols * sizeof(int));
+    for (int y = 0; y < data->numRows; y++) {
+        int rowSize;
+        const int *row = tableRowItems(data, y, rowBuffer, &rowSize);
+        int numPath = 0;
+        for (int i = 0; i < rowSize; i++) {
+            if (rank[row[i]] >= 0) {
+                path[numPath++] = rank[row[i]];
+            }
+        }
+        sortInts(path, numPath);
+        insertPath(tree, path, numPath, 1);
+    }
+    free(path);
+    free(rowBuffer);
+    free(supports);
+    free(order);
+    free(rank);
+    free(rankSupports);
+
+    // Every item of the header table has its own conditional pattern base, so they are mined in parallel. The least
+    // frequent items have the longest paths and are scheduled first.
+    LevelBuffers *levels = safeCalloc(numThreads, sizeof(LevelBuffers));
+    #pragma omp parallel
+    {
+        // A set can hold at most all frequent items
+        int *prefix = safeMalloc((numItems + 1) * sizeof(int));
+        FPState state = {ctx, minSupportRows, levels + omp_get_thread_num(), safeMalloc((numItems + 1) * sizeof(int))};
+        #pragma omp for schedule(dynamic)
+        for (int i = numItems - 1; i >= 0; i--) {
+            mineItem(&state, tree, i, prefix, 0);
+        }
+        free(prefix);
+        free(state.set);
+    }
+    freeTree(tree);
+
+    return gatherLevelSets(ctx, level1, levels, numThreads, finalLevel);
+}
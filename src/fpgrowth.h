@@ -0,0 +1,21 @@
+#ifndef FPGROWTH_H
+#define FPGROWTH_H
+
+#include "mining.h"
+
+/**
+ * @brief Generates the level sets using the FP-Growth algorithm. The transactions are compressed into an FP-tree in two
+ * passes over the rows of the table, after which the frequent item sets are mined from the conditional pattern bases of
+ * the items, without generating candidates. No bitsets are used. The items of the header table are mined in parallel.
+ * The result is identical to that of the level-wise apriori approach: the same sorted level sets and the same supports
+ * in ctx->supports.
+ *
+ * @param finalLevel The number of level sets generated will be written to this pointer.
+ * @param ctx Mining context containing the data to mine.
+ * @param minSupportRows The minimum number of rows an item set must occur in for it to be added to the level set.
+ * @return LevelSets** Provides for each of the finalLevel levels a number of sets that satisfy the minimum support
+ * criterion. At a given level k, the size of each set is k elements.
+ */
+LevelSets **fpGrowthFrequentItemSets(int *finalLevel, const MiningContext *ctx, int minSupportRows);
+
+#endif  // FPGROWTH_H
@@ -0,0 +1,374 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apriori.h"
+#include "csv.h"
+#include "mappedfile.h"
+#include "mining.h"
+#include "transactions.h"
+#include "trie.h"
+#include "utils.h"
+
+#define STATE_MAGIC "APRSTATE"
+#define STATE_VERSION 1
+#define STATE_TAIL_SIZE 4096  // Number of bytes before the end of the mined rows that must be unchanged
+
+/**
+ * @brief Header at the start of a state file. Followed by a record for every frequent item set, level by level: the
+ * set size and the support as int32_t, followed by the items as int32_t.
+ */
+typedef struct StateHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numCols;
+    uint64_t numRows;      // Number of rows mined so far
+    uint64_t dataEnd;      // Offset in the CSV file up to which the rows were mined
+    uint64_t headerHash;   // Hash of the header line of the CSV file
+    uint64_t tailHash;     // Hash of the STATE_TAIL_SIZE bytes before dataEnd
+    int32_t minSupportRows;  // Item sets that are not in the state occur in fewer rows than this
+    int32_t maxLevel;        // Size of the largest item sets in the state. 0 if they were mined without a limit.
+    uint64_t numSets;
+} StateHeader;
+
+/**
+ * @brief The frequent item sets of a previous run, together with the rows they were mined from.
+ */
+typedef struct MiningState {
+    StateHeader header;
+    ItemsetMap *supports;  // Support of every item set of the state in the rows mined so far
+} MiningState;
+
+/**
+ * @brief The rows that were mined by the previous run. They are only parsed once a candidate needs to be counted in
+ * them, and then kept for the following levels.
+ */
+typedef struct OldRows {
+    const char *start;
+    const char *end;
+    const TableData *header;
+    const int *keepItems;           // Items that can still be part of a frequent item set
+    TransactionList *transactions;  // NULL until the rows are needed
+} OldRows;
+
+/**
+ * @brief Computes the 64-bit FNV-1a hash of a range of bytes.
+ */
+static uint64_t hashBytes(const char *start, const char *end) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *p = start; p < end; p++) {
+        hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Hashes the bytes right before the end of the rows mined by a run, to detect inputs that were not only
+ * appended to.
+ */
+static uint64_t hashTail(const char *dataStart, const char *dataEnd) {
+    return hashBytes(dataEnd - dataStart > STATE_TAIL_SIZE ? dataEnd - STATE_TAIL_SIZE : dataStart, dataEnd);
+}
+
+/**
+ * @brief Reads a state file and checks that it belongs to the provided CSV file.
+ *
+ * @param state The state will be written to this struct.
+ * @param path Path to the state file.
+ * @param file The mapped CSV file.
+ * @param dataStart Start of the first line after the header.
+ * @param numCols Number of columns of the CSV file.
+ * @return int 1 if the state can be used, 0 otherwise. A warning is printed if the file exists but cannot be used.
+ */
+static int readState(MiningState *state, const char *path, const MappedFile *file, const char *dataStart,
+                     int numCols) {
+    FILE *stateFile = fopen(path, "rb");
+    if (!stateFile) {
+        return 0;
+    }
+    StateHeader *header = &state->header;
+    const char *headerEnd = dataStart;
+    int valid = fread(header, sizeof(StateHeader), 1, stateFile) == 1 &&
+                memcmp(header->magic, STATE_MAGIC, sizeof(header->magic)) == 0 &&
+                header->version == STATE_VERSION && header->numCols == (uint32_t)numCols &&
+                header->headerHash == hashBytes(file->start, headerEnd) && header->dataEnd <= file->size &&
+                file->start + header->dataEnd >= dataStart &&
+                header->tailHash == hashTail(dataStart, file->start + header->dataEnd);
+    state->supports = createItemsetMap(valid ? header->numSets : 0);
+    int *set = safeMalloc((numCols + 1) * sizeof(int));
+    for (uint64_t i = 0; valid && i < header->numSets; i++) {
+        int32_t record[2];  // setSize, support
+        valid = fread(record, sizeof(record), 1, stateFile) == 1 && record[0] > 0 && record[0] <= numCols &&
+                fread(set, sizeof(int32_t), record[0], stateFile) == (size_t)record[0];
+        if (valid) {
+            itemsetMapPut(state->supports, set, record[0], record[1]);
+        }
+    }
+    free(set);
+    fclose(stateFile);
+    if (!valid) {
+        warning("The state file %s does not belong to this input; mining all rows from scratch.\n", path);
+        freeItemsetMap(state->supports);
+    }
+    return valid;
+}
+
+/**
+ * @brief Writes the frequent item sets of a run to a state file. The file is written next to the old one and renamed
+ * over it, so an interrupted run leaves the previous state intact.
+ *
+ * @param path Path of the state file.
+ * @param header Header describing the rows that were mined. Its number of sets is filled in.
+ * @param sets The level sets.
+ * @param n Number of level sets.
+ * @param supports The supports of the sets.
+ * @return int 1 if the state was written, 0 otherwise. A warning is printed in the latter case.
+ */
+static int writeState(const char *path, StateHeader *header, LevelSets **sets, int n, const ItemsetMap *supports) {
+    header->numSets = 0;
+    for (int l = 0; l < n; l++) {
+        header->numSets += sets[l]->numSets;
+    }
+    char *tmpPath = safeMalloc(strlen(path) + 5);
+    sprintf(tmpPath, "%s.tmp", path);
+    FILE *file = fopen(tmpPath, "wb");
+    int success = file && fwrite(header, sizeof(StateHeader), 1, file) == 1;
+    for (int l = 0; success && l < n; l++) {
+        for (int i = 0; success && i < sets[l]->numSets; i++) {
+            int32_t record[2] = {l + 1, itemsetMapGet(supports, sets[l]->sets[i], l + 1)};
+            success = fwrite(record, sizeof(record), 1, file) == 1 &&
+                      fwrite(sets[l]->sets[i], sizeof(int32_t), l + 1, file) == (size_t)l + 1;
+        }
+    }
+    if (file) {
+        success = fclose(file) == 0 && success;
+    }
+    success = success && rename(tmpPath, path) == 0;
+    if (!success) {
+        warning("Could not write the state file to path: %s\n", path);
+        remove(tmpPath);
+    }
+    free(tmpPath);
+    return success;
+}
+
+/**
+ * @brief Counts a number of candidates in a list of transactions.
+ *
+ * @param sets The candidate sets. Must be sorted lexicographically.
+ * @param numSets Number of candidate sets.
+ * @param setSize Number of elements in every set.
+ * @param transactions The transactions to count in.
+ * @param supports Output array with an entry per candidate.
+ */
+static void countCandidates(int **sets, int numSets, int setSize, const TransactionList *transactions,
+                            int *supports) {
+    if (numSets == 0) {
+        return;
+    }
+    CandidateTrie *trie = createCandidateTrie(sets, numSets, setSize);
+    countTrieSupports(trie, transactions, supports);
+    freeCandidateTrie(trie);
+}
+
+/**
+ * @brief Counts a number of candidates in the rows of the previous run, parsing them first if this did not happen yet.
+ */
+static void countOldRows(OldRows *old, int **sets, int numSets, int setSize, int *supports) {
+    if (!old->transactions) {
+        TableData *part = parseCSVRows(old->start, old->end, old->header->headers, old->header->numCols);
+        old->transactions = createTransactionList(part, old->keepItems);
+        freeCSVRows(part);
+    }
+    countCandidates(sets, numSets, setSize, old->transactions, supports);
+}
+
+/**
+ * @brief Updates the frequent item sets of a previous run with new rows, following the FUP algorithm. The candidates of
+ * every level are counted in the new rows first. An item set that was frequent before gets its new support from its
+ * old support. An item set that was not frequent before occurred in fewer than state->minSupportRows of the old rows,
+ * so it can only have become frequent if it occurs often enough in the new rows. Only those are counted in the old
+ * rows.
+ *
+ * @param finalLevel The number of level sets generated will be written to this pointer.
+ * @param ctx Context that receives the level sets and the supports of the frequent item sets.
+ * @param state The frequent item sets of the previous run.
+ * @param old The rows of the previous run.
+ * @param delta The new rows.
+ * @param minSupportRows The minimum number of rows an item set must occur in over all rows.
+ * @param numRescanned The number of candidates that were counted in the old rows will be written to this pointer.
+ * @return LevelSets** Provides for each of the finalLevel levels the sorted sets that satisfy the minimum support.
+ */
+static LevelSets **updateFrequentItemSets(int *finalLevel, MiningContext *ctx, const MiningState *state,
+                                          OldRows *old, const TableData *delta, int minSupportRows,
+                                          int *numRescanned) {
+    int numCols = ctx->data->numCols;
+    LevelSets **sets = arenaAlloc(ctx->arena, (numCols + 1) * sizeof(LevelSets *));
+    TransactionList *deltaTransactions = createTransactionList(delta, NULL);
+    int *keepItems = safeCalloc(numCols, sizeof(int));
+    old->keepItems = keepItems;
+    *numRescanned = 0;
+
+    CandidateBuffer candidates = {NULL, 0, 0};
+    for (int c = 0; c < numCols; c++) {
+        appendCandidate(&candidates, &c, 1);
+    }
+    int level = 0;
+    while (candidates.numSets > 0 && (!ctx->maxLevel || level < ctx->maxLevel)) {
+        int setSize = level + 1;
+        int numSets = candidates.numSets;
+        int **candidateSets = safeMalloc(numSets * sizeof(int *));
+        for (int i = 0; i < numSets; i++) {
+            candidateSets[i] = candidates.sets + (size_t)i * setSize;
+        }
+        int *supports = safeMalloc(numSets * sizeof(int));
+        countCandidates(candidateSets, numSets, setSize, deltaTransactions, supports);
+
+        // Sets beyond the maximum level of the previous run were never counted, so nothing is known about them
+        int bounded = !state->header.maxLevel || setSize <= state->header.maxLevel;
+        int **rescan = safeMalloc(numSets * sizeof(int *));
+        int *rescanIdx = safeMalloc(numSets * sizeof(int));
+        int numRescan = 0;
+        for (int i = 0; i < numSets; i++) {
+            int oldSupport = itemsetMapGet(state->supports, candidateSets[i], setSize);
+            if (oldSupport >= 0) {
+                supports[i] += oldSupport;
+            } else if (!bounded || (int64_t)supports[i] + state->header.minSupportRows - 1 >= minSupportRows) {
+                rescan[numRescan] = candidateSets[i];
+                rescanIdx[numRescan++] = i;
+            } else {
+                supports[i] = -1;
+            }
+            if (setSize == 1 && supports[i] >= 0) {
+                keepItems[candidateSets[i][0]] = 1;
+            }
+        }
+        if (numRescan > 0) {
+            int *oldSupports = safeMalloc(numRescan * sizeof(int));
+            countOldRows(old, rescan, numRescan, setSize, oldSupports);
+            for (int i = 0; i < numRescan; i++) {
+                supports[rescanIdx[i]] += oldSupports[i];
+            }
+            free(oldSupports);
+            *numRescanned += numRescan;
+        }
+        free(rescan);
+        free(rescanIdx);
+
+        int numFrequent = 0;
+        for (int i = 0; i < numSets; i++) {
+            numFrequent += supports[i] >= minSupportRows;
+        }
+        LevelSets *levelSet = createLevelSets(ctx->arena, numFrequent, setSize);
+        int setIdx = 0;
+        for (int i = 0; i < numSets; i++) {
+            if (supports[i] >= minSupportRows) {
+                memcpy(levelSet->sets[setIdx++], candidateSets[i], setSize * sizeof(int));
+                itemsetMapPut(ctx->supports, candidateSets[i], setSize, supports[i]);
+            }
+        }
+        free(supports);
+        free(candidateSets);
+        if (numFrequent == 0 && level > 0) {
+            break;
+        }
+        printLevelSize(ctx, setSize, numFrequent);
+        sets[level++] = levelSet;
+
+        if (setSize == 1) {
+            // Infrequent items can never be part of a candidate, so leave them out of the new rows
+            int *frequent = safeCalloc(numCols, sizeof(int));
+            for (int i = 0; i < levelSet->numSets; i++) {
+                frequent[levelSet->sets[i][0]] = 1;
+            }
+            freeTransactionList(deltaTransactions);
+            deltaTransactions = createTransactionList(delta, frequent);
+            free(frequent);
+        }
+        // The capacity of a candidate buffer is counted in sets of a fixed size, so every level starts a new buffer
+        free(candidates.sets);
+        candidates = (CandidateBuffer){NULL, 0, 0};
+        generateCandidates(levelSet, ctx->supports, &candidates);
+    }
+    free(candidates.sets);
+    freeTransactionList(deltaTransactions);
+    *finalLevel = level;
+    return sets;
+}
+
+void aprioriCSVIncremental(const char *csvPath, const char *statePath, const MiningOptions *options,
+                           const OutputSink *output) {
+    MappedFile file;
+    if (!mapFile(csvPath, &file)) {
+        return;
+    }
+    int previousThreads = setMiningThreads(options->numThreads);
+    const char *dataStart;
+    TableData header = {0};
+    header.headers = parseCSVHeader(file.start, findLineEnd(file.start, file.end, &dataStart), &header.numCols);
+
+    MiningState state;
+    int incremental = readState(&state, statePath, &file, dataStart, header.numCols);
+    const char *deltaStart = incremental ? file.start + state.header.dataEnd : dataStart;
+    TableData *delta = parseCSVRows(deltaStart, file.end, header.headers, header.numCols);
+    int64_t numRows = (incremental ? state.header.numRows : 0) + delta->numRows;
+    if (numRows > INT32_MAX) {
+        fatalError("The CSV file has more than %d rows.\n", INT32_MAX);
+    }
+    header.numRows = numRows;
+
+    if (header.numRows == 0 || header.numCols == 0) {
+        warning("No data preset in the provided CSV file.\n");
+    } else {
+        int minSupportRows = header.numRows * options->minSupport;
+        MiningContext ctx;
+        LevelSets **sets;
+        int numLevels;
+        if (incremental) {
+            // Only the column names are needed from the table; the rows are counted by updateFrequentItemSets
+            ctx = (MiningContext){.data = &header, .counting = options->counting, .output = output,
+                                  .maxLevel = options->maxLevel};
+            ctx.supports = createItemsetMap(state.header.numSets);
+            ctx.arena = createArena(ARENA_CHUNK_SIZE);
+            OldRows old = {dataStart, deltaStart, &header, NULL, NULL};
+            int numRescanned;
+            sets = updateFrequentItemSets(&numLevels, &ctx, &state, &old, delta, minSupportRows, &numRescanned);
+            if (old.transactions) {
+                freeTransactionList(old.transactions);
+            }
+            free((int *)old.keepItems);
+            fprintf(output->info, "Mined %d new rows; counted %d candidates in the %d previous rows\n",
+                    delta->numRows, numRescanned, (int)state.header.numRows);
+        } else {
+            // Without a state, all rows are new and mined with the selected engine
+            initMiningContext(&ctx, delta, options->counting);
+            ctx.output = output;
+            ctx.maxLevel = options->maxLevel;
+            sets = mineFrequentItemSets(&numLevels, &ctx, options->engine, minSupportRows);
+        }
+        writeMiningResults(sets, numLevels, &ctx, options->minConfidence);
+
+        StateHeader stateHeader = {.version = STATE_VERSION, .numCols = header.numCols, .numRows = header.numRows,
+                                   .dataEnd = file.size, .headerHash = hashBytes(file.start, dataStart),
+                                   .tailHash = hashTail(dataStart, file.end), .minSupportRows = minSupportRows,
+                                   .maxLevel = options->maxLevel};
+        memcpy(stateHeader.magic, STATE_MAGIC, sizeof(stateHeader.magic));
+        writeState(statePath, &stateHeader, sets, numLevels, ctx.supports);
+        if (incremental) {
+            freeItemsetMap(ctx.supports);
+            freeArena(ctx.arena);
+        } else {
+            freeMiningContext(&ctx);
+        }
+    }
+
+    if (incremental) {
+        freeItemsetMap(state.supports);
+    }
+    freeCSVRows(delta);
+    free(header.headers[0]);
+    free(header.headers);
+    unmapFile(&file);
+    setMiningThreads(previousThreads);
+}
@@ -0,0 +1,238 @@
+#include "itemsetmap.h"
+
+#include <omp.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "utils.h"
+
+#define SHARD_BITS 6
+#define NUM_SHARDS (1 << SHARD_BITS)
+#define MIN_SHARD_CAPACITY 16
+#define KEY_CHUNK_LEN (1 << 14)  // Number of ints in a chunk of the key pool
+
+/**
+ * @brief A single entry of the table. A hash of 0 marks an empty slot. The hash is written last (with release
+ * semantics), so a reader that observes a non-zero hash also observes the key and value.
+ */
+typedef struct Slot {
+    uint64_t hash;
+    const int *key;
+    int keyLen;
+    int value;
+} Slot;
+
+/**
+ * @brief Open addressing table of a shard. Replaced by a table of twice the size when it gets too full. Old tables are
+ * kept until the map is freed, because lock-free readers may still be probing them.
+ */
+typedef struct SlotTable {
+    struct SlotTable *retired;  // Previous (smaller) table of the same shard
+    size_t mask;                // Capacity - 1. The capacity is a power of 2.
+    Slot slots[];
+} SlotTable;
+
+/**
+ * @brief Chunk of the key pool. Keys are never moved once written, so slots can point straight into the chunks.
+ */
+typedef struct KeyChunk {
+    struct KeyChunk *next;
+    size_t used;
+    size_t capacity;
+    int keys[];
+} KeyChunk;
+
+typedef struct Shard {
+    SlotTable *table;
+    size_t count;
+    KeyChunk *keys;
+    omp_lock_t lock;
+} __attribute__((aligned(64))) Shard;
+
+struct ItemsetMap {
+    Shard shards[NUM_SHARDS];
+};
+
+/**
+ * @brief Hashes a set. The top SHARD_BITS bits select the shard, the low bits the slot within the shard.
+ */
+static inline uint64_t hashSet(const int *set, int setSize) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ (uint64_t)setSize;
+    for (int i = 0; i < setSize; i++) {
+        h = (h ^ (uint32_t)set[i]) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+    }
+    h ^= h >> 33;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 29;
+    return h ? h : 1;  // 0 marks an empty slot, so it is remapped without touching the slot or shard bits
+}
+
+static SlotTable *allocSlotTable(size_t capacity) {
+    SlotTable *table = safeMalloc(sizeof(SlotTable) + capacity * sizeof(Slot));
+    memset(table->slots, 0, capacity * sizeof(Slot));
+    table->retired = NULL;
+    table->mask = capacity - 1;
+    return table;
+}
+
+ItemsetMap *createItemsetMap(size_t expectedSize) {
+    ItemsetMap *map = safeAlignedCalloc(__alignof__(Shard), sizeof(ItemsetMap));
+    size_t capacity = MIN_SHARD_CAPACITY;
+    while (capacity * NUM_SHARDS * 3 < expectedSize * 4) {
+        capacity <<= 1;
+    }
+    for (int i = 0; i < NUM_SHARDS; i++) {
+        Shard *shard = &map->shards[i];
+        shard->table = allocSlotTable(capacity);
+        shard->count = 0;
+        shard->keys = NULL;
+        omp_init_lock(&shard->lock);
+    }
+    return map;
+}
+
+void freeItemsetMap(ItemsetMap *map) {
+    for (int i = 0; i < NUM_SHARDS; i++) {
+        Shard *shard = &map->shards[i];
+        SlotTable *table = shard->table;
+        while (table) {
+            SlotTable *retired = table->retired;
+            free(table);
+            table = retired;
+        }
+        KeyChunk *chunk = shard->keys;
+        while (chunk) {
+            KeyChunk *next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+        omp_destroy_lock(&shard->lock);
+    }
+    free(map);
+}
+
+/**
+ * @brief Copies a key into the key pool of a shard. Must be called with the shard lock held.
+ */
+static const int *storeKey(Shard *shard, const int *set, int setSize) {
+    KeyChunk *chunk = shard->keys;
+    if (!chunk || chunk->used + setSize > chunk->capacity) {
+        size_t capacity = setSize > KEY_CHUNK_LEN ? setSize : KEY_CHUNK_LEN;
+        chunk = safeMalloc(sizeof(KeyChunk) + capacity * sizeof(int));
+        chunk->next = shard->keys;
+        chunk->used = 0;
+        chunk->capacity = capacity;
+        shard->keys = chunk;
+    }
+    int *key = chunk->keys + chunk->used;
+    memcpy(key, set, setSize * sizeof(int));
+    chunk->used += setSize;
+    return key;
+}
+
+/**
+ * @brief Doubles the capacity of the table of a shard. Must be called with the shard lock held.
+ */
+static void growShard(Shard *shard) {
+    SlotTable *old = shard->table;
+    SlotTable *table = allocSlotTable((old->mask + 1) << 1);
+    for (size_t i = 0; i <= old->mask; i++) {
+        Slot *slot = &old->slots[i];
+        if (slot->hash == 0) {
+            continue;
+        }
+        size_t idx = slot->hash & table->mask;
+        while (table->slots[idx].hash != 0) {
+            idx = (idx + 1) & table->mask;
+        }
+        table->slots[idx] = *slot;
+    }
+    table->retired = old;
+    __atomic_store_n(&shard->table, table, __ATOMIC_RELEASE);
+}
+
+static inline int keyEquals(const Slot *slot, const int *set, int setSize) {
+    return slot->keyLen == setSize && memcmp(slot->key, set, setSize * sizeof(int)) == 0;
+}
+
+int itemsetMapPut(ItemsetMap *map, const int *set, int setSize, int value) {
+    uint64_t hash = hashSet(set, setSize);
+    Shard *shard = &map->shards[hash >> (64 - SHARD_BITS)];
+    omp_set_lock(&shard->lock);
+    if ((shard->count + 1) * 4 > (shard->table->mask + 1) * 3) {
+        growShard(shard);
+    }
+    SlotTable *table = shard->table;
+    size_t idx = hash & table->mask;
+    int probes = 1;
+    while (table->slots[idx].hash != 0) {
+        if (table->slots[idx].hash == hash && keyEquals(&table->slots[idx], set, setSize)) {
+            omp_unset_lock(&shard->lock);
+            countMapAccess(1, probes);
+            return 0;
+        }
+        idx = (idx + 1) & table->mask;
+        probes++;
+    }
+    Slot *slot = &table->slots[idx];
+    slot->key = storeKey(shard, set, setSize);
+    slot->keyLen = setSize;
+    slot->value = value;
+    __atomic_store_n(&slot->hash, hash, __ATOMIC_RELEASE);
+    shard->count++;
+    omp_unset_lock(&shard->lock);
+    countMapAccess(1, probes);
+    return 1;
+}
+
+int itemsetMapGet(const ItemsetMap *map, const int *set, int setSize) {
+    uint64_t hash = hashSet(set, setSize);
+    const Shard *shard = &map->shards[hash >> (64 - SHARD_BITS)];
+    const SlotTable *table = __atomic_load_n(&shard->table, __ATOMIC_ACQUIRE);
+    size_t idx = hash & table->mask;
+    for (int probes = 1;; probes++) {
+        const Slot *slot = &table->slots[idx];
+        uint64_t slotHash = __atomic_load_n(&slot->hash, __ATOMIC_ACQUIRE);
+        if (slotHash == 0) {
+            countMapAccess(0, probes);
+            return -1;
+        }
+        if (slotHash == hash && keyEquals(slot, set, setSize)) {
+            countMapAccess(0, probes);
+            return slot->value;
+        }
+        idx = (idx + 1) & table->mask;
+    }
+}
+
+size_t itemsetMapSize(const ItemsetMap *map) {
+    size_t size = 0;
+    for (int i = 0; i < NUM_SHARDS; i++) {
+        size += map->shards[i].count;
+    }
+    return size;
+}
+
+size_t itemsetMapCapacity(const ItemsetMap *map) {
+    size_t capacity = 0;
+    for (int i = 0; i < NUM_SHARDS; i++) {
+        capacity += map->shards[i].table->mask + 1;
+    }
+    return capacity;
+}
+
+size_t itemsetMapMemory(const ItemsetMap *map) {
+    size_t bytes = sizeof(ItemsetMap);
+    for (int i = 0; i < NUM_SHARDS; i++) {
+        for (const SlotTable *table = map->shards[i].table; table; table = table->retired) {
+            bytes += sizeof(SlotTable) + (table->mask + 1) * sizeof(Slot);
+        }
+        for (const KeyChunk *chunk = map->shards[i].keys; chunk; chunk = chunk->next) {
+            bytes += sizeof(KeyChunk) + chunk->used * sizeof(int);
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,68 @@
+#ifndef ITEMSETMAP_H
+#define ITEMSETMAP_H
+
+#include <stddef.h>
+
+/**
+ * @brief Hash table that maps item sets (sorted tuples of item indices) to an integer value, typically their support.
+ * The table uses open addressing and is split into a number of independently growing shards. Lookups are lock-free and
+ * inserts only lock the shard the key belongs to, so the table can be used from within parallel regions. Keys are
+ * copied into the table, so neither lookups nor inserts require the caller to allocate anything.
+ */
+typedef struct ItemsetMap ItemsetMap;
+
+/**
+ * @brief Creates an empty item set map.
+ *
+ * @param expectedSize Number of entries the map is expected to hold. Only used as a hint for the initial capacity;
+ * the map grows on its own.
+ * @return ItemsetMap* The new map. Must be freed with freeItemsetMap.
+ */
+ItemsetMap *createItemsetMap(size_t expectedSize);
+
+/**
+ * @brief Frees the memory used by an item set map.
+ *
+ * @param map The map to free.
+ */
+void freeItemsetMap(ItemsetMap *map);
+
+/**
+ * @brief Inserts a set into the map. If the set is already present, the existing value is left untouched. Safe to call
+ * concurrently with other inserts and lookups.
+ *
+ * @param map The map to insert into.
+ * @param set The set to use as key.
+ * @param setSize Number of elements in the set.
+ * @param value The value to associate with the set.
+ * @return int 1 if the set was inserted, 0 if it was already present.
+ */
+int itemsetMapPut(ItemsetMap *map, const int *set, int setSize, int value);
+
+/**
+ * @brief Looks up the value of a set. Safe to call concurrently with inserts and other lookups.
+ *
+ * @param map The map to search in.
+ * @param set The set to look up.
+ * @param setSize Number of elements in the set.
+ * @return int The value associated with the set, or -1 if the set is not present.
+ */
+int itemsetMapGet(const ItemsetMap *map, const int *set, int setSize);
+
+/**
+ * @brief Returns the number of sets stored in the map.
+ */
+size_t itemsetMapSize(const ItemsetMap *map);
+
+/**
+ * @brief Returns the number of slots of the current tables of the map. The load of the map is its size divided by this.
+ */
+size_t itemsetMapCapacity(const ItemsetMap *map);
+
+/**
+ * @brief Returns the number of bytes the map uses: its tables, including the retired ones, and the stored keys. The
+ * unused rest of the chunks of the key pool is not included, as it is never touched.
+ */
+size_t itemsetMapMemory(const ItemsetMap *map);
+
+#endif  // ITEMSETMAP_H
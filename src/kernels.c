@@ -0,0 +1,183 @@
+#include "kernels.h"
+
+#include <immintrin.h>
+#include <string.h>
+
+// Every kernel is compiled for its own instruction set through the target attribute, so the rest of the program can be
+// built for a baseline CPU while a single binary still uses the widest vectors available at runtime.
+//
+// The body of every kernel is an always inlined function of the number of bitsets. Besides the generic kernel, it is
+// instantiated for every constant count up to MAX_SPECIALIZED_SIZE, for which the compiler fully unrolls the loop over
+// the bitsets and keeps their pointers in registers.
+
+/**
+ * @brief Counts the bits of the intersection of the words [from, numWords) one word at a time. Used by the scalar
+ * kernel and for the tails of the vector kernels.
+ */
+static inline __attribute__((always_inline)) uint64_t andCountTail(const uint64_t *const *vectors, int numVectors,
+                                                                   size_t from, size_t numWords) {
+    uint64_t count = 0;
+    for (size_t w = from; w < numWords; w++) {
+        uint64_t word = vectors[0][w];
+        for (int i = 1; i < numVectors; i++) {
+            word &= vectors[i][w];
+        }
+        count += __builtin_popcountll(word);
+    }
+    return count;
+}
+
+static inline __attribute__((always_inline)) uint64_t andCountScalarBody(const uint64_t *const *vectors,
+                                                                          int numVectors, size_t numWords) {
+    return andCountTail(vectors, numVectors, 0, numWords);
+}
+
+__attribute__((target("sse4.2,popcnt"), always_inline)) static inline uint64_t andCountSSE42Body(
+    const uint64_t *const *vectors, int numVectors, size_t numWords) {
+    uint64_t count = 0;
+    size_t w = 0;
+    for (; w + 2 <= numWords; w += 2) {
+        __m128i acc = _mm_loadu_si128((const __m128i *)(vectors[0] + w));
+        for (int i = 1; i < numVectors; i++) {
+            acc = _mm_and_si128(acc, _mm_loadu_si128((const __m128i *)(vectors[i] + w)));
+        }
+        count += _mm_popcnt_u64(_mm_cvtsi128_si64(acc)) + _mm_popcnt_u64(_mm_extract_epi64(acc, 1));
+    }
+    return count + andCountTail(vectors, numVectors, w, numWords);
+}
+
+/**
+ * @brief Per 64-bit lane popcount of a 256-bit vector using a nibble lookup table.
+ */
+__attribute__((target("avx2"))) static inline __m256i popcount256(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,  //
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowMask = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_and_si256(v, lowMask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+    return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"), always_inline)) static inline uint64_t andCountAVX2Body(const uint64_t *const *vectors,
+                                                                                     int numVectors, size_t numWords) {
+    __m256i total = _mm256_setzero_si256();
+    size_t w = 0;
+    for (; w + 4 <= numWords; w += 4) {
+        __m256i acc = _mm256_loadu_si256((const __m256i *)(vectors[0] + w));
+        for (int i = 1; i < numVectors; i++) {
+            acc = _mm256_and_si256(acc, _mm256_loadu_si256((const __m256i *)(vectors[i] + w)));
+        }
+        total = _mm256_add_epi64(total, popcount256(acc));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + andCountTail(vectors, numVectors, w, numWords);
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq"), always_inline)) static inline uint64_t andCountAVX512Body(
+    const uint64_t *const *vectors, int numVectors, size_t numWords) {
+    __m512i total = _mm512_setzero_si512();
+    size_t w = 0;
+    for (; w + 8 <= numWords; w += 8) {
+        __m512i acc = _mm512_loadu_si512(vectors[0] + w);
+        for (int i = 1; i < numVectors; i++) {
+            acc = _mm512_and_si512(acc, _mm512_loadu_si512(vectors[i] + w));
+        }
+        total = _mm512_add_epi64(total, _mm512_popcnt_epi64(acc));
+    }
+    return _mm512_reduce_add_epi64(total) + andCountTail(vectors, numVectors, w, numWords);
+}
+
+/**
+ * @brief Defines the generic kernel of an instruction set and its instances for 1 to MAX_SPECIALIZED_SIZE bitsets.
+ */
+#define DEFINE_KERNEL(name, target)                                                                \
+    target static uint64_t name(const uint64_t *const *vectors, int numVectors, size_t numWords) { \
+        return name##Body(vectors, numVectors, numWords);                                          \
+    }                                                                                              \
+    DEFINE_FIXED_KERNEL(name, target, 1)                                                           \
+    DEFINE_FIXED_KERNEL(name, target, 2)                                                           \
+    DEFINE_FIXED_KERNEL(name, target, 3)                                                           \
+    DEFINE_FIXED_KERNEL(name, target, 4)                                                           \
+    DEFINE_FIXED_KERNEL(name, target, 5)                                                           \
+    DEFINE_FIXED_KERNEL(name, target, 6)                                                           \
+    DEFINE_FIXED_KERNEL(name, target, 7)                                                           \
+    DEFINE_FIXED_KERNEL(name, target, 8)                                                           \
+    static const AndCountKernel name##Fixed[MAX_SPECIALIZED_SIZE + 1] = {                          \
+        name, name##1, name##2, name##3, name##4, name##5, name##6, name##7, name##8};
+
+#define DEFINE_FIXED_KERNEL(name, target, size)                                                          \
+    target static uint64_t name##size(const uint64_t *const *vectors, int numVectors, size_t numWords) { \
+        (void)numVectors;                                                                                \
+        return name##Body(vectors, size, numWords);                                                      \
+    }
+
+DEFINE_KERNEL(andCountScalar, )
+DEFINE_KERNEL(andCountSSE42, __attribute__((target("sse4.2,popcnt"))))
+DEFINE_KERNEL(andCountAVX2, __attribute__((target("avx2"))))
+DEFINE_KERNEL(andCountAVX512, __attribute__((target("avx512f,avx512vpopcntdq"))))
+
+static const char *kernelNames[] = {"auto", "scalar", "sse4.2", "avx2", "avx512"};
+static const AndCountKernel kernels[] = {NULL, andCountScalar, andCountSSE42, andCountAVX2, andCountAVX512};
+static const AndCountKernel *fixedKernels[] = {NULL, andCountScalarFixed, andCountSSE42Fixed, andCountAVX2Fixed,
+                                               andCountAVX512Fixed};
+
+AndCountKernel andCount = andCountScalar;
+static KernelType activeKernel = KERNEL_SCALAR;
+
+/**
+ * @brief Checks through CPUID whether the current CPU can run a kernel.
+ */
+static int kernelSupported(KernelType type) {
+    __builtin_cpu_init();
+    switch (type) {
+        case KERNEL_SCALAR:
+            return 1;
+        case KERNEL_SSE42:
+            return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+        case KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case KERNEL_AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+        default:
+            return 0;
+    }
+}
+
+int selectKernel(KernelType type) {
+    if (type == KERNEL_AUTO) {
+        type = KERNEL_AVX512;
+        while (!kernelSupported(type)) {
+            type--;
+        }
+    } else if (!kernelSupported(type)) {
+        return 0;
+    }
+    activeKernel = type;
+    andCount = kernels[type];
+    return 1;
+}
+
+AndCountKernel andCountKernel(int numVectors) {
+    return numVectors <= MAX_SPECIALIZED_SIZE ? fixedKernels[activeKernel][numVectors] : andCount;
+}
+
+KernelType currentKernel(void) { return activeKernel; }
+
+int parseKernelType(const char *name, KernelType *type) {
+    for (int i = KERNEL_AUTO; i <= KERNEL_AVX512; i++) {
+        if (strcmp(name, kernelNames[i]) == 0) {
+            *type = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char *kernelName(KernelType type) { return kernelNames[type]; }
+
+/**
+ * @brief Selects the fastest supported kernel when the program starts.
+ */
+__attribute__((constructor)) static void initKernels(void) { selectKernel(KERNEL_AUTO); }
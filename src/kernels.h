@@ -0,0 +1,74 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_SPECIALIZED_SIZE 8  // Kernels, subset checks and rule masks are compiled for every set size up to this
+
+/**
+ * @brief Instruction set variants of the bitset kernels.
+ */
+typedef enum KernelType {
+    KERNEL_AUTO,  // Pick the fastest kernel the CPU supports
+    KERNEL_SCALAR,
+    KERNEL_SSE42,
+    KERNEL_AVX2,
+    KERNEL_AVX512,
+} KernelType;
+
+/**
+ * @brief Kernel that counts the number of bits set in the intersection (AND) of a number of bitsets.
+ *
+ * @param vectors Pointers to the bitsets to intersect.
+ * @param numVectors Number of bitsets. Must be at least 1.
+ * @param numWords Number of 64-bit words in every bitset.
+ * @return uint64_t Number of bits set in vectors[0] & vectors[1] & ... & vectors[numVectors - 1].
+ */
+typedef uint64_t (*AndCountKernel)(const uint64_t *const *vectors, int numVectors, size_t numWords);
+
+/**
+ * @brief The AND+popcount kernel currently in use. Selected through CPUID when the program starts and can be overridden
+ * with selectKernel.
+ */
+extern AndCountKernel andCount;
+
+/**
+ * @brief Returns the kernel of the current instruction set that is compiled for a fixed number of bitsets, so its loop
+ * over the bitsets is fully unrolled. Meant to be looked up once per level rather than once per candidate.
+ *
+ * @param numVectors Number of bitsets that the kernel will intersect. Must be at least 1.
+ * @return AndCountKernel A kernel that ignores its numVectors argument and intersects numVectors bitsets, or andCount
+ * itself if numVectors is larger than MAX_SPECIALIZED_SIZE.
+ */
+AndCountKernel andCountKernel(int numVectors);
+
+/**
+ * @brief Selects the kernel used by andCount.
+ *
+ * @param type The kernel to use. KERNEL_AUTO selects the fastest kernel the CPU supports.
+ * @return int 1 if the kernel was selected, 0 if the CPU does not support it. In the latter case the current kernel is
+ * left untouched.
+ */
+int selectKernel(KernelType type);
+
+/**
+ * @brief Returns the type of the kernel currently in use.
+ */
+KernelType currentKernel(void);
+
+/**
+ * @brief Parses a kernel name ("auto", "scalar", "sse4.2", "avx2" or "avx512").
+ *
+ * @param name Name of the kernel.
+ * @param type The parsed kernel type is written to this pointer.
+ * @return int 1 if the name was recognised, 0 otherwise.
+ */
+int parseKernelType(const char *name, KernelType *type);
+
+/**
+ * @brief Returns the name of a kernel type.
+ */
+const char *kernelName(KernelType type);
+
+#endif  // KERNELS_H
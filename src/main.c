@@ -1,11 +1,28 @@
+#include <getopt.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 
 #include "apriori.h"
+#include "baskets.h"
+#include "csv.h"
+#include "datasetcache.h"
+#include "kernels.h"
+#include "metrics.h"
+#include "output.h"
 
-#define DEFAULT_MIN_SUPPORT 0.005
-#define DEFAULT_MIN_CONFIDENCE 0.6
+#define DEFAULT_SAMPLE_ERROR 0.01  // Chance that a frequent item set is not frequent in a sample
+
+/**
+ * @brief Formats of the input file.
+ */
+typedef enum InputFormat {
+    FORMAT_CSV,     // Dense CSV with a header and a column per product
+    FORMAT_BASKET,  // A line per transaction listing its items, as in the FIMI .dat format
+    FORMAT_CACHE,   // Binary dataset cache written with --write-cache
+} InputFormat;
 
 // Timing utils
 typedef struct {
@@ -22,33 +39,397 @@ float elapsedTime(Timer timer) {
                     (timer.endTime.tv_usec - timer.startTime.tv_usec) / 1.0e6));
 }
 
+/**
+ * @brief Reads the input file in the provided format.
+ *
+ * @return TableData* The table. NULL if the file could not be read.
+ */
+static TableData *loadTable(InputFormat format, const char *path) {
+    switch (format) {
+        case FORMAT_BASKET:
+            return readBaskets(path);
+        case FORMAT_CACHE:
+            return loadDatasetCache(path);
+        default:
+            return readCSV(path);
+    }
+}
+
+/**
+ * @brief Frees a table that was read with loadTable.
+ */
+static void freeTable(InputFormat format, TableData *data) {
+    switch (format) {
+        case FORMAT_BASKET:
+            freeBaskets(data);
+            break;
+        case FORMAT_CACHE:
+            freeDatasetCache(data);
+            break;
+        default:
+            freeCSV(data);
+            break;
+    }
+}
+
+static void printUsage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] <input> [minSupport minConfidence]\n"
+            "Options:\n"
+            "  -f, --format=FORMAT  Input format: csv (one column per product), basket (one line of items per "
+            "transaction) or cache (written with --write-cache) (default: csv)\n"
+            "  -w, --write-cache=FILE  Convert the input to a binary dataset cache instead of mining it\n"
+            "  -m, --memory-budget=MB  Mine a csv file in partitions that fit in the budget instead of loading it at "
+            "once. The locally frequent item sets are kept in full, so low supports can exceed the budget (with a "
+            "warning)\n"
+            "  -s, --state=FILE     Mine a csv file incrementally: only rows appended since the run that wrote FILE are "
+            "read, and FILE is updated afterwards\n"
+            "  -o, --output=FILE    Write the results to FILE instead of stdout\n"
+            "  -O, --output-format=FORMAT  Result format: text (aligned rules), csv, jsonl (item sets and rules with "
+            "their supports), binary (compact records with item ids) or none (default: text)\n"
+            "  -p, --workers=N      Count the candidates in N local worker processes that each own a shard of the "
+            "transactions (apriori engine only)\n"
+            "  -S, --sample=N       Mine a random sample of N rows at a lowered support and verify the results in a "
+            "single pass over all rows. Every reported item set is frequent, but a warning shows when some may be "
+            "missing.\n"
+            "  -r, --seed=N         Seed of the random sample (default: 1)\n"
+            "  -E, --sample-error=P Chance that a frequent item set is not frequent in the sample, used to lower its "
+            "support (default: 0.01)\n"
+            "  -t, --threads=N      Number of threads to mine with (default: OMP_NUM_THREADS or all cores)\n"
+            "  -l, --max-level=K    Only mine item sets of at most K items (default: no limit)\n"
+            "  -i, --itemsets=MODE  Item sets to report: all, closed (no superset with the same support) or maximal "
+            "(no frequent superset) (default: all)\n"
+            "  -e, --engine=NAME    Mining algorithm: apriori, eclat or fpgrowth (default: apriori)\n"
+            "  -c, --counting=MODE  Support counting: bitset (per candidate), trie (one scan per level) or tiled (all "
+            "candidates of a level per cache-sized block of rows) (default: bitset)\n"
+            "  -k, --kernel=NAME    Bitset kernel to use: auto, scalar, sse4.2, avx2 or avx512 (default: auto)\n"
+            "  -M, --metrics=FILE   Write the time per phase and level, candidate counts, support map probes, thread "
+            "busy times and peak memory to FILE as JSON. Requires a build with make METRICS=1.\n",
+            program);
+}
+
 int main(int argc, char *argv[]) {
+    static const struct option longOptions[] = {
+        {"format", required_argument, NULL, 'f'},
+        {"write-cache", required_argument, NULL, 'w'},
+        {"memory-budget", required_argument, NULL, 'm'},
+        {"state", required_argument, NULL, 's'},
+        {"output", required_argument, NULL, 'o'},
+        {"output-format", required_argument, NULL, 'O'},
+        {"workers", required_argument, NULL, 'p'},
+        {"sample", required_argument, NULL, 'S'},
+        {"seed", required_argument, NULL, 'r'},
+        {"sample-error", required_argument, NULL, 'E'},
+        {"threads", required_argument, NULL, 't'},
+        {"max-level", required_argument, NULL, 'l'},
+        {"itemsets", required_argument, NULL, 'i'},
+        {"engine", required_argument, NULL, 'e'},
+        {"counting", required_argument, NULL, 'c'},
+        {"kernel", required_argument, NULL, 'k'},
+        {"metrics", required_argument, NULL, 'M'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    InputFormat format = FORMAT_CSV;
+    const char *cachePath = NULL;
+    size_t memoryBudget = 0;
+    const char *statePath = NULL;
+    int numWorkers = 0;
+    int sampleRows = 0;
+    uint64_t seed = 1;
+    double sampleError = DEFAULT_SAMPLE_ERROR;
+    const char *outputPath = NULL;
+    OutputFormat outputFormat = OUTPUT_TEXT;
+    const char *metricsPath = NULL;
+    MiningOptions options;
+    initMiningOptions(&options);
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:w:m:s:o:O:p:S:r:E:t:l:i:e:c:k:M:h", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'f':
+                if (strcmp(optarg, "csv") == 0) {
+                    format = FORMAT_CSV;
+                } else if (strcmp(optarg, "basket") == 0) {
+                    format = FORMAT_BASKET;
+                } else if (strcmp(optarg, "cache") == 0) {
+                    format = FORMAT_CACHE;
+                } else {
+                    fprintf(stderr, "Unknown input format \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'w':
+                cachePath = optarg;
+                break;
+            case 'm': {
+                char *end;
+                double megabytes = strtod(optarg, &end);
+                if (*end != '\0' || megabytes <= 0) {
+                    fprintf(stderr, "Invalid memory budget \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                memoryBudget = megabytes * (1 << 20);
+                break;
+            }
+            case 's':
+                statePath = optarg;
+                break;
+            case 'o':
+                outputPath = optarg;
+                break;
+            case 'O':
+                if (!parseOutputFormat(optarg, &outputFormat)) {
+                    fprintf(stderr, "Unknown output format \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'p': {
+                char *end;
+                long workers = strtol(optarg, &end, 10);
+                if (*end != '\0' || workers < 1 || workers > 1024) {
+                    fprintf(stderr, "Invalid number of workers \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                numWorkers = workers;
+                break;
+            }
+            case 'S': {
+                char *end;
+                long rows = strtol(optarg, &end, 10);
+                if (*end != '\0' || rows < 1 || rows > INT32_MAX) {
+                    fprintf(stderr, "Invalid sample size \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                sampleRows = rows;
+                break;
+            }
+            case 'r': {
+                char *end;
+                seed = strtoull(optarg, &end, 10);
+                if (*end != '\0') {
+                    fprintf(stderr, "Invalid seed \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'E': {
+                char *end;
+                sampleError = strtod(optarg, &end);
+                if (*end != '\0' || !(sampleError > 0 && sampleError < 1)) {
+                    fprintf(stderr, "Invalid sample error \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 't': {
+                char *end;
+                long threads = strtol(optarg, &end, 10);
+                if (*end != '\0' || threads < 1 || threads > 4096) {
+                    fprintf(stderr, "Invalid number of threads \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                options.numThreads = threads;
+                break;
+            }
+            case 'l': {
+                char *end;
+                long maxLevel = strtol(optarg, &end, 10);
+                if (*end != '\0' || maxLevel < 1 || maxLevel > INT32_MAX) {
+                    fprintf(stderr, "Invalid maximum level \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                options.maxLevel = maxLevel;
+                break;
+            }
+            case 'i':
+                if (strcmp(optarg, "all") == 0) {
+                    options.itemSetMode = ITEMSETS_ALL;
+                } else if (strcmp(optarg, "closed") == 0) {
+                    options.itemSetMode = ITEMSETS_CLOSED;
+                } else if (strcmp(optarg, "maximal") == 0) {
+                    options.itemSetMode = ITEMSETS_MAXIMAL;
+                } else {
+                    fprintf(stderr, "Unknown item set mode \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'e':
+                if (strcmp(optarg, "apriori") == 0) {
+                    options.engine = ENGINE_APRIORI;
+                } else if (strcmp(optarg, "eclat") == 0) {
+                    options.engine = ENGINE_ECLAT;
+                } else if (strcmp(optarg, "fpgrowth") == 0) {
+                    options.engine = ENGINE_FPGROWTH;
+                } else {
+                    fprintf(stderr, "Unknown engine \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'c':
+                if (strcmp(optarg, "bitset") == 0) {
+                    options.counting = COUNTING_BITSET;
+                } else if (strcmp(optarg, "trie") == 0) {
+                    options.counting = COUNTING_TRIE;
+                } else if (strcmp(optarg, "tiled") == 0) {
+                    options.counting = COUNTING_TILED;
+                } else {
+                    fprintf(stderr, "Unknown counting mode \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'k': {
+                KernelType kernel;
+                if (!parseKernelType(optarg, &kernel)) {
+                    fprintf(stderr, "Unknown kernel \"%s\".\n", optarg);
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                if (!selectKernel(kernel)) {
+                    fprintf(stderr, "The %s kernel is not supported by this CPU.\n", kernelName(kernel));
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'M':
+#ifndef USE_METRICS
+                fprintf(stderr, "This build has no instrumentation. Rebuild with make METRICS=1 to use --metrics.\n");
+                exit(EXIT_FAILURE);
+#endif
+                metricsPath = optarg;
+                break;
+            case 'h':
+                printUsage(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                printUsage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    int numArgs = argc - optind;
+    char **args = argv + optind;
+
     // Read input arguments
-    if (argc != 2 && argc != 4) {
+    if (numArgs != 1 && numArgs != 3) {
         fprintf(stderr,
-                "Please provide an input csv file, a minimum support and a "
+                "Please provide an input file, a minimum support and a "
                 "minimum confidence.\n");
+        printUsage(argv[0]);
         exit(EXIT_FAILURE);
     }
 
+    if (cachePath) {
+        Timer timer;
+        startTime(&timer);
+        TableData *data = loadTable(format, args[0]);
+        if (!data || !writeDatasetCache(data, cachePath)) {
+            exit(EXIT_FAILURE);
+        }
+        freeTable(format, data);
+        stopTime(&timer);
+        printf("Wrote dataset cache %s in %lf sec.\n", cachePath, elapsedTime(timer));
+        return EXIT_SUCCESS;
+    }
+
     // Use some defaults
-    float minSupport = DEFAULT_MIN_SUPPORT;
-    float minConfidence = DEFAULT_MIN_CONFIDENCE;
-    if (argc == 4) {
-        minSupport = atof(argv[2]);
-        minConfidence = atof(argv[3]);
+    if (numArgs == 3) {
+        options.minSupport = atof(args[1]);
+        options.minConfidence = atof(args[2]);
     } else {
         fprintf(stderr,
                 "No minimum support and confidence provided; using defaults %.3lf "
                 "and %.1lf\n\n",
-                minSupport, minConfidence);
+                options.minSupport, options.minConfidence);
+    }
+    if (numWorkers > 0 && (options.engine != ENGINE_APRIORI || memoryBudget > 0)) {
+        fprintf(stderr, "Worker processes can only be used with the apriori engine and without a memory budget.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (memoryBudget > 0 && format != FORMAT_CSV) {
+        fprintf(stderr, "A memory budget can only be used with csv files.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (statePath && (format != FORMAT_CSV || memoryBudget > 0 || numWorkers > 0)) {
+        fprintf(stderr, "Incremental mining can only be used with csv files, without a memory budget or workers.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (sampleRows > 0 && (memoryBudget > 0 || numWorkers > 0 || statePath)) {
+        fprintf(stderr, "A sample can not be mined with a memory budget, workers or a state.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options.itemSetMode != ITEMSETS_ALL && (memoryBudget > 0 || numWorkers > 0 || statePath || sampleRows > 0)) {
+        fprintf(stderr,
+                "Closed and maximal item sets can not be mined with a memory budget, workers, a state or a sample.\n");
+        exit(EXIT_FAILURE);
+    }
+    OutputSink output;
+    if (!openOutputSink(&output, outputPath, outputFormat)) {
+        exit(EXIT_FAILURE);
+    }
+    if (metricsPath) {
+        enableMetrics();
     }
+    // The timings are only mixed with the results in the text format
+    FILE *info = outputFormat == OUTPUT_TEXT ? stdout : output.info;
+    if (memoryBudget > 0 || statePath) {
+        // Loading and mining are interleaved, so only the total time is reported
+        Timer timer;
+        startTime(&timer);
+        if (statePath) {
+            aprioriCSVIncremental(args[0], statePath, &options, &output);
+        } else {
+            aprioriCSVPartitioned(args[0], &options, memoryBudget, &output);
+        }
+        stopTime(&timer);
+        closeOutputSink(&output);
+        fprintf(info, "\nExecution took %lf sec.\n", elapsedTime(timer));
+        if (metricsPath && !writeMetricsReport(metricsPath)) {
+            exit(EXIT_FAILURE);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    Timer loadTimer;
+    startTime(&loadTimer);
+    PhaseTimer loadPhase;
+    startPhase(&loadPhase);
+    TableData *data = loadTable(format, args[0]);
+    endPhase(&loadPhase, PHASE_LOAD, 0);
+    stopTime(&loadTimer);
+    if (!data) {
+        closeOutputSink(&output);
+        exit(EXIT_FAILURE);
+    }
+
     Timer timer;
     startTime(&timer);
-    aprioriCSV(argv[1], minSupport, minConfidence);
+    if (numWorkers > 0) {
+        aprioriSharded(data, &options, numWorkers, &output);
+    } else if (sampleRows > 0) {
+        aprioriSampled(data, &options, sampleRows, seed, sampleError, &output);
+    } else {
+        apriori(data, &options, &output);
+    }
 
     stopTime(&timer);
-    printf("\nExecution took %lf sec.\n", elapsedTime(timer));
+    closeOutputSink(&output);
+    fprintf(info, "\nLoading took %lf sec.\n", elapsedTime(loadTimer));
+    fprintf(info, "Execution took %lf sec.\n", elapsedTime(timer));
+    freeTable(format, data);
+    if (metricsPath && !writeMetricsReport(metricsPath)) {
+        exit(EXIT_FAILURE);
+    }
 
     return EXIT_SUCCESS;
 }
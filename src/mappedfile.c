@@ -0,0 +1,76 @@
+#include "mappedfile.h"
+
+#include <fcntl.h>
+#include <omp.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+#define MIN_CHUNK_SIZE (1 << 20)  // Smallest number of bytes worth parsing in a separate chunk
+#define CHUNKS_PER_THREAD 4       // More chunks than threads, as lines can differ a lot in length
+
+int mapFile(const char *path, MappedFile *file) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        warning("Could not open the file at path: %s\n", path);
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        warning("The file at path %s is empty.\n", path);
+        close(fd);
+        return 0;
+    }
+    file->size = st.st_size;
+    void *map = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        warning("Could not map the file at path: %s\n", path);
+        return 0;
+    }
+    // The chunks are parsed in parallel, so there is no single sequential access pattern
+    madvise(map, file->size, MADV_WILLNEED);
+    file->start = map;
+    file->end = file->start + file->size;
+    return 1;
+}
+
+void unmapFile(MappedFile *file) {
+    munmap((void *)file->start, file->size);
+    file->start = NULL;
+    file->end = NULL;
+    file->size = 0;
+}
+
+void releaseRange(const char *start, const char *end) {
+    uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    uintptr_t first = ((uintptr_t)start + pageSize - 1) & ~(pageSize - 1);
+    uintptr_t last = (uintptr_t)end & ~(pageSize - 1);
+    if (first < last) {
+        madvise((void *)first, last - first, MADV_DONTNEED);
+    }
+}
+
+int splitLines(const char *start, const char *end, const char ***chunkStart) {
+    size_t size = end - start;
+    size_t maxChunks = (size_t)omp_get_max_threads() * CHUNKS_PER_THREAD;
+    int numChunks = size / MIN_CHUNK_SIZE < maxChunks ? size / MIN_CHUNK_SIZE + 1 : maxChunks;
+    const char **chunks = safeMalloc((numChunks + 1) * sizeof(char *));
+    chunks[0] = start;
+    for (int i = 1; i < numChunks; i++) {
+        const char *p = start + size * i / numChunks;
+        if (p < chunks[i - 1]) {
+            p = chunks[i - 1];
+        } else if (p[-1] != '\n') {
+            const char *newline = memchr(p, '\n', end - p);
+            p = newline ? newline + 1 : end;
+        }
+        chunks[i] = p;
+    }
+    chunks[numChunks] = end;
+    *chunkStart = chunks;
+    return numChunks;
+}
@@ -0,0 +1,73 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @brief A read-only memory mapping of a text file.
+ */
+typedef struct MappedFile {
+    const char *start;
+    const char *end;
+    size_t size;
+} MappedFile;
+
+/**
+ * @brief Maps a file into memory.
+ *
+ * @param path Path to the file.
+ * @param file The mapping will be written to this struct.
+ * @return int 1 if the file was mapped, 0 if it could not be opened, is empty or could not be mapped. A warning is
+ * printed in the latter case.
+ */
+int mapFile(const char *path, MappedFile *file);
+
+/**
+ * @brief Releases the mapping of a file. Pointers into the file are no longer valid afterwards.
+ *
+ * @param file The mapped file.
+ */
+void unmapFile(MappedFile *file);
+
+/**
+ * @brief Drops the pages of a range of a mapped file from memory. They are read from the file again if the range is
+ * accessed later. Only pages that lie entirely within the range are released.
+ *
+ * @param start Start of the range.
+ * @param end End of the range.
+ */
+void releaseRange(const char *start, const char *end);
+
+/**
+ * @brief Splits a range of a text file into chunks of roughly equal size that each start at the beginning of a line.
+ * The number of chunks depends on the size of the range and the number of threads.
+ *
+ * @param start Start of the range. Must be the start of a line.
+ * @param end End of the range.
+ * @param chunkStart Array of numChunks + 1 chunk boundaries will be written to this pointer. The last boundary is end.
+ * Must be freed by the caller.
+ * @return int The number of chunks. At least 1.
+ */
+int splitLines(const char *start, const char *end, const char ***chunkStart);
+
+/**
+ * @brief Finds the end of the line starting at the provided position. A carriage return before the newline is not
+ * considered part of the line.
+ *
+ * @param line Start of the line.
+ * @param end End of the mapped data.
+ * @param next The start of the next line will be written to this pointer.
+ * @return const char* End of the content of the line, excluding the line terminator.
+ */
+static inline const char *findLineEnd(const char *line, const char *end, const char **next) {
+    const char *newline = memchr(line, '\n', end - line);
+    const char *lineEnd = newline ? newline : end;
+    *next = newline ? newline + 1 : end;
+    if (lineEnd > line && lineEnd[-1] == '\r') {
+        lineEnd--;
+    }
+    return lineEnd;
+}
+
+#endif  // MAPPEDFILE_H
@@ -0,0 +1,228 @@
+#include "metrics.h"
+
+#include "utils.h"
+
+#ifdef USE_METRICS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#define METRICS_MAX_LEVELS 128  // Larger levels are recorded as the last level
+
+static const char *phaseNames[NUM_PHASES] = {"load", "index", "mine", "join", "subsetCheck", "count", "rules",
+                                             "output"};
+
+/**
+ * @brief Times of a phase at a single level.
+ */
+typedef struct PhaseMetrics {
+    double wallSec;
+    double cpuSec;  // CPU time of the whole process, i.e. of all threads
+} PhaseMetrics;
+
+/**
+ * @brief Candidate counts of a level. Every generated candidate is either pruned or frequent.
+ */
+typedef struct LevelMetrics {
+    long long generated;
+    long long prunedBySubset;   // Has a subset that is not frequent
+    long long prunedBySupport;  // Counted, but not frequent
+    long long frequent;
+} LevelMetrics;
+
+int metricsEnabled = 0;
+MetricThread metricThreads[METRICS_MAX_THREADS];
+
+static PhaseTimer runStart;
+static PhaseMetrics phases[METRICS_MAX_LEVELS][NUM_PHASES];
+static LevelMetrics levels[METRICS_MAX_LEVELS];
+static double *threadBusy;  // [level][phase][thread]
+static size_t mapEntries;
+static size_t mapSlots;
+
+static inline int levelIndex(int level) {
+    return level < 0 ? 0 : level < METRICS_MAX_LEVELS ? level : METRICS_MAX_LEVELS - 1;
+}
+
+static inline double *busySlot(int level, MetricPhase phase, int thread) {
+    return &threadBusy[((size_t)levelIndex(level) * NUM_PHASES + phase) * METRICS_MAX_THREADS +
+                       thread % METRICS_MAX_THREADS];
+}
+
+double metricsWallClock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double metricsCpuClock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void recordPhase(const PhaseTimer *timer, MetricPhase phase, int level) {
+    PhaseMetrics *metrics = &phases[levelIndex(level)][phase];
+    double wall = metricsWallClock() - timer->wall;
+    double cpu = metricsCpuClock() - timer->cpu;
+    #pragma omp atomic
+    metrics->wallSec += wall;
+    #pragma omp atomic
+    metrics->cpuSec += cpu;
+}
+
+void recordThreadBusy(MetricPhase phase, int level, double seconds) {
+    double *busy = busySlot(level, phase, omp_get_thread_num());
+    #pragma omp atomic
+    *busy += seconds;
+}
+
+void recordCandidates(int level, long long generated, long long prunedBySubset, long long prunedBySupport) {
+    LevelMetrics *metrics = &levels[levelIndex(level)];
+    #pragma omp atomic
+    metrics->generated += generated;
+    #pragma omp atomic
+    metrics->prunedBySubset += prunedBySubset;
+    #pragma omp atomic
+    metrics->prunedBySupport += prunedBySupport;
+}
+
+void recordFrequent(int level, long long numSets) {
+    #pragma omp atomic
+    levels[levelIndex(level)].frequent += numSets;
+}
+
+void recordMapUsage(size_t entries, size_t slots) {
+    // Runs that mine in several passes, such as partitioned runs, report their largest map
+    if (slots > mapSlots) {
+        mapEntries = entries;
+        mapSlots = slots;
+    }
+}
+
+void enableMetrics(void) {
+    if (!threadBusy) {
+        threadBusy = safeCalloc((size_t)METRICS_MAX_LEVELS * NUM_PHASES * METRICS_MAX_THREADS, sizeof(double));
+    }
+    metricsEnabled = 1;
+    runStart.wall = metricsWallClock();
+    runStart.cpu = metricsCpuClock();
+}
+
+/**
+ * @brief Writes the times of a phase: at a single level, or summed over all levels if level is -1. Returns 0 without
+ * writing anything if the phase was not recorded there.
+ */
+static int writePhase(FILE *file, MetricPhase phase, int level, int numThreads, int first) {
+    int from = level < 0 ? 0 : level, to = level < 0 ? METRICS_MAX_LEVELS - 1 : level;
+    double wall = 0, cpu = 0, total = 0, max = 0;
+    double busy[METRICS_MAX_THREADS] = {0};
+    for (int l = from; l <= to; l++) {
+        wall += phases[l][phase].wallSec;
+        cpu += phases[l][phase].cpuSec;
+        for (int t = 0; t < numThreads; t++) {
+            busy[t] += *busySlot(l, phase, t);
+        }
+    }
+    for (int t = 0; t < numThreads; t++) {
+        total += busy[t];
+        max = busy[t] > max ? busy[t] : max;
+    }
+    if (wall == 0 && total == 0) {
+        return 0;
+    }
+    fprintf(file, "%s\n    {\"phase\": \"%s\", ", first ? "" : ",", phaseNames[phase]);
+    if (level >= 0) {
+        fprintf(file, "\"level\": %d, ", level);
+    }
+    fprintf(file, "\"wallSec\": %.6f, \"cpuSec\": %.6f", wall, cpu);
+    if (total > 0) {
+        // The imbalance is the busiest thread relative to the average thread; 1 is a perfect balance
+        fprintf(file, ", \"threadSec\": %.6f, \"imbalance\": %.3f, \"busySec\": [", total, max * numThreads / total);
+        for (int t = 0; t < numThreads; t++) {
+            fprintf(file, t ? ", %.6f" : "%.6f", busy[t]);
+        }
+        fputc(']', file);
+    }
+    fputc('}', file);
+    return 1;
+}
+
+int writeMetricsReport(const char *path) {
+    if (!metricsEnabled) {
+        return 0;
+    }
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        warning("Could not write the metrics report to path: %s\n", path);
+        return 0;
+    }
+    double wall = metricsWallClock() - runStart.wall;
+    double cpu = metricsCpuClock() - runStart.cpu;
+    struct rusage self, children;
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+    int numThreads = omp_get_max_threads();
+    numThreads = numThreads < METRICS_MAX_THREADS ? numThreads : METRICS_MAX_THREADS;
+
+    fprintf(file, "{\n  \"wallSec\": %.6f,\n  \"cpuSec\": %.6f,\n  \"threads\": %d,\n  \"peakRssKb\": %ld,\n", wall, cpu,
+            numThreads, self.ru_maxrss);
+    if (children.ru_maxrss > 0) {
+        // Shard workers are separate processes
+        fprintf(file, "  \"peakChildRssKb\": %ld,\n", children.ru_maxrss);
+    }
+    fputs("  \"phaseTotals\": [", file);
+    int first = 1;
+    for (int p = 0; p < NUM_PHASES; p++) {
+        first &= !writePhase(file, p, -1, numThreads, first);
+    }
+    fputs("\n  ],\n  \"phases\": [", file);
+    first = 1;
+    for (int l = 0; l < METRICS_MAX_LEVELS; l++) {
+        for (int p = 0; p < NUM_PHASES; p++) {
+            first &= !writePhase(file, p, l, numThreads, first);
+        }
+    }
+    fputs("\n  ],\n  \"levels\": [", file);
+    first = 1;
+    for (int l = 1; l < METRICS_MAX_LEVELS; l++) {
+        const LevelMetrics *level = &levels[l];
+        if (level->generated == 0 && level->frequent == 0) {
+            continue;
+        }
+        fprintf(file,
+                "%s\n    {\"level\": %d, \"candidates\": %lld, \"prunedBySubset\": %lld, \"prunedBySupport\": %lld, "
+                "\"frequent\": %lld}",
+                first ? "" : ",", l, level->generated, level->prunedBySubset, level->prunedBySupport, level->frequent);
+        first = 0;
+    }
+    long long lookups = 0, inserts = 0, probes = 0;
+    for (int t = 0; t < METRICS_MAX_THREADS; t++) {
+        lookups += metricThreads[t].mapLookups;
+        inserts += metricThreads[t].mapInserts;
+        probes += metricThreads[t].mapProbes;
+    }
+    fprintf(file,
+            "\n  ],\n  \"supportMap\": {\"lookups\": %lld, \"inserts\": %lld, \"probes\": %lld, "
+            "\"probesPerAccess\": %.3f, \"entries\": %zu, \"slots\": %zu, \"load\": %.3f}\n}\n",
+            lookups, inserts, probes, lookups + inserts ? (double)probes / (lookups + inserts) : 0, mapEntries,
+            mapSlots, mapSlots ? (double)mapEntries / mapSlots : 0);
+    if (fclose(file) != 0) {
+        warning("Could not write the metrics report to path: %s\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+#else
+
+void enableMetrics(void) {}
+
+int writeMetricsReport(const char *path) {
+    warning("Could not write the metrics report to %s: apriori was built without USE_METRICS.\n", path);
+    return 0;
+}
+
+#endif  // USE_METRICS
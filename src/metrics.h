@@ -0,0 +1,173 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+
+/**
+ * Built-in instrumentation of a mining run: wall and CPU time per phase and per level, the number of candidates that
+ * are generated and pruned, the probes of the support map, the busy time of every thread and the peak memory.
+ *
+ * The instrumentation is only compiled in when USE_METRICS is defined (make METRICS=1). Otherwise all functions below
+ * are empty inline functions that the compiler removes, so regular builds pay nothing. Metrics builds only record once
+ * enableMetrics has been called, and then write everything with writeMetricsReport. The counters are global to the
+ * process, so runs must not overlap while metrics are enabled.
+ */
+
+/**
+ * @brief Phases of a mining run. Phases can be nested: mine holds the others, except for load and output. The subset
+ * checks, and the counting with COUNTING_BITSET, run interleaved with join, so these only have thread times.
+ */
+typedef enum MetricPhase {
+    PHASE_LOAD,          // Parsing the input
+    PHASE_INDEX,         // Building the bitsets or the transaction list that the supports are counted on
+    PHASE_MINE,          // Mining the frequent item sets, with any engine
+    PHASE_JOIN,          // Generating the candidates of a level from the previous level
+    PHASE_SUBSET_CHECK,  // Looking up the subsets of candidates in the support map
+    PHASE_COUNT,         // Counting the supports of candidates
+    PHASE_RULES,         // Generating the association rules of a level
+    PHASE_OUTPUT,        // Writing the frequent item sets and rules
+    NUM_PHASES,
+} MetricPhase;
+
+/**
+ * @brief Start of a timed phase.
+ */
+typedef struct PhaseTimer {
+    double wall;
+    double cpu;
+} PhaseTimer;
+
+/**
+ * @brief Starts recording and marks the start of the run that the total times are measured from. Does nothing without
+ * USE_METRICS.
+ */
+void enableMetrics(void);
+
+/**
+ * @brief Writes everything recorded since enableMetrics as a JSON report. Without USE_METRICS, only a warning is
+ * printed.
+ *
+ * @param path Path of the report.
+ * @return int 1 on success, 0 if the report could not be written. A warning is printed in the latter case.
+ */
+int writeMetricsReport(const char *path);
+
+#ifdef USE_METRICS
+
+#include <omp.h>
+
+#define METRICS_MAX_THREADS 256  // Threads beyond this share the counters of a lower thread
+
+/**
+ * @brief Counters of a single thread, on a cache line of their own.
+ */
+typedef struct MetricThread {
+    long long mapLookups;
+    long long mapInserts;
+    long long mapProbes;
+} __attribute__((aligned(64))) MetricThread;
+
+extern int metricsEnabled;
+extern MetricThread metricThreads[METRICS_MAX_THREADS];
+
+double metricsWallClock(void);
+double metricsCpuClock(void);
+void recordPhase(const PhaseTimer *timer, MetricPhase phase, int level);
+void recordThreadBusy(MetricPhase phase, int level, double seconds);
+void recordCandidates(int level, long long generated, long long prunedBySubset, long long prunedBySupport);
+void recordFrequent(int level, long long numSets);
+void recordMapUsage(size_t entries, size_t slots);
+
+static inline void startPhase(PhaseTimer *timer) {
+    if (metricsEnabled) {
+        timer->wall = metricsWallClock();
+        timer->cpu = metricsCpuClock();
+    }
+}
+
+static inline void endPhase(const PhaseTimer *timer, MetricPhase phase, int level) {
+    if (metricsEnabled) {
+        recordPhase(timer, phase, level);
+    }
+}
+
+/**
+ * @brief Returns the wall clock in seconds to measure the busy time of a thread with, or 0 when metrics are disabled.
+ */
+static inline double busyClock(void) { return metricsEnabled ? metricsWallClock() : 0; }
+
+/**
+ * @brief Adds the busy time of the calling thread in a phase of a level.
+ */
+static inline void addThreadBusy(MetricPhase phase, int level, double seconds) {
+    if (metricsEnabled) {
+        recordThreadBusy(phase, level, seconds);
+    }
+}
+
+static inline void addCandidates(int level, long long generated, long long prunedBySubset, long long prunedBySupport) {
+    if (metricsEnabled) {
+        recordCandidates(level, generated, prunedBySubset, prunedBySupport);
+    }
+}
+
+static inline void addFrequent(int level, long long numSets) {
+    if (metricsEnabled) {
+        recordFrequent(level, numSets);
+    }
+}
+
+/**
+ * @brief Counts a lookup or an insert of the support map and the number of slots it probed.
+ */
+static inline void countMapAccess(int insert, int probes) {
+    if (metricsEnabled) {
+        MetricThread *thread = &metricThreads[omp_get_thread_num() % METRICS_MAX_THREADS];
+        thread->mapLookups += !insert;
+        thread->mapInserts += insert;
+        thread->mapProbes += probes;
+    }
+}
+
+static inline void addMapUsage(size_t entries, size_t slots) {
+    if (metricsEnabled) {
+        recordMapUsage(entries, slots);
+    }
+}
+
+#else
+
+static inline void startPhase(PhaseTimer *timer) { (void)timer; }
+static inline void endPhase(const PhaseTimer *timer, MetricPhase phase, int level) {
+    (void)timer;
+    (void)phase;
+    (void)level;
+}
+static inline double busyClock(void) { return 0; }
+static inline void addThreadBusy(MetricPhase phase, int level, double seconds) {
+    (void)phase;
+    (void)level;
+    (void)seconds;
+}
+static inline void addCandidates(int level, long long generated, long long prunedBySubset, long long prunedBySupport) {
+    (void)level;
+    (void)generated;
+    (void)prunedBySubset;
+    (void)prunedBySupport;
+}
+static inline void addFrequent(int level, long long numSets) {
+    (void)level;
+    (void)numSets;
+}
+static inline void countMapAccess(int insert, int probes) {
+    (void)insert;
+    (void)probes;
+}
+static inline void addMapUsage(size_t entries, size_t slots) {
+    (void)entries;
+    (void)slots;
+}
+
+#endif  // USE_METRICS
+
+#endif  // METRICS_H
@@ -0,0 +1,188 @@
+#define _GNU_SOURCE  // qsort_r
+#include "mining.h"
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "table.h"
+#include "utils.h"
+
+LevelSets *createLevelSets(Arena *arena, int numSets, int setSize) {
+    LevelSets *levelSet = arenaAlloc(arena, sizeof(LevelSets));
+    levelSet->sets = arenaAlloc(arena, numSets * sizeof(int *));
+    int *p = arenaAlloc(arena, (size_t)numSets * setSize * sizeof(int));
+    for (int i = 0; i < numSets; i++) {
+        levelSet->sets[i] = p + (size_t)setSize * i;
+    }
+    levelSet->numSets = numSets;
+    levelSet->setSize = setSize;
+    return levelSet;
+}
+
+void appendCandidate(CandidateBuffer *buffer, const int *set, int setSize) {
+    if (buffer->numSets == buffer->capacity) {
+        buffer->capacity = buffer->capacity ? 2 * buffer->capacity : 64;
+        buffer->sets = realloc(buffer->sets, (size_t)buffer->capacity * setSize * sizeof(int));
+        if (!buffer->sets) {
+            fatalError("Failed to grow the candidate buffer to %d sets.\n", buffer->capacity);
+        }
+    }
+    memcpy(buffer->sets + (size_t)buffer->numSets * setSize, set, setSize * sizeof(int));
+    buffer->numSets++;
+}
+
+void appendToLevel(LevelBuffers *buffers, const int *set, int setSize) {
+    if (setSize > buffers->numLevels) {
+        buffers->levels = realloc(buffers->levels, setSize * sizeof(CandidateBuffer));
+        if (!buffers->levels) {
+            fatalError("Failed to grow the level buffers to %d levels.\n", setSize);
+        }
+        memset(buffers->levels + buffers->numLevels, 0, (setSize - buffers->numLevels) * sizeof(CandidateBuffer));
+        buffers->numLevels = setSize;
+    }
+    appendCandidate(&buffers->levels[setSize - 1], set, setSize);
+}
+
+void generateCandidates(const LevelSets *level, const ItemsetMap *supports, CandidateBuffer *candidates) {
+    int k = level->setSize;
+    int candidate[k + 1];
+    int subset[k];
+    for (int i = 0; i < level->numSets; i++) {
+        const int *a = level->sets[i];
+        for (int j = i + 1; j < level->numSets && memcmp(a, level->sets[j], (k - 1) * sizeof(int)) == 0; j++) {
+            memcpy(candidate, a, k * sizeof(int));
+            candidate[k] = level->sets[j][k - 1];
+            // The subsets without one of the last two items are a and level->sets[j] themselves
+            int allFrequent = 1;
+            for (int skip = 0; skip < k - 1 && allFrequent; skip++) {
+                memcpy(subset, candidate, skip * sizeof(int));
+                memcpy(subset + skip, candidate + skip + 1, (k - skip) * sizeof(int));
+                allFrequent = itemsetMapGet(supports, subset, k) >= 0;
+            }
+            if (allFrequent) {
+                appendCandidate(candidates, candidate, k + 1);
+            }
+        }
+    }
+}
+
+static int compareSets(const void *a, const void *b, void *setSize) {
+    const int *setA = *(int *const *)a;
+    const int *setB = *(int *const *)b;
+    for (int i = 0; i < *(int *)setSize; i++) {
+        if (setA[i] != setB[i]) {
+            return setA[i] < setB[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+LevelSets *mergeSortedLevelSet(Arena *arena, const CandidateBuffer *const *buffers, int numBuffers, int setSize) {
+    int numSets = 0;
+    for (int b = 0; b < numBuffers; b++) {
+        numSets += buffers[b]->numSets;
+    }
+    if (numSets == 0) {
+        return NULL;
+    }
+    // Sort pointers into the buffers, then copy the sets over in sorted order
+    int **order = safeMalloc(numSets * sizeof(int *));
+    int idx = 0;
+    for (int b = 0; b < numBuffers; b++) {
+        for (int i = 0; i < buffers[b]->numSets; i++) {
+            order[idx++] = buffers[b]->sets + (size_t)i * setSize;
+        }
+    }
+    qsort_r(order, numSets, sizeof(int *), compareSets, &setSize);
+
+    LevelSets *levelSet = createLevelSets(arena, numSets, setSize);
+    for (int i = 0; i < numSets; i++) {
+        memcpy(levelSet->sets[i], order[i], setSize * sizeof(int));
+    }
+    free(order);
+    return levelSet;
+}
+
+LevelSets **gatherLevelSets(const MiningContext *ctx, LevelSets *level1, LevelBuffers *buffers, int numThreads,
+                            int *finalLevel) {
+    Arena *arena = ctx->arena;
+    int numLevels = 1;
+    for (int t = 0; t < numThreads; t++) {
+        numLevels = buffers[t].numLevels > numLevels ? buffers[t].numLevels : numLevels;
+    }
+    LevelSets **sets = arenaAlloc(arena, numLevels * sizeof(LevelSets *));
+    sets[0] = level1;
+    printLevelSize(ctx, 1, level1->numSets);
+
+    static const CandidateBuffer empty = {NULL, 0, 0};
+    const CandidateBuffer **levelBuffers = safeMalloc(numThreads * sizeof(CandidateBuffer *));
+    int level = 1;
+    for (int l = 1; l < numLevels; l++) {
+        for (int t = 0; t < numThreads; t++) {
+            levelBuffers[t] = l < buffers[t].numLevels ? &buffers[t].levels[l] : &empty;
+        }
+        // Only the closed and maximal modes can skip a size; the levels in between are left empty
+        sets[l] = mergeSortedLevelSet(arena, levelBuffers, numThreads, l + 1);
+        if (!sets[l]) {
+            sets[l] = createLevelSets(arena, 0, l + 1);
+        } else {
+            level = l + 1;
+        }
+    }
+    for (int l = 1; l < level; l++) {
+        printLevelSize(ctx, l + 1, sets[l]->numSets);
+    }
+    free(levelBuffers);
+    for (int t = 0; t < numThreads; t++) {
+        for (int l = 0; l < buffers[t].numLevels; l++) {
+            free(buffers[t].levels[l].sets);
+        }
+        free(buffers[t].levels);
+    }
+    free(buffers);
+    *finalLevel = level;
+    return sets;
+}
+
+void countItemSupports(const TableData *data, int *supports) {
+    if (data->itemSupports) {
+        memcpy(supports, data->itemSupports, data->numCols * sizeof(int));
+        return;
+    }
+    memset(supports, 0, data->numCols * sizeof(int));
+    int numThreads = omp_get_max_threads();
+    #pragma omp parallel
+    {
+        int *rowBuffer = safeMalloc(data->numCols * sizeof(int));
+        #pragma omp for schedule(static)
+        for (int y = 0; y < data->numRows; y++) {
+            int rowSize;
+            const int *row = tableRowItems(data, y, rowBuffer, &rowSize);
+            for (int i = 0; i < rowSize; i++) {
+                if (numThreads == 1) {
+                    supports[row[i]]++;
+                } else {
+                    #pragma omp atomic
+                    supports[row[i]]++;
+                }
+            }
+        }
+        free(rowBuffer);
+    }
+}
+
+void printLevelSize(const MiningContext *ctx, int level, int numSets) {
+    if (!ctx->quiet) {
+        fprintf(ctx->output->info, "Size of large itemsets l(%d) %d\n", level, numSets);
+    }
+}
+
+int setMiningThreads(int numThreads) {
+    int previous = omp_get_max_threads();
+    if (numThreads > 0) {
+        omp_set_num_threads(numThreads);
+    }
+    return previous;
+}
@@ -0,0 +1,220 @@
+#ifndef MINING_H
+#define MINING_H
+
+#include "apriori.h"
+#include "arena.h"
+#include "bitset.h"
+#include "itemsetmap.h"
+#include "output.h"
+#include "shards.h"
+#include "transactions.h"
+
+#define ARENA_CHUNK_SIZE (1 << 20)  // Size of the chunks the level sets are allocated from
+
+/**
+ * @brief Struct that describes item sets at a particular level k.
+ */
+typedef struct LevelSets {
+    int **sets;
+    int numSets;
+    int setSize;
+} LevelSets;
+
+/**
+ * @brief Struct that holds the data representations used while mining frequent item sets.
+ */
+typedef struct MiningContext {
+    const TableData *data;
+    BitsetTable *bitsets;  // Bitsets of the frequent items or the prebuilt ones of data. NULL if they are not used.
+    ItemsetMap *supports;  // Support of every frequent item set found so far
+    CountingMode counting;
+    TransactionList *transactions;  // Frequent items of every transaction. Only built for COUNTING_TRIE.
+    BitsetTiles *tiles;             // Row tiles of the bitsets of the frequent items. Only built for COUNTING_TILED.
+    Arena *arena;                   // Storage of the level sets. Only allocated from outside parallel regions.
+    int quiet;                      // Do not print the sizes of the levels, e.g. while mining a partition
+    ShardPool *shards;              // Worker processes that count the candidates. NULL to count in this process.
+    const OutputSink *output;       // Destination of the results and of the sizes of the levels
+    int maxLevel;                   // Size of the largest item sets to mine. 0 for no limit.
+    ItemSetMode itemSetMode;        // Which frequent item sets to mine. Only ITEMSETS_ALL stores every subset.
+} MiningContext;
+
+/**
+ * @brief Growable buffer of item sets of a fixed size. Every thread of a parallel mining step collects its item sets in
+ * its own buffer.
+ */
+typedef struct CandidateBuffer {
+    int *sets;
+    int numSets;
+    int capacity;
+} CandidateBuffer;
+
+/**
+ * @brief The frequent item sets found by a single thread of a depth-first mining engine, with a buffer per set size.
+ */
+typedef struct LevelBuffers {
+    CandidateBuffer *levels;  // levels[k - 1] holds the sets of size k
+    int numLevels;
+} LevelBuffers;
+
+/**
+ * @brief Allocates an empty level set, including room for its sets, from an arena.
+ *
+ * @param arena The arena to allocate from.
+ * @param numSets Number of sets the level set should have room for.
+ * @param setSize Number of elements in every set.
+ * @return LevelSets* The level set, with numSets set to the provided value.
+ */
+LevelSets *createLevelSets(Arena *arena, int numSets, int setSize);
+
+/**
+ * @brief Appends a set to a candidate buffer.
+ *
+ * @param buffer The buffer to append to.
+ * @param set The set to append.
+ * @param setSize Number of elements in the set. Must be the same for all sets in the buffer.
+ */
+void appendCandidate(CandidateBuffer *buffer, const int *set, int setSize);
+
+/**
+ * @brief Appends a set to the buffer of its size.
+ *
+ * @param buffers The level buffers to append to.
+ * @param set The set to append.
+ * @param setSize Number of elements in the set.
+ */
+void appendToLevel(LevelBuffers *buffers, const int *set, int setSize);
+
+/**
+ * @brief Generates the candidates of the next level from the frequent item sets of a level: every pair of sets that
+ * shares all but its last item is joined, and the result is kept if all of its subsets are frequent.
+ *
+ * @param level The frequent item sets of the level, sorted lexicographically.
+ * @param supports Contains every frequent item set found so far.
+ * @param candidates The candidates are appended to this buffer, in lexicographic order.
+ */
+void generateCandidates(const LevelSets *level, const ItemsetMap *supports, CandidateBuffer *candidates);
+
+/**
+ * @brief Gathers the sets of a number of candidate buffers into a single, lexicographically sorted level set.
+ *
+ * @param arena The arena to allocate the level set from.
+ * @param buffers The buffers to gather. Their memory is not released.
+ * @param numBuffers Number of buffers.
+ * @param setSize Number of elements in every set.
+ * @return LevelSets* The sorted level set. NULL if the buffers contain no sets.
+ */
+LevelSets *mergeSortedLevelSet(Arena *arena, const CandidateBuffer *const *buffers, int numBuffers, int setSize);
+
+/**
+ * @brief Turns the per-thread level buffers of a depth-first mining engine into sorted level sets and prints the size of
+ * every level. The buffers are freed.
+ *
+ * @param ctx Mining context to allocate the level sets from.
+ * @param level1 The level set at level 1.
+ * @param buffers Level buffers of every thread. The buffers of level 1 are not used.
+ * @param numThreads Number of threads that filled the buffers.
+ * @param finalLevel The number of level sets generated will be written to this pointer.
+ * @return LevelSets** Provides for each of the finalLevel levels a number of sorted sets. Levels below the largest
+ * non-empty level are empty if no thread found a set of their size.
+ */
+LevelSets **gatherLevelSets(const MiningContext *ctx, LevelSets *level1, LevelBuffers *buffers, int numThreads, int *finalLevel);
+
+/**
+ * @brief Counts the support of every column of a table: taken from the supports stored with the table if it has them,
+ * and counted in a single scan over its rows otherwise.
+ *
+ * @param data The table.
+ * @param supports Output array with an entry per column.
+ */
+void countItemSupports(const TableData *data, int *supports);
+
+/**
+ * @brief Prints the number of frequent item sets found at a level, unless the context is quiet.
+ *
+ * @param ctx The mining context.
+ * @param level The level, equal to the size of its sets.
+ * @param numSets Number of frequent item sets at the level.
+ */
+void printLevelSize(const MiningContext *ctx, int level, int numSets);
+
+/**
+ * @brief Sets the number of OpenMP threads of the calling thread.
+ *
+ * @param numThreads Number of threads. 0 keeps the current number.
+ * @return int The previous number of threads, to restore it with another call.
+ */
+int setMiningThreads(int numThreads);
+
+// The functions below are implemented in apriori.c
+
+/**
+ * @brief Sets up a mining context for a table: an empty support map, an arena and the prebuilt bitsets of the table, if
+ * it has them. Otherwise the bitsets are only built while mining, for the frequent items and only if they are used.
+ *
+ * @param ctx The context to initialise.
+ * @param data The table to mine.
+ * @param counting The strategy used to count the supports of candidate item sets.
+ */
+void initMiningContext(MiningContext *ctx, const TableData *data, CountingMode counting);
+
+/**
+ * @brief Frees everything a mining context owns, including the level sets allocated from its arena. The supports and
+ * the arena may be set to NULL to hand them over to someone else first.
+ *
+ * @param ctx The context to free.
+ */
+void freeMiningContext(MiningContext *ctx);
+
+/**
+ * @brief Counts all pairs of frequent items in a single scan over the transactions and generates the level sets at level
+ * 2 from them. The counts are stored in an upper-triangular array with one entry per pair. Each thread counts a part of
+ * the transactions into its own array, after which the arrays are summed. If the per-thread arrays would not fit in
+ * TRIANGLE_MEMORY_BUDGET, a single shared array with atomic increments is used instead. The pairs are counted on the
+ * reduced transaction list of the context if it has one, and on the rows of the table otherwise. The supports of the
+ * frequent pairs are added to the support map of the context; the size of the level is not printed.
+ *
+ * @param levelSet1 Level set at level 1. The sets must be sorted.
+ * @param ctx Mining context containing the data to count the supports in.
+ * @param minSupportRows The minimum number of rows an item set must occur in for it to be added to the level set.
+ * @return LevelSets* The newly generated level sets at level 2, sorted. NULL if no frequent item sets were found.
+ */
+LevelSets *countPairs(const LevelSets *levelSet1, const MiningContext *ctx, int minSupportRows);
+
+/**
+ * @brief Mines the frequent item sets of the table of a context with the provided engine. Their supports are added to
+ * the support map of the context. The closed and maximal item set modes use their own search, regardless of the engine.
+ *
+ * @param finalLevel The number of level sets generated will be written to this pointer.
+ * @param ctx Mining context containing the data to count the supports in.
+ * @param engine The algorithm used to mine the frequent item sets.
+ * @param minSupportRows The minimum number of rows an item set must occur in to be frequent.
+ * @return LevelSets** Provides for each of the finalLevel levels the sorted sets that satisfy the minimum support.
+ */
+LevelSets **mineFrequentItemSets(int *finalLevel, MiningContext *ctx, MiningEngine engine, int minSupportRows);
+
+/**
+ * @brief Writes the results of a mining run to the output sink of the context: the frequent item sets with their
+ * supports, except in the text format, followed by the association rules that satisfy the minimum confidence. The
+ * supports map of the context is assumed to contain all supports of the to-be-calculated subsets of the level sets.
+ *
+ * @param sets The level sets. Provides for each of the n levels a number of sets that satisfy the minimum support
+ * criterion. At a given level k, the size of each set is k elements.
+ * @param n Number of level sets.
+ * @param ctx Mining context containing the column names, the supports of all frequent item sets and the output sink.
+ * @param minConfidence The minimum confidence that an association rule must have for it to be sent to the output.
+ */
+void writeMiningResults(LevelSets **sets, int n, const MiningContext *ctx, float minConfidence);
+
+/**
+ * @brief Formats the association rules of every item set of a level that satisfy the minimum confidence into an ordered
+ * output, in the format of the output sink of the context. The item sets are distributed over the threads, with a
+ * segment per item set.
+ *
+ * @param set The level set.
+ * @param ctx Mining context containing the column names, the supports of all frequent item sets and the output sink.
+ * @param minConfidence The minimum confidence that an association rule must have.
+ * @param output The ordered output to format the rules in. Previous output is discarded.
+ */
+void formatLevelRules(const LevelSets *set, const MiningContext *ctx, float minConfidence, OrderedOutput *output);
+
+#endif  // MINING_H
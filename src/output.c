@@ -0,0 +1,365 @@
+#define _GNU_SOURCE  // IOV_MAX
+#include "output.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <omp.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "utils.h"
+
+#define BINARY_MAGIC "APRRSLTS"
+#define BINARY_VERSION 1
+#define CSV_ITEM_SEPARATOR ';'  // Separates the items within a field of the CSV format
+
+/**
+ * @brief Header at the start of the binary format. Followed by the name of every item as a uint32_t length and the
+ * characters of the name. All records that follow are int32_t in the byte order of the writer.
+ */
+typedef struct BinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numItems;
+    uint64_t numRows;
+} BinaryHeader;
+
+int parseOutputFormat(const char *name, OutputFormat *format) {
+    static const char *names[] = {"text", "csv", "jsonl", "binary", "none"};
+    for (int f = OUTPUT_TEXT; f <= OUTPUT_NONE; f++) {
+        if (strcmp(name, names[f]) == 0) {
+            *format = f;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int openOutputSink(OutputSink *sink, const char *path, OutputFormat format) {
+    sink->format = format;
+    sink->file = stdout;
+    sink->ownsFile = 0;
+    if (path) {
+        sink->file = fopen(path, format == OUTPUT_BINARY ? "wb" : "w");
+        if (!sink->file) {
+            warning("Could not open the output file at path: %s\n", path);
+            return 0;
+        }
+        sink->ownsFile = 1;
+    }
+    if (format == OUTPUT_TEXT) {
+        sink->info = sink->file;
+    } else if (format == OUTPUT_NONE) {
+        sink->info = stdout;
+    } else {
+        sink->info = sink->file == stdout ? stderr : stdout;
+    }
+    return 1;
+}
+
+void closeOutputSink(OutputSink *sink) {
+    if (sink->ownsFile) {
+        if (fclose(sink->file) != 0) {
+            warning("Could not write the output file.\n");
+        }
+    } else {
+        fflush(sink->file);
+    }
+    sink->file = NULL;
+}
+
+/**
+ * @brief Appends raw bytes to a buffer, growing it if needed.
+ */
+static void appendBytes(OutputBuffer *buffer, const void *bytes, size_t size) {
+    if (buffer->length + size > buffer->capacity) {
+        buffer->capacity = 2 * (buffer->length + size);
+        buffer->data = realloc(buffer->data, buffer->capacity);
+        if (!buffer->data) {
+            fatalError("Failed to grow the output buffer to %zu bytes.\n", buffer->capacity);
+        }
+    }
+    memcpy(buffer->data + buffer->length, bytes, size);
+    buffer->length += size;
+}
+
+void appendText(OutputBuffer *buffer, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer->data + buffer->length, buffer->capacity - buffer->length, format, args);
+    va_end(args);
+    if (buffer->length + length >= buffer->capacity) {
+        buffer->capacity = 2 * (buffer->length + length + 1);
+        buffer->data = realloc(buffer->data, buffer->capacity);
+        if (!buffer->data) {
+            fatalError("Failed to grow the output buffer to %zu bytes.\n", buffer->capacity);
+        }
+        va_start(args, format);
+        vsnprintf(buffer->data + buffer->length, buffer->capacity - buffer->length, format, args);
+        va_end(args);
+    }
+    buffer->length += length;
+}
+
+void writeOutputHeader(const OutputSink *sink, const TableData *data) {
+    if (sink->format == OUTPUT_CSV) {
+        fputs("type,items,consequent,support,confidence,lift\n", sink->file);
+    } else if (sink->format == OUTPUT_BINARY) {
+        BinaryHeader header;
+        memset(&header, 0, sizeof(BinaryHeader));
+        memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+        header.version = BINARY_VERSION;
+        header.numItems = data->numCols;
+        header.numRows = data->numRows;
+        fwrite(&header, sizeof(BinaryHeader), 1, sink->file);
+        for (int c = 0; c < data->numCols; c++) {
+            uint32_t length = strlen(data->headers[c]);
+            fwrite(&length, sizeof(uint32_t), 1, sink->file);
+            fwrite(data->headers[c], 1, length, sink->file);
+        }
+    }
+}
+
+/**
+ * @brief Appends the names of a number of items as a single CSV field, separated by CSV_ITEM_SEPARATOR. The field is
+ * quoted if a name contains a character that has a meaning in CSV.
+ */
+static void appendCSVItems(OutputBuffer *out, const TableData *data, const int *items, int numItems) {
+    int quoted = 0;
+    for (int i = 0; i < numItems && !quoted; i++) {
+        quoted = strpbrk(data->headers[items[i]], ",\"\r\n") != NULL;
+    }
+    if (quoted) {
+        appendBytes(out, "\"", 1);
+    }
+    for (int i = 0; i < numItems; i++) {
+        if (i > 0) {
+            char separator = CSV_ITEM_SEPARATOR;
+            appendBytes(out, &separator, 1);
+        }
+        for (const char *c = data->headers[items[i]]; *c; c++) {
+            // A quote inside a quoted field is escaped by doubling it
+            appendBytes(out, *c == '"' ? "\"\"" : c, *c == '"' ? 2 : 1);
+        }
+    }
+    if (quoted) {
+        appendBytes(out, "\"", 1);
+    }
+}
+
+/**
+ * @brief Appends the names of a number of items as a JSON array of strings.
+ */
+static void appendJSONItems(OutputBuffer *out, const TableData *data, const int *items, int numItems) {
+    appendBytes(out, "[", 1);
+    for (int i = 0; i < numItems; i++) {
+        appendBytes(out, i > 0 ? ",\"" : "\"", i > 0 ? 2 : 1);
+        for (const unsigned char *c = (const unsigned char *)data->headers[items[i]]; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                char escaped[2] = {'\\', *c};
+                appendBytes(out, escaped, 2);
+            } else if (*c < 0x20) {
+                appendText(out, "\\u%04x", *c);
+            } else {
+                appendBytes(out, c, 1);
+            }
+        }
+        appendBytes(out, "\"", 1);
+    }
+    appendBytes(out, "]", 1);
+}
+
+void appendItemSet(OutputBuffer *out, const OutputSink *sink, const TableData *data, const int *set, int setSize,
+                   int support) {
+    switch (sink->format) {
+        case OUTPUT_CSV:
+            appendBytes(out, "itemset,", 8);
+            appendCSVItems(out, data, set, setSize);
+            appendText(out, ",,%d,,\n", support);
+            break;
+        case OUTPUT_JSONL:
+            appendText(out, "{\"type\":\"itemset\",\"items\":");
+            appendJSONItems(out, data, set, setSize);
+            appendText(out, ",\"support\":%d}\n", support);
+            break;
+        case OUTPUT_BINARY: {
+            int32_t record[3] = {BINARY_ITEMSET, setSize, support};
+            appendBytes(out, record, sizeof(record));
+            appendBytes(out, set, setSize * sizeof(int32_t));
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Formats an association rule in the format `{A,B,C} => {D} Confidence: 0.6`. Every association rule is
+ * alligned with the previous one.
+ *
+ * @param out The buffer to append the rule to.
+ * @param numItemsLeft Number of items in the antecedent. In the example of `{A,B,C} => {D}`, this would be 3.
+ * @param numItemsRight Number of items in the consequent. In the example of `{A,B,C} => {D}`, this would be 1.
+ * @param cols Columns in the complete set. In the example of `{A,B,C} => {D}`,, this set would contain {A, B, C, D}.
+ * @param data TableData* Table where each row signifies a transaction and each column a product. An entry in this table
+ * is either 1 or 0, depending on whether the product occured in the provided transacion.
+ * @param confidence The confidence value to print.
+ */
+static void appendTextRule(OutputBuffer *out, int numItemsLeft, int numItemsRight, const int *cols,
+                           const TableData *data, float confidence) {
+    // Both sides fit in a buffer that holds every header of the set, separated by ", ", and a closing brace
+    size_t bufferLen = 2;
+    for (int i = 0; i < numItemsLeft + numItemsRight; i++) {
+        bufferLen += strlen(data->headers[cols[i]]) + 2;
+    }
+    char buffer1[bufferLen];
+    char *curBuffer = buffer1;
+    for (int i = 0; i < numItemsLeft; i++) {
+        curBuffer += sprintf(curBuffer, "%s", data->headers[cols[i]]);
+        if (i != numItemsLeft - 1) {
+            curBuffer += sprintf(curBuffer, ", ");
+        }
+    }
+    curBuffer += sprintf(curBuffer, "}");
+    appendText(out, "{%-60s => {", buffer1);
+    // Reset and reuse buffer
+    curBuffer = buffer1;
+    for (int i = 0; i < numItemsRight; i++) {
+        curBuffer += sprintf(curBuffer, "%s", data->headers[cols[numItemsLeft + i]]);
+        if (i != numItemsRight - 1) {
+            curBuffer += sprintf(curBuffer, ", ");
+        }
+    }
+    curBuffer += sprintf(curBuffer, "}");
+    appendText(out, "%-30s%s%.1lf\n", buffer1, "Confidence: ", confidence * 100);
+}
+
+void appendRule(OutputBuffer *out, const OutputSink *sink, const TableData *data, const int *cols, int numLeft,
+                int numRight, int support, int leftSupport, int rightSupport) {
+    float confidence = support / (float)leftSupport;
+    double lift = (double)support * data->numRows / ((double)leftSupport * rightSupport);
+    switch (sink->format) {
+        case OUTPUT_TEXT:
+            appendTextRule(out, numLeft, numRight, cols, data, confidence);
+            break;
+        case OUTPUT_CSV:
+            appendBytes(out, "rule,", 5);
+            appendCSVItems(out, data, cols, numLeft);
+            appendBytes(out, ",", 1);
+            appendCSVItems(out, data, cols + numLeft, numRight);
+            appendText(out, ",%d,%.6g,%.6g\n", support, confidence, lift);
+            break;
+        case OUTPUT_JSONL:
+            appendText(out, "{\"type\":\"rule\",\"antecedent\":");
+            appendJSONItems(out, data, cols, numLeft);
+            appendText(out, ",\"consequent\":");
+            appendJSONItems(out, data, cols + numLeft, numRight);
+            appendText(out, ",\"support\":%d,\"confidence\":%.6g,\"lift\":%.6g}\n", support, confidence, lift);
+            break;
+        case OUTPUT_BINARY: {
+            int32_t record[6] = {BINARY_RULE, numLeft, numRight, support, leftSupport, rightSupport};
+            appendBytes(out, record, sizeof(record));
+            appendBytes(out, cols, (numLeft + numRight) * sizeof(int32_t));
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void initOrderedOutput(OrderedOutput *output) {
+    output->numThreads = omp_get_max_threads();
+    output->buffers = safeCalloc(output->numThreads, sizeof(OutputBuffer));
+    output->numSegments = 0;
+    output->segmentThread = NULL;
+    output->segmentStart = NULL;
+    output->segmentLength = NULL;
+}
+
+void resetOrderedOutput(OrderedOutput *output, int numSegments) {
+    for (int t = 0; t < output->numThreads; t++) {
+        output->buffers[t].length = 0;
+    }
+    free(output->segmentThread);
+    free(output->segmentStart);
+    free(output->segmentLength);
+    output->numSegments = numSegments;
+    output->segmentThread = safeMalloc((numSegments + 1) * sizeof(int));
+    output->segmentStart = safeMalloc((numSegments + 1) * sizeof(size_t));
+    output->segmentLength = safeMalloc((numSegments + 1) * sizeof(size_t));
+}
+
+OutputBuffer *beginSegment(OrderedOutput *output, int segment) {
+    int thread = omp_get_thread_num();
+    output->segmentThread[segment] = thread;
+    output->segmentStart[segment] = output->buffers[thread].length;
+    return &output->buffers[thread];
+}
+
+void endSegment(OrderedOutput *output, int segment) {
+    const OutputBuffer *buffer = &output->buffers[output->segmentThread[segment]];
+    output->segmentLength[segment] = buffer->length - output->segmentStart[segment];
+}
+
+/**
+ * @brief Writes a batch of ranges with writev, continuing after partial writes.
+ */
+static void writeRanges(int fd, struct iovec *ranges, int numRanges) {
+    while (numRanges > 0) {
+        ssize_t written = writev(fd, ranges, numRanges);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0) {
+            fatalError("Could not write the output.\n");
+        }
+        while (numRanges > 0 && (size_t)written >= ranges->iov_len) {
+            written -= ranges->iov_len;
+            ranges++;
+            numRanges--;
+        }
+        if (numRanges > 0) {
+            ranges->iov_base = (char *)ranges->iov_base + written;
+            ranges->iov_len -= written;
+        }
+    }
+}
+
+void flushOrderedOutput(const OutputSink *sink, const OrderedOutput *output) {
+    // Output written through the stream so far must end up before the ranges
+    fflush(sink->file);
+    int fd = fileno(sink->file);
+    struct iovec ranges[IOV_MAX];
+    int numRanges = 0;
+    for (int s = 0; s < output->numSegments; s++) {
+        if (output->segmentLength[s] == 0) {
+            continue;
+        }
+        char *start = output->buffers[output->segmentThread[s]].data + output->segmentStart[s];
+        // Consecutive iterations that ran on the same thread are usually adjacent in its buffer
+        if (numRanges > 0 && (char *)ranges[numRanges - 1].iov_base + ranges[numRanges - 1].iov_len == start) {
+            ranges[numRanges - 1].iov_len += output->segmentLength[s];
+            continue;
+        }
+        ranges[numRanges].iov_base = start;
+        ranges[numRanges].iov_len = output->segmentLength[s];
+        if (++numRanges == IOV_MAX) {
+            writeRanges(fd, ranges, numRanges);
+            numRanges = 0;
+        }
+    }
+    writeRanges(fd, ranges, numRanges);
+}
+
+void freeOrderedOutput(OrderedOutput *output) {
+    for (int t = 0; t < output->numThreads; t++) {
+        free(output->buffers[t].data);
+    }
+    free(output->buffers);
+    free(output->segmentThread);
+    free(output->segmentStart);
+    free(output->segmentLength);
+}
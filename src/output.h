@@ -0,0 +1,180 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "apriori.h"
+
+#define BINARY_ITEMSET 1  // Binary record: type, setSize, support, items
+#define BINARY_RULE 2     // Binary record: type, numLeft, numRight, support, leftSupport, rightSupport, items
+
+/**
+ * @brief Formats in which the frequent item sets and association rules can be written.
+ */
+typedef enum OutputFormat {
+    OUTPUT_TEXT,    // Aligned, human-readable rules, preceded by the number of frequent item sets per level
+    OUTPUT_CSV,     // A row per frequent item set and per rule
+    OUTPUT_JSONL,   // A JSON object per line for every frequent item set and rule
+    OUTPUT_BINARY,  // Compact records with item ids and support counts
+    OUTPUT_NONE,    // Nothing. The rules are still generated, e.g. to benchmark the mining alone.
+} OutputFormat;
+
+/**
+ * @brief Destination of the results of a mining run.
+ */
+typedef struct OutputSink {
+    OutputFormat format;
+    FILE *file;    // Receives the item sets and rules
+    FILE *info;    // Receives progress information, such as the number of frequent item sets per level
+    int ownsFile;  // The file was opened by openOutputSink and is closed by closeOutputSink
+} OutputSink;
+
+/**
+ * @brief Growable byte buffer that a single thread formats its output into.
+ */
+typedef struct OutputBuffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+} OutputBuffer;
+
+/**
+ * @brief Per-thread output buffers of a parallel loop, together with the range of a buffer every iteration wrote to.
+ * This allows the iterations to be written in their original order, regardless of how they were scheduled.
+ */
+typedef struct OrderedOutput {
+    OutputBuffer *buffers;  // One buffer per thread
+    int numThreads;
+    int numSegments;
+    int *segmentThread;     // Thread that ran every iteration
+    size_t *segmentStart;   // Start of the output of every iteration in the buffer of its thread
+    size_t *segmentLength;
+} OrderedOutput;
+
+/**
+ * @brief Parses the name of an output format.
+ *
+ * @param name One of "text", "csv", "jsonl", "binary" or "none".
+ * @param format The format will be written to this pointer.
+ * @return int 1 if the name is known, 0 otherwise.
+ */
+int parseOutputFormat(const char *name, OutputFormat *format);
+
+/**
+ * @brief Opens a sink. Progress information goes to the same file in the text format. In the csv, jsonl and binary
+ * formats it goes to stdout, or to stderr if the results themselves are written to stdout. Without output, it goes to
+ * stdout.
+ *
+ * @param sink The sink to initialise.
+ * @param path Path of the file to write to. NULL writes to stdout.
+ * @param format The format to write.
+ * @return int 1 on success, 0 if the file could not be opened. A warning is printed in the latter case.
+ */
+int openOutputSink(OutputSink *sink, const char *path, OutputFormat format);
+
+/**
+ * @brief Flushes a sink and closes its file if it was opened by openOutputSink.
+ *
+ * @param sink The sink to close.
+ */
+void closeOutputSink(OutputSink *sink);
+
+/**
+ * @brief Writes what precedes the records: the column names of the CSV format, or the magic, the number of rows and the
+ * item names of the binary format. Nothing for the other formats.
+ *
+ * @param sink The sink to write to.
+ * @param data Table containing the number of rows and the column names.
+ */
+void writeOutputHeader(const OutputSink *sink, const TableData *data);
+
+/**
+ * @brief Appends formatted text to a buffer, growing it if needed. Works with var args similar to printf.
+ *
+ * @param buffer The buffer to append to.
+ * @param format Format of the text to append.
+ * @param ... Var args. Use is similar to printf.
+ */
+void appendText(OutputBuffer *buffer, const char *format, ...);
+
+/**
+ * @brief Formats a frequent item set in the format of the sink. Nothing is written in the text and none formats.
+ *
+ * @param out The buffer to append to.
+ * @param sink The sink that determines the format.
+ * @param data Table containing the column names.
+ * @param set The item set.
+ * @param setSize Number of items in the set.
+ * @param support Number of rows the set occurs in.
+ */
+void appendItemSet(OutputBuffer *out, const OutputSink *sink, const TableData *data, const int *set, int setSize,
+                   int support);
+
+/**
+ * @brief Formats an association rule in the format of the sink. The text format is `{A,B,C} => {D} Confidence: 0.6`,
+ * aligned with the previous rule.
+ *
+ * @param out The buffer to append to.
+ * @param sink The sink that determines the format.
+ * @param data Table containing the number of rows and the column names.
+ * @param cols The antecedent followed by the consequent.
+ * @param numLeft Number of items in the antecedent.
+ * @param numRight Number of items in the consequent.
+ * @param support Number of rows the complete set occurs in.
+ * @param leftSupport Number of rows the antecedent occurs in.
+ * @param rightSupport Number of rows the consequent occurs in. Not used by the text format.
+ */
+void appendRule(OutputBuffer *out, const OutputSink *sink, const TableData *data, const int *cols, int numLeft,
+                int numRight, int support, int leftSupport, int rightSupport);
+
+/**
+ * @brief Allocates the buffers of an ordered output, with a buffer for every thread.
+ *
+ * @param output The ordered output to initialise.
+ */
+void initOrderedOutput(OrderedOutput *output);
+
+/**
+ * @brief Prepares an ordered output for a loop of the provided number of iterations. Previous output is discarded.
+ *
+ * @param output The ordered output.
+ * @param numSegments Number of iterations of the loop.
+ */
+void resetOrderedOutput(OrderedOutput *output, int numSegments);
+
+/**
+ * @brief Returns the buffer of the calling thread and marks the start of the output of an iteration. Must be called
+ * from within the parallel loop.
+ *
+ * @param output The ordered output.
+ * @param segment Index of the iteration.
+ * @return OutputBuffer* The buffer to write the output of the iteration to.
+ */
+OutputBuffer *beginSegment(OrderedOutput *output, int segment);
+
+/**
+ * @brief Marks the end of the output of an iteration.
+ *
+ * @param output The ordered output.
+ * @param segment Index of the iteration.
+ */
+void endSegment(OrderedOutput *output, int segment);
+
+/**
+ * @brief Writes the output of all iterations to a sink in iteration order. The ranges are handed to writev straight
+ * from the per-thread buffers, so nothing is copied.
+ *
+ * @param sink The sink to write to.
+ * @param output The ordered output.
+ */
+void flushOrderedOutput(const OutputSink *sink, const OrderedOutput *output);
+
+/**
+ * @brief Frees the buffers of an ordered output.
+ *
+ * @param output The ordered output.
+ */
+void freeOrderedOutput(OrderedOutput *output);
+
+#endif  // OUTPUT_H
@@ -0,0 +1,144 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apriori.h"
+#include "mining.h"
+#include "output.h"
+#include "utils.h"
+
+/**
+ * @brief Decodes the binary rule records of an ordered output, in iteration order, and appends them to the rules of a
+ * result. The items of the rules are copied to the arena of the result.
+ *
+ * @param result The result to append to.
+ * @param output The ordered output containing the rules of a level, formatted by an OUTPUT_BINARY sink.
+ * @param capacity Number of rules the rule array of the result has room for. Updated when the array grows.
+ */
+static void collectRules(MiningResult *result, const OrderedOutput *output, size_t *capacity) {
+    for (int s = 0; s < output->numSegments; s++) {
+        const char *p = output->buffers[output->segmentThread[s]].data + output->segmentStart[s];
+        const char *end = p + output->segmentLength[s];
+        while (p < end) {
+            int32_t record[6];  // type, numLeft, numRight, support, leftSupport, rightSupport
+            memcpy(record, p, sizeof(record));
+            p += sizeof(record);
+            int setSize = record[1] + record[2];
+            int *items = arenaAlloc(result->arena, setSize * sizeof(int));
+            memcpy(items, p, setSize * sizeof(int32_t));
+            p += setSize * sizeof(int32_t);
+
+            if (result->numRules == *capacity) {
+                *capacity = *capacity ? 2 * *capacity : 1024;
+                result->rules = realloc(result->rules, *capacity * sizeof(AssociationRule));
+                if (!result->rules) {
+                    fatalError("Failed to grow the rule array to %zu rules.\n", *capacity);
+                }
+            }
+            AssociationRule *rule = &result->rules[result->numRules++];
+            rule->items = items;
+            rule->numLeft = record[1];
+            rule->numRight = record[2];
+            rule->support = record[3];
+            rule->confidence = record[3] / (float)record[4];
+            rule->lift = (double)record[3] * result->numRows / ((double)record[4] * record[5]);
+        }
+    }
+}
+
+/**
+ * @brief Checks whether a sorted set contains all items of another sorted set.
+ */
+static int containsAll(const int *set, int setSize, const int *subset, int subsetSize) {
+    int j = 0;
+    for (int i = 0; i < setSize && j < subsetSize; i++) {
+        j += set[i] == subset[j];
+    }
+    return j == subsetSize;
+}
+
+MiningResult *mineAssociationRules(const TableData *data, const MiningOptions *options) {
+    if (!data || data->numRows == 0 || data->numCols == 0) {
+        warning("No data preset in the provided data variable.");
+        return NULL;
+    }
+    int previousThreads = setMiningThreads(options->numThreads);
+    // The rules are formatted as binary records, which hold everything a rule needs, and decoded afterwards
+    OutputSink sink = {.format = OUTPUT_BINARY, .file = NULL, .info = NULL, .ownsFile = 0};
+    MiningContext ctx;
+    initMiningContext(&ctx, data, options->counting);
+    ctx.quiet = 1;
+    ctx.output = &sink;
+    ctx.maxLevel = options->maxLevel;
+    ctx.itemSetMode = options->itemSetMode;
+
+    int numLevels;
+    int minSupportRows = data->numRows * options->minSupport;
+    LevelSets **sets = mineFrequentItemSets(&numLevels, &ctx, options->engine, minSupportRows);
+
+    // The level sets and the supports already live in the context, so the result takes them over
+    MiningResult *result = safeCalloc(1, sizeof(MiningResult));
+    result->numRows = data->numRows;
+    result->itemSetMode = options->itemSetMode;
+    result->supports = ctx.supports;
+    result->arena = ctx.arena;
+    for (int l = 0; l < numLevels; l++) {
+        result->numItemSets += sets[l]->numSets;
+    }
+    result->itemSets = safeMalloc((result->numItemSets + 1) * sizeof(FrequentItemSet));
+    size_t idx = 0;
+    for (int l = 0; l < numLevels; l++) {
+        for (int i = 0; i < sets[l]->numSets; i++) {
+            int support = itemsetMapGet(ctx.supports, sets[l]->sets[i], l + 1);
+            result->itemSets[idx++] = (FrequentItemSet){sets[l]->sets[i], l + 1, support};
+        }
+    }
+
+    OrderedOutput output;
+    initOrderedOutput(&output);
+    size_t capacity = 0;
+    for (int l = numLevels - 1; l > 0; l--) {
+        formatLevelRules(sets[l], &ctx, options->minConfidence, &output);
+        collectRules(result, &output, &capacity);
+    }
+    freeOrderedOutput(&output);
+
+    ctx.supports = NULL;
+    ctx.arena = NULL;
+    freeMiningContext(&ctx);
+    setMiningThreads(previousThreads);
+    return result;
+}
+
+int itemSetSupport(const MiningResult *result, const int *items, int numItems) {
+    if (numItems <= 0) {
+        return -1;
+    }
+    int set[numItems];
+    memcpy(set, items, numItems * sizeof(int));
+    sortInts(set, numItems);
+    int support = itemsetMapGet(result->supports, set, numItems);
+    if (support >= 0 || result->itemSetMode != ITEMSETS_CLOSED) {
+        return support;
+    }
+    // The closure of a set is its closed superset with the largest support, and has the same support
+    for (size_t i = 0; i < result->numItemSets; i++) {
+        const FrequentItemSet *closed = &result->itemSets[i];
+        if (closed->support > support && closed->size > numItems && containsAll(closed->items, closed->size, set,
+                                                                               numItems)) {
+            support = closed->support;
+        }
+    }
+    return support;
+}
+
+void freeMiningResult(MiningResult *result) {
+    if (!result) {
+        return;
+    }
+    free(result->itemSets);
+    free(result->rules);
+    freeItemsetMap(result->supports);
+    freeArena(result->arena);
+    free(result);
+}
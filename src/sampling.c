@@ -0,0 +1,248 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apriori.h"
+#include "metrics.h"
+#include "mining.h"
+#include "table.h"
+#include "transactions.h"
+#include "trie.h"
+#include "utils.h"
+
+/**
+ * @brief Returns the next 64 random bits of a splitmix64 generator, so the sample only depends on the seed and not on
+ * the C library.
+ */
+static uint64_t nextRandom(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Draws a uniform random sample of rows without replacement and copies it into a sparse table. The rows are
+ * selected in a single pass with selection sampling (Knuth's algorithm S), so they keep their order.
+ *
+ * @param data The table to sample from.
+ * @param sampleRows Number of rows to draw. At most the number of rows of the table.
+ * @param seed Seed of the random number generator.
+ * @return TableData* The sample. Shares the column names of data. Must be freed with freeSample.
+ */
+static TableData *drawSample(const TableData *data, int sampleRows, uint64_t seed) {
+    char *selected = safeCalloc(data->numRows, 1);
+    uint64_t state = seed;
+    int needed = sampleRows;
+    for (int y = 0; y < data->numRows && needed > 0; y++) {
+        // Every remaining row is selected with the chance needed / remaining
+        double chance = (double)needed / (data->numRows - y);
+        if ((nextRandom(&state) >> 11) * (1.0 / 9007199254740992.0) < chance) {
+            selected[y] = 1;
+            needed--;
+        }
+    }
+
+    int *buffer = safeMalloc(data->numCols * sizeof(int));
+    size_t numItems = 0;
+    for (int y = 0; y < data->numRows; y++) {
+        int n = 0;
+        if (selected[y]) {
+            tableRowItems(data, y, buffer, &n);
+        }
+        numItems += n;
+    }
+    TableData *sample = safeCalloc(1, sizeof(TableData));
+    sample->numRows = sampleRows;
+    sample->numCols = data->numCols;
+    sample->headers = data->headers;
+    sample->rowStart = safeMalloc((sampleRows + 1) * sizeof(size_t));
+    sample->items = safeMalloc((numItems + 1) * sizeof(int));
+    size_t offset = 0;
+    int row = 0;
+    for (int y = 0; y < data->numRows; y++) {
+        if (!selected[y]) {
+            continue;
+        }
+        int n;
+        const int *items = tableRowItems(data, y, buffer, &n);
+        sample->rowStart[row++] = offset;
+        memcpy(sample->items + offset, items, n * sizeof(int));
+        offset += n;
+    }
+    sample->rowStart[row] = offset;
+    free(buffer);
+    free(selected);
+    return sample;
+}
+
+/**
+ * @brief Frees a sample drawn with drawSample.
+ */
+static void freeSample(TableData *sample) {
+    free(sample->rowStart);
+    free(sample->items);
+    free(sample);
+}
+
+/**
+ * @brief Collects the candidates of the verification pass from the frequent item sets of the sample: every single item
+ * and, at the higher levels, every set whose subsets are all frequent in the sample. These are the sets that are
+ * frequent in the sample together with their negative border.
+ *
+ * @param arena The arena to allocate the level sets from.
+ * @param numCols Number of columns of the table.
+ * @param sampleSets The level sets of the frequent item sets of the sample.
+ * @param numSampleLevels Number of level sets of the sample.
+ * @param sampleSupports The supports of the frequent item sets of the sample.
+ * @param maxLevel Size of the largest candidates. 0 for no limit.
+ * @param numLevels The number of candidate level sets will be written to this pointer.
+ * @return LevelSets** Provides for each of the numLevels levels the sorted candidates.
+ */
+static LevelSets **collectCandidates(Arena *arena, int numCols, LevelSets **sampleSets, int numSampleLevels,
+                                     const ItemsetMap *sampleSupports, int maxLevel, int *numLevels) {
+    LevelSets **candidates = arenaAlloc(arena, (numSampleLevels + 2) * sizeof(LevelSets *));
+    candidates[0] = createLevelSets(arena, numCols, 1);
+    for (int x = 0; x < numCols; x++) {
+        candidates[0]->sets[x][0] = x;
+    }
+    int level = 1;
+    for (int l = 0; l < numSampleLevels && (maxLevel == 0 || l + 2 <= maxLevel); l++) {
+        CandidateBuffer buffer = {NULL, 0, 0};
+        generateCandidates(sampleSets[l], sampleSupports, &buffer);
+        const CandidateBuffer *buffers = &buffer;
+        LevelSets *levelSet = mergeSortedLevelSet(arena, &buffers, 1, l + 2);
+        free(buffer.sets);
+        if (!levelSet) {
+            break;
+        }
+        candidates[level++] = levelSet;
+    }
+    *numLevels = level;
+    return candidates;
+}
+
+/**
+ * @brief Counts the exact supports of the candidates of every level in a single pass over all rows and keeps the
+ * frequent ones.
+ *
+ * @param finalLevel The number of level sets that remain will be written to this pointer.
+ * @param ctx Context of the complete table that receives the supports of the frequent item sets.
+ * @param sets The candidates of every level. Filtered in place.
+ * @param numLevels Number of candidate level sets.
+ * @param sampleSupports The supports of the frequent item sets of the sample.
+ * @param minSupportRows The minimum number of rows an item set must occur in over the complete table.
+ * @param numMissed The number of frequent candidates that were not frequent in the sample will be written to this
+ * pointer.
+ * @return LevelSets** The level sets that satisfy the minimum support.
+ */
+static LevelSets **verifyCandidates(int *finalLevel, MiningContext *ctx, LevelSets **sets, int numLevels,
+                                    const ItemsetMap *sampleSupports, int minSupportRows, int *numMissed) {
+    PhaseTimer timer;
+    startPhase(&timer);
+    TransactionList *transactions = createTransactionList(ctx->data, NULL);
+    endPhase(&timer, PHASE_INDEX, 0);
+
+    int maxSets = 1;
+    for (int l = 0; l < numLevels; l++) {
+        maxSets = sets[l]->numSets > maxSets ? sets[l]->numSets : maxSets;
+    }
+    int *supports = safeMalloc(maxSets * sizeof(int));
+    int level = 0;
+    *numMissed = 0;
+    for (int l = 0; l < numLevels; l++) {
+        startPhase(&timer);
+        CandidateTrie *trie = createCandidateTrie(sets[l]->sets, sets[l]->numSets, l + 1);
+        countTrieSupports(trie, transactions, supports);
+        freeCandidateTrie(trie);
+        endPhase(&timer, PHASE_COUNT, l + 1);
+
+        int setIdx = 0;
+        for (int i = 0; i < sets[l]->numSets; i++) {
+            if (supports[i] >= minSupportRows) {
+                // A frequent set of the negative border means its supersets were never counted
+                *numMissed += itemsetMapGet(sampleSupports, sets[l]->sets[i], l + 1) < 0;
+                itemsetMapPut(ctx->supports, sets[l]->sets[i], l + 1, supports[i]);
+                sets[l]->sets[setIdx++] = sets[l]->sets[i];
+            }
+        }
+        addCandidates(l + 1, sets[l]->numSets, 0, sets[l]->numSets - setIdx);
+        sets[l]->numSets = setIdx;
+        if (setIdx == 0 && l > 0) {
+            break;
+        }
+        printLevelSize(ctx, l + 1, setIdx);
+        level = l + 1;
+    }
+    free(supports);
+    freeTransactionList(transactions);
+    *finalLevel = level;
+    return sets;
+}
+
+void aprioriSampled(TableData *data, const MiningOptions *options, int sampleRows, uint64_t seed,
+                    double missProbability, const OutputSink *output) {
+    if (!data || data->numRows == 0 || data->numCols == 0) {
+        warning("No data preset in the provided data variable.");
+        return;
+    }
+    int previousThreads = setMiningThreads(options->numThreads);
+    int minSupportRows = data->numRows * options->minSupport;
+    sampleRows = sampleRows < data->numRows ? sampleRows : data->numRows;
+    TableData *sample = drawSample(data, sampleRows, seed);
+
+    // Lowering the threshold by the Hoeffding-Serfling bound makes the chance that a frequent item set is missed in
+    // the sample at most missProbability. The bound shrinks to 0 as the sample grows to all rows.
+    double fraction = 1 - (sampleRows - 1.0) / data->numRows;
+    double epsilon = sqrt(fraction * log(1 / missProbability) / (2.0 * sampleRows));
+    double lowered = options->minSupport - epsilon;
+    if (lowered < options->minSupport / 2) {
+        // Lower thresholds make the number of candidates explode, so the guarantee is given up instead
+        warning("The sample of %d rows is too small for a miss probability of %g; mining it at half the minimum "
+                "support.\n",
+                sampleRows, missProbability);
+        lowered = options->minSupport / 2;
+    }
+    int sampleMinSupport = sampleRows * lowered;
+    if (minSupportRows > 0 && sampleMinSupport < 1) {
+        sampleMinSupport = 1;
+    }
+    MiningContext sampleCtx;
+    initMiningContext(&sampleCtx, sample, options->counting);
+    sampleCtx.quiet = 1;
+    sampleCtx.maxLevel = options->maxLevel;
+    int numSampleLevels;
+    LevelSets **sampleSets = mineFrequentItemSets(&numSampleLevels, &sampleCtx, options->engine, sampleMinSupport);
+
+    // Only the column names and the rows are needed from the table; the supports are counted by verifyCandidates
+    MiningContext ctx = {.data = data, .counting = options->counting, .output = output, .maxLevel = options->maxLevel};
+    ctx.supports = createItemsetMap(data->numCols);
+    ctx.arena = createArena(ARENA_CHUNK_SIZE);
+    int numCandidateLevels;
+    LevelSets **candidates = collectCandidates(ctx.arena, data->numCols, sampleSets, numSampleLevels,
+                                               sampleCtx.supports, options->maxLevel, &numCandidateLevels);
+    int numCandidates = 0;
+    for (int l = 0; l < numCandidateLevels; l++) {
+        numCandidates += candidates[l]->numSets;
+    }
+    int numLevels, numMissed;
+    LevelSets **sets = verifyCandidates(&numLevels, &ctx, candidates, numCandidateLevels, sampleCtx.supports,
+                                        minSupportRows, &numMissed);
+    freeMiningContext(&sampleCtx);
+    freeSample(sample);
+
+    fprintf(output->info, "Mined a sample of %d of %d rows at a support of %d rows; verified %d candidates\n",
+            sampleRows, data->numRows, sampleMinSupport, numCandidates);
+    if (numMissed > 0) {
+        warning("%d frequent item sets were not frequent in the sample, so larger frequent item sets may be missing. "
+                "Mine a larger sample or allow a smaller miss probability.\n",
+                numMissed);
+    }
+    writeMiningResults(sets, numLevels, &ctx, options->minConfidence);
+
+    freeItemsetMap(ctx.supports);
+    freeArena(ctx.arena);
+    setMiningThreads(previousThreads);
+}
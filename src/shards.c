@@ -0,0 +1,340 @@
+#include "shards.h"
+
+#include <errno.h>
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "transactions.h"
+#include "trie.h"
+#include "utils.h"
+
+#define PAIR_MEMORY_BUDGET (1 << 28)  // Max bytes used by the per-thread triangular count arrays of a worker
+
+/**
+ * @brief Kinds of requests the coordinator sends to a worker.
+ */
+typedef enum ShardRequestType {
+    SHARD_COUNT = 1,  // Count the candidates that follow the request on the shard
+    SHARD_KEEP = 2,   // Drop all items from the shard except the single-item sets that follow the request
+    SHARD_STOP = 3,   // Exit the worker loop
+} ShardRequestType;
+
+/**
+ * @brief Header of a request. Count and keep requests are followed by the numSets * setSize items of their sets as int.
+ * A count request is answered with numSets counts as int, other requests are not answered. The coordinator and the
+ * workers are assumed to share the same byte order.
+ */
+typedef struct ShardRequest {
+    uint32_t type;
+    uint32_t setSize;
+    uint64_t numSets;
+} ShardRequest;
+
+struct ShardPool {
+    int numWorkers;
+    int *sockets;  // Coordinator end of the connection to every worker
+    pid_t *pids;
+    int *counts;   // Receive buffer for the counts of a single worker
+    size_t capacity;
+};
+
+/**
+ * @brief Writes a buffer to a stream socket, retrying until all of it has been written.
+ *
+ * @return int 1 on success, 0 if the connection was closed or failed.
+ */
+static int sendAll(int fd, const void *buffer, size_t size) {
+    const char *p = buffer;
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 0;
+        }
+        p += n;
+        size -= n;
+    }
+    return 1;
+}
+
+/**
+ * @brief Reads exactly size bytes from a stream socket.
+ *
+ * @return int 1 on success, 0 if the connection was closed or failed.
+ */
+static int recvAll(int fd, void *buffer, size_t size) {
+    char *p = buffer;
+    while (size > 0) {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 0;
+        }
+        p += n;
+        size -= n;
+    }
+    return 1;
+}
+
+/**
+ * @brief Returns a table that refers to the rows [firstRow, endRow) of another table, without copying them.
+ */
+static TableData shardView(const TableData *data, int firstRow, int endRow) {
+    TableData shard = *data;
+    shard.numRows = endRow - firstRow;
+    shard.bitsets = NULL;
+    shard.tidLists = NULL;
+    shard.itemSupports = NULL;
+    if (data->data) {
+        shard.data = data->data + firstRow;
+    } else {
+        shard.rowStart = data->rowStart + firstRow;
+    }
+    return shard;
+}
+
+/**
+ * @brief Counts 2-item candidates in a count matrix over their items, with a matrix per thread. Walking
+ * the trie is quadratic in the length of a transaction, which makes it slow for the many pairs of level 2.
+ *
+ * @param sets The candidate sets.
+ * @param numSets Number of candidate sets.
+ * @param transactions The transactions of the shard.
+ * @param numCols Number of columns of the table.
+ * @param supports Output array with an entry per candidate.
+ * @return int 1 if the candidates were counted, 0 if the count arrays would not fit in PAIR_MEMORY_BUDGET.
+ */
+static int countShardPairs(int **sets, size_t numSets, const TransactionList *transactions, int numCols,
+                           int *supports) {
+    // Index of every column among the items of the candidates, -1 for other items
+    int *itemIdx = safeMalloc(numCols * sizeof(int));
+    for (int c = 0; c < numCols; c++) {
+        itemIdx[c] = -1;
+    }
+    int m = 0;
+    for (size_t i = 0; i < numSets; i++) {
+        for (int j = 0; j < 2; j++) {
+            if (itemIdx[sets[i][j]] == -1) {
+                itemIdx[sets[i][j]] = m++;
+            }
+        }
+    }
+    size_t numPairs = (size_t)m * m;
+    int numThreads = omp_get_max_threads();
+    if (numPairs * numThreads * sizeof(int) > PAIR_MEMORY_BUDGET) {
+        free(itemIdx);
+        return 0;
+    }
+
+    // The items are numbered in order of appearance, so a full m x m array is used instead of a triangular one
+    int **counts = safeMalloc(numThreads * sizeof(int *));
+    for (int t = 0; t < numThreads; t++) {
+        counts[t] = safeCalloc(numPairs, sizeof(int));
+    }
+    #pragma omp parallel
+    {
+        int *threadCounts = counts[omp_get_thread_num()];
+        int *items = safeMalloc((m > 0 ? m : 1) * sizeof(int));
+        #pragma omp for schedule(static)
+        for (int y = 0; y < transactions->numRows; y++) {
+            int numItems = 0;
+            for (size_t i = transactions->rowStart[y]; i < transactions->rowStart[y + 1]; i++) {
+                if (itemIdx[transactions->items[i]] >= 0) {
+                    items[numItems++] = itemIdx[transactions->items[i]];
+                }
+            }
+            for (int a = 0; a < numItems - 1; a++) {
+                int *pairCounts = threadCounts + (size_t)items[a] * m;
+                for (int b = a + 1; b < numItems; b++) {
+                    pairCounts[items[b]]++;
+                }
+            }
+        }
+        free(items);
+    }
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < numSets; i++) {
+        size_t pair = (size_t)itemIdx[sets[i][0]] * m + itemIdx[sets[i][1]];
+        supports[i] = 0;
+        for (int t = 0; t < numThreads; t++) {
+            supports[i] += counts[t][pair];
+        }
+    }
+    for (int t = 0; t < numThreads; t++) {
+        free(counts[t]);
+    }
+    free(counts);
+    free(itemIdx);
+    return 1;
+}
+
+void runShardWorker(int fd, const TableData *shard) {
+    TransactionList *transactions = createTransactionList(shard, NULL);
+    size_t capacity = 0;
+    size_t itemCapacity = 0;
+    int *items = NULL;
+    int **sets = NULL;
+    int *supports = NULL;
+    ShardRequest request;
+    while (recvAll(fd, &request, sizeof(ShardRequest)) && request.type != SHARD_STOP) {
+        size_t numItems = request.numSets * request.setSize;
+        if (request.numSets >= capacity) {
+            capacity = request.numSets + 1;
+            free(sets);
+            free(supports);
+            sets = safeMalloc(capacity * sizeof(int *));
+            supports = safeMalloc(capacity * sizeof(int));
+        }
+        if (numItems >= itemCapacity) {
+            itemCapacity = numItems + 1;
+            free(items);
+            items = safeMalloc(itemCapacity * sizeof(int));
+        }
+        if (!recvAll(fd, items, numItems * sizeof(int))) {
+            break;
+        }
+        if (request.type == SHARD_KEEP) {
+            int *keepItems = safeCalloc(shard->numCols, sizeof(int));
+            for (size_t i = 0; i < numItems; i++) {
+                keepItems[items[i]] = 1;
+            }
+            freeTransactionList(transactions);
+            transactions = createTransactionList(shard, keepItems);
+            free(keepItems);
+            continue;
+        }
+        for (size_t i = 0; i < request.numSets; i++) {
+            sets[i] = items + i * request.setSize;
+        }
+        if (request.setSize != 2 || !countShardPairs(sets, request.numSets, transactions, shard->numCols, supports)) {
+            CandidateTrie *trie = createCandidateTrie(sets, request.numSets, request.setSize);
+            countTrieSupports(trie, transactions, supports);
+            freeCandidateTrie(trie);
+        }
+        if (!sendAll(fd, supports, request.numSets * sizeof(int))) {
+            break;
+        }
+    }
+    free(items);
+    free(sets);
+    free(supports);
+    freeTransactionList(transactions);
+    close(fd);
+}
+
+ShardPool *startShardWorkers(const TableData *data, int numWorkers) {
+    if (numWorkers > data->numRows) {
+        numWorkers = data->numRows;
+    }
+    if (numWorkers < 1) {
+        numWorkers = 1;
+    }
+    ShardPool *pool = safeMalloc(sizeof(ShardPool));
+    pool->numWorkers = numWorkers;
+    pool->sockets = safeMalloc(numWorkers * sizeof(int));
+    pool->pids = safeMalloc(numWorkers * sizeof(pid_t));
+    pool->capacity = 0;
+    pool->counts = NULL;
+    int threadsPerWorker = omp_get_max_threads() / numWorkers > 0 ? omp_get_max_threads() / numWorkers : 1;
+
+    // Output still buffered in the coordinator would otherwise be written again by a worker that exits with an error
+    fflush(stdout);
+    fflush(stderr);
+    for (int w = 0; w < numWorkers; w++) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+            fatalError("Could not create a socket for shard worker %d.\n", w);
+        }
+        pid_t pid = fork();
+        if (pid == -1) {
+            fatalError("Could not fork shard worker %d.\n", w);
+        }
+        if (pid == 0) {
+            // Keep only the own connection open, so that every worker notices when the coordinator goes away
+            close(fds[0]);
+            for (int prev = 0; prev < w; prev++) {
+                close(pool->sockets[prev]);
+            }
+            omp_set_num_threads(threadsPerWorker);
+            TableData shard = shardView(data, (int64_t)data->numRows * w / numWorkers,
+                                        (int64_t)data->numRows * (w + 1) / numWorkers);
+            runShardWorker(fds[1], &shard);
+            _exit(EXIT_SUCCESS);
+        }
+        close(fds[1]);
+        pool->sockets[w] = fds[0];
+        pool->pids[w] = pid;
+    }
+    return pool;
+}
+
+/**
+ * @brief Sends a request, followed by its sets, to every worker.
+ */
+static void broadcastSets(ShardPool *pool, ShardRequestType type, int **sets, int numSets, int setSize) {
+    // The sets of a level are not necessarily contiguous after pruning, so pack them into a single message
+    size_t numItems = (size_t)numSets * setSize;
+    int *items = safeMalloc((numItems + 1) * sizeof(int));
+    for (int i = 0; i < numSets; i++) {
+        memcpy(items + (size_t)i * setSize, sets[i], setSize * sizeof(int));
+    }
+    ShardRequest request = {.type = type, .setSize = setSize, .numSets = numSets};
+    for (int w = 0; w < pool->numWorkers; w++) {
+        if (!sendAll(pool->sockets[w], &request, sizeof(ShardRequest)) ||
+            !sendAll(pool->sockets[w], items, numItems * sizeof(int))) {
+            fatalError("Shard worker %d exited unexpectedly.\n", w);
+        }
+    }
+    free(items);
+}
+
+void keepShardItems(ShardPool *pool, int **items, int numItems) {
+    broadcastSets(pool, SHARD_KEEP, items, numItems, 1);
+}
+
+void countShardSupports(ShardPool *pool, int **sets, int numSets, int setSize, int *supports) {
+    if ((size_t)numSets >= pool->capacity) {
+        pool->capacity = numSets + 1;
+        free(pool->counts);
+        pool->counts = safeMalloc(pool->capacity * sizeof(int));
+    }
+    // Every worker reads its whole request before it answers, so all requests can be sent before any answer is read
+    broadcastSets(pool, SHARD_COUNT, sets, numSets, setSize);
+    memset(supports, 0, numSets * sizeof(int));
+    for (int w = 0; w < pool->numWorkers; w++) {
+        if (!recvAll(pool->sockets[w], pool->counts, numSets * sizeof(int))) {
+            fatalError("Shard worker %d exited unexpectedly.\n", w);
+        }
+        for (int i = 0; i < numSets; i++) {
+            supports[i] += pool->counts[i];
+        }
+    }
+}
+
+void stopShardWorkers(ShardPool *pool) {
+    ShardRequest request = {.type = SHARD_STOP, .setSize = 0, .numSets = 0};
+    for (int w = 0; w < pool->numWorkers; w++) {
+        sendAll(pool->sockets[w], &request, sizeof(ShardRequest));
+        close(pool->sockets[w]);
+    }
+    for (int w = 0; w < pool->numWorkers; w++) {
+        int status;
+        if (waitpid(pool->pids[w], &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+            warning("Shard worker %d did not exit cleanly.\n", w);
+        }
+    }
+    free(pool->sockets);
+    free(pool->pids);
+    free(pool->counts);
+    free(pool);
+}
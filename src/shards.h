@@ -0,0 +1,61 @@
+#ifndef SHARDS_H
+#define SHARDS_H
+
+#include "apriori.h"
+
+/**
+ * @brief A group of worker processes that each own a shard of the transactions. The coordinator broadcasts the
+ * candidates of a level to every worker and sums the counts they send back.
+ */
+typedef struct ShardPool ShardPool;
+
+/**
+ * @brief Splits the rows of a table into consecutive shards and forks a local worker process for each of them. Every
+ * worker is connected to the coordinator by a Unix stream socket and runs runShardWorker on its shard. The OpenMP
+ * threads of the coordinator are divided among the workers.
+ *
+ * @param data The table to shard.
+ * @param numWorkers Number of worker processes. Clamped to the number of rows.
+ * @return ShardPool* The pool of workers. Must be stopped with stopShardWorkers.
+ */
+ShardPool *startShardWorkers(const TableData *data, int numWorkers);
+
+/**
+ * @brief Counts the supports of a batch of candidates on all shards. Every worker receives all candidates and counts
+ * them on its own shard; the supports are the sums of the per-shard counts.
+ *
+ * @param pool The pool of workers.
+ * @param sets The candidate sets. Must be sorted lexicographically and every set must be sorted.
+ * @param numSets Number of candidate sets.
+ * @param setSize Number of elements in every set.
+ * @param supports Output array with an entry per candidate.
+ */
+void countShardSupports(ShardPool *pool, int **sets, int numSets, int setSize, int *supports);
+
+/**
+ * @brief Tells every worker to leave all but the provided items out of its shard. Items that are not frequent can never
+ * be part of a candidate, so this makes the following counts cheaper.
+ *
+ * @param pool The pool of workers.
+ * @param items The single-item sets of the items to keep.
+ * @param numItems Number of items to keep.
+ */
+void keepShardItems(ShardPool *pool, int **items, int numItems);
+
+/**
+ * @brief Tells every worker to exit, waits for them and frees the pool.
+ *
+ * @param pool The pool of workers.
+ */
+void stopShardWorkers(ShardPool *pool);
+
+/**
+ * @brief Serves count requests for a single shard until the coordinator sends a stop request or closes the connection.
+ * Only needs a connected stream, so the same loop can serve a coordinator on another node.
+ *
+ * @param fd The connection to the coordinator.
+ * @param shard The rows owned by this worker.
+ */
+void runShardWorker(int fd, const TableData *shard);
+
+#endif  // SHARDS_H
@@ -0,0 +1,359 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apriori.h"
+#include "csv.h"
+#include "itemsetmap.h"
+#include "mappedfile.h"
+#include "mining.h"
+#include "transactions.h"
+#include "trie.h"
+#include "utils.h"
+
+/**
+ * @brief A range of lines of the input that is loaded and mined on its own.
+ */
+typedef struct Partition {
+    const char *start;
+    const char *end;
+    int numRows;
+} Partition;
+
+/**
+ * @brief Estimates the number of bytes a row of a partition occupies in memory: its dense row, its bit in the bitset
+ * of every column and, at most, an entry per column in a transaction list.
+ *
+ * @param numCols Number of columns of the table.
+ * @return size_t The estimated number of bytes per row.
+ */
+static size_t rowFootprint(int numCols) {
+    return sizeof(int *) + (size_t)numCols * sizeof(int) + (numCols + 7) / 8 + sizeof(size_t) +
+           (size_t)numCols * sizeof(int);
+}
+
+/**
+ * @brief Returns the number of bytes that level sets take: their sets and the pointers to these.
+ */
+static size_t levelSetBytes(LevelSets **sets, int numLevels) {
+    size_t bytes = 0;
+    for (int l = 0; l < numLevels; l++) {
+        bytes += (size_t)sets[l]->numSets * ((l + 1) * sizeof(int) + sizeof(int *));
+    }
+    return bytes;
+}
+
+/**
+ * @brief Returns the number of bytes the candidates collected so far take, in their buffers and in the map that keeps
+ * them unique.
+ */
+static size_t candidateBytes(const LevelBuffers *candidates, const ItemsetMap *seen) {
+    size_t bytes = itemsetMapMemory(seen);
+    for (int l = 0; l < candidates->numLevels; l++) {
+        bytes += (size_t)candidates->levels[l].capacity * (l + 1) * sizeof(int);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Splits the lines of the input into partitions of at most maxRows non-empty lines each.
+ *
+ * @param start Start of the first line after the header.
+ * @param end End of the input.
+ * @param maxRows Maximum number of rows per partition.
+ * @param numPartitions The number of partitions will be written to this pointer.
+ * @param numRows The total number of rows will be written to this pointer.
+ * @return Partition* The partitions, in file order.
+ */
+static Partition *splitPartitions(const char *start, const char *end, int maxRows, int *numPartitions, int *numRows) {
+    int capacity = 16;
+    Partition *partitions = safeMalloc(capacity * sizeof(Partition));
+    int count = 0;
+    size_t totalRows = 0;
+    const char *next;
+    for (const char *line = start; line < end;) {
+        Partition partition = {line, line, 0};
+        for (; line < end && partition.numRows < maxRows; line = next) {
+            partition.numRows += findLineEnd(line, end, &next) > line;
+        }
+        partition.end = line;
+        if (partition.numRows == 0) {
+            break;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            partitions = realloc(partitions, capacity * sizeof(Partition));
+            if (!partitions) {
+                fatalError("Could not grow the partition list to %d partitions.\n", capacity);
+            }
+        }
+        partitions[count++] = partition;
+        totalRows += partition.numRows;
+    }
+    if (totalRows > INT32_MAX) {
+        fatalError("The CSV file has more than %d rows.\n", INT32_MAX);
+    }
+    *numPartitions = count;
+    *numRows = totalRows;
+    return partitions;
+}
+
+/**
+ * @brief Phase one: mines every partition on its own at the minimum support scaled to the size of the partition. An
+ * item set that is frequent in the complete input is frequent in at least one partition, so the union of the local
+ * frequent item sets contains every globally frequent item set.
+ *
+ * The candidates can not be dropped without missing frequent item sets, so a warning is printed once the partition,
+ * the structures of its engine and the candidates collected so far take more than the memory budget together.
+ *
+ * @param partitions The partitions of the input.
+ * @param numPartitions Number of partitions.
+ * @param headers The column names.
+ * @param numCols Number of columns.
+ * @param numRows Total number of rows.
+ * @param minSupportRows The minimum number of rows an item set must occur in over the complete input.
+ * @param options Settings of the run, containing the engine used to mine the partitions and the maximum level.
+ * @param memoryBudget The memory budget in bytes.
+ * @param candidates The union of the local frequent item sets is appended to these buffers, without duplicates.
+ */
+static void mineLocalItemSets(const Partition *partitions, int numPartitions, char **headers, int numCols,
+                              int numRows, int minSupportRows, const MiningOptions *options, size_t memoryBudget,
+                              LevelBuffers *candidates) {
+    ItemsetMap *seen = createItemsetMap(numCols);
+    int overBudget = 0;
+    for (int p = 0; p < numPartitions; p++) {
+        TableData *part = parseCSVRows(partitions[p].start, partitions[p].end, headers, numCols);
+        // Rounding up keeps the guarantee: a set below this threshold in every partition is below minSupportRows
+        int localMinSupport = ((int64_t)minSupportRows * part->numRows + numRows - 1) / numRows;
+        if (minSupportRows > 0 && localMinSupport < 1) {
+            localMinSupport = 1;
+        }
+        MiningContext ctx;
+        initMiningContext(&ctx, part, options->counting);
+        ctx.quiet = 1;
+        ctx.maxLevel = options->maxLevel;
+        int numLevels;
+        LevelSets **sets = mineFrequentItemSets(&numLevels, &ctx, options->engine, localMinSupport);
+        for (int l = 0; l < numLevels; l++) {
+            for (int i = 0; i < sets[l]->numSets; i++) {
+                if (itemsetMapPut(seen, sets[l]->sets[i], l + 1, 0)) {
+                    appendToLevel(candidates, sets[l]->sets[i], l + 1);
+                }
+            }
+        }
+        size_t usedBytes = part->numRows * rowFootprint(numCols) + itemsetMapMemory(ctx.supports) +
+                           levelSetBytes(sets, numLevels) + candidateBytes(candidates, seen);
+        if (!overBudget && usedBytes > memoryBudget) {
+            warning("Mining partition %d took about %.1f MB with the candidates, more than the memory budget of %.1f "
+                    "MB. Use a higher minimum support or a larger budget.\n",
+                    p + 1, usedBytes / 1048576.0, memoryBudget / 1048576.0);
+            overBudget = 1;
+        }
+        freeMiningContext(&ctx);
+        freeCSVRows(part);
+        releaseRange(partitions[p].start, partitions[p].end);
+    }
+    freeItemsetMap(seen);
+}
+
+/**
+ * @brief A range of the candidates of a level that is counted with a trie of its own.
+ */
+typedef struct CandidateBatch {
+    int level;  // Index of the level
+    int from;   // Index of the first candidate within the level
+    int numSets;
+    CandidateTrie *trie;
+} CandidateBatch;
+
+/**
+ * @brief Phase two: counts the global supports of all candidates in passes over the partitions and keeps the candidates
+ * that are frequent over the complete input.
+ *
+ * A partition takes up to half of the memory budget, and the candidates, their supports and their tries the other
+ * half. Every pass counts as many consecutive candidates as their tries fit in what the candidates leave, so usually
+ * all candidates are counted in a single pass. At least an eighth of the budget is used for the tries, and a warning
+ * is printed if that makes the run exceed the budget.
+ *
+ * @param finalLevel The number of level sets that remain will be written to this pointer.
+ * @param ctx Context that receives the level sets and the supports of the frequent item sets.
+ * @param candidates The candidates of every level. Freed by this function.
+ * @param partitions The partitions of the input.
+ * @param numPartitions Number of partitions.
+ * @param minSupportRows The minimum number of rows an item set must occur in over the complete input.
+ * @param memoryBudget The memory budget in bytes.
+ * @return LevelSets** Provides for each of the finalLevel levels the sorted sets that satisfy the minimum support.
+ */
+static LevelSets **countGlobalSupports(int *finalLevel, MiningContext *ctx, LevelBuffers *candidates,
+                                       const Partition *partitions, int numPartitions, int minSupportRows,
+                                       size_t memoryBudget) {
+    const TableData *header = ctx->data;
+    int numLevels = candidates->numLevels;
+    LevelSets **sets = arenaAlloc(ctx->arena, (numLevels + 1) * sizeof(LevelSets *));
+    int **supports = safeMalloc((numLevels + 1) * sizeof(int *));
+    int maxSets = 1;
+    size_t storedBytes = 0;
+    for (int l = 0; l < numLevels; l++) {
+        const CandidateBuffer *buffer = &candidates->levels[l];
+        sets[l] = mergeSortedLevelSet(ctx->arena, &buffer, 1, l + 1);
+        free(candidates->levels[l].sets);
+        candidates->levels[l].sets = NULL;
+        if (!sets[l]) {
+            numLevels = l;
+            break;
+        }
+        supports[l] = safeCalloc(sets[l]->numSets, sizeof(int));
+        // The sets, the pointers to them and their supports
+        storedBytes += (size_t)sets[l]->numSets * ((l + 2) * sizeof(int) + sizeof(int *));
+        maxSets = sets[l]->numSets > maxSets ? sets[l]->numSets : maxSets;
+    }
+    for (int l = numLevels; l < candidates->numLevels; l++) {
+        free(candidates->levels[l].sets);
+    }
+    free(candidates->levels);
+
+    size_t trieBudget = memoryBudget / 2 > storedBytes ? memoryBudget / 2 - storedBytes : 0;
+    if (trieBudget < memoryBudget / 8) {
+        warning("The %.1f MB of candidates leave too little of the memory budget of %.1f MB to count them; counting "
+                "with %.1f MB of tries per pass.\n",
+                storedBytes / 1048576.0, memoryBudget / 1048576.0, memoryBudget / 8 / 1048576.0);
+        trieBudget = memoryBudget / 8;
+    }
+
+    // Only items that are frequent in some partition can be part of a candidate
+    int *keepItems = safeCalloc(header->numCols, sizeof(int));
+    for (int i = 0; numLevels > 0 && i < sets[0]->numSets; i++) {
+        keepItems[sets[0]->sets[i][0]] = 1;
+    }
+    int *partSupports = safeMalloc(maxSets * sizeof(int));
+    // A pass holds a partial level at either end and whole levels in between
+    CandidateBatch *batches = safeMalloc((numLevels + 1) * sizeof(CandidateBatch));
+    int numPasses = 0;
+    for (int level = 0, from = 0; level < numLevels;) {
+        int numBatches = 0;
+        size_t trieBytes = 0;
+        while (level < numLevels) {
+            int remaining = sets[level]->numSets - from;
+            size_t setBytes = candidateTrieBytes(1, level + 1);
+            size_t fit = trieBytes < trieBudget ? (trieBudget - trieBytes) / setBytes : 0;
+            int numSets = fit < (size_t)remaining ? (int)fit : remaining;
+            if (numSets == 0 && numBatches > 0) {
+                break;
+            }
+            // Every pass counts at least a single candidate, so it always makes progress
+            numSets = numSets > 0 ? numSets : 1;
+            int **batchSets = sets[level]->sets + from;
+            batches[numBatches++] = (CandidateBatch){level, from, numSets,
+                                                     createCandidateTrie(batchSets, numSets, level + 1)};
+            trieBytes += candidateTrieBytes(numSets, level + 1);
+            from += numSets;
+            if (from == sets[level]->numSets) {
+                level++;
+                from = 0;
+            }
+        }
+
+        for (int p = 0; p < numPartitions; p++) {
+            TableData *part = parseCSVRows(partitions[p].start, partitions[p].end, header->headers, header->numCols);
+            TransactionList *transactions = createTransactionList(part, keepItems);
+            freeCSVRows(part);
+            for (int b = 0; b < numBatches; b++) {
+                const CandidateBatch *batch = &batches[b];
+                countTrieSupports(batch->trie, transactions, partSupports);
+                for (int i = 0; i < batch->numSets; i++) {
+                    supports[batch->level][batch->from + i] += partSupports[i];
+                }
+            }
+            freeTransactionList(transactions);
+            releaseRange(partitions[p].start, partitions[p].end);
+        }
+        for (int b = 0; b < numBatches; b++) {
+            freeCandidateTrie(batches[b].trie);
+        }
+        numPasses++;
+    }
+    if (numPasses > 1 && !ctx->quiet) {
+        fprintf(ctx->output->info, "Counted the candidates in %d passes over the input to stay within the memory "
+                "budget\n", numPasses);
+    }
+    free(batches);
+    free(partSupports);
+    free(keepItems);
+
+    // Keep the globally frequent candidates. A level without any means there are none at higher levels either.
+    int level = 0;
+    for (int l = 0; l < numLevels; l++) {
+        int setIdx = 0;
+        for (int i = 0; i < sets[l]->numSets; i++) {
+            if (supports[l][i] >= minSupportRows) {
+                itemsetMapPut(ctx->supports, sets[l]->sets[i], l + 1, supports[l][i]);
+                sets[l]->sets[setIdx++] = sets[l]->sets[i];
+            }
+        }
+        sets[l]->numSets = setIdx;
+        if (setIdx == 0 && l > 0) {
+            break;
+        }
+        printLevelSize(ctx, l + 1, setIdx);
+        level = l + 1;
+    }
+    if (level == 0) {
+        // The first level is always reported, just like by the in-memory engines
+        sets[0] = createLevelSets(ctx->arena, 0, 1);
+        printLevelSize(ctx, 1, 0);
+        level = 1;
+    }
+    for (int l = 0; l < numLevels; l++) {
+        free(supports[l]);
+    }
+    free(supports);
+    *finalLevel = level;
+    return sets;
+}
+
+void aprioriCSVPartitioned(const char *csvPath, const MiningOptions *options, size_t memoryBudget,
+                           const OutputSink *output) {
+    MappedFile file;
+    if (!mapFile(csvPath, &file)) {
+        return;
+    }
+    int previousThreads = setMiningThreads(options->numThreads);
+    const char *dataStart;
+    TableData header = {0};
+    header.headers = parseCSVHeader(file.start, findLineEnd(file.start, file.end, &dataStart), &header.numCols);
+
+    // Half of the budget is reserved for the data structures of the engines and the candidates
+    size_t maxRows = memoryBudget / 2 / rowFootprint(header.numCols);
+    if (maxRows < 1) {
+        maxRows = 1;
+    }
+    int numPartitions;
+    Partition *partitions = splitPartitions(dataStart, file.end, maxRows < INT32_MAX ? maxRows : INT32_MAX,
+                                            &numPartitions, &header.numRows);
+    if (header.numRows == 0 || header.numCols == 0) {
+        warning("No data preset in the provided CSV file.\n");
+    } else {
+        int minSupportRows = header.numRows * options->minSupport;
+        LevelBuffers candidates = {NULL, 0};
+        mineLocalItemSets(partitions, numPartitions, header.headers, header.numCols, header.numRows, minSupportRows,
+                          options, memoryBudget, &candidates);
+
+        // Only the column names are needed from here on
+        MiningContext ctx = {.data = &header, .counting = options->counting, .output = output};
+        ctx.supports = createItemsetMap(header.numCols);
+        ctx.arena = createArena(ARENA_CHUNK_SIZE);
+        int numLevels;
+        LevelSets **sets = countGlobalSupports(&numLevels, &ctx, &candidates, partitions, numPartitions,
+                                               minSupportRows, memoryBudget);
+        writeMiningResults(sets, numLevels, &ctx, options->minConfidence);
+        freeItemsetMap(ctx.supports);
+        freeArena(ctx.arena);
+    }
+
+    free(partitions);
+    free(header.headers[0]);
+    free(header.headers);
+    unmapFile(&file);
+    setMiningThreads(previousThreads);
+}
@@ -0,0 +1,56 @@
+#ifndef TABLE_H
+#define TABLE_H
+
+#include "apriori.h"
+
+/**
+ * @brief Returns the columns of the non-zero cells of a row, regardless of whether the table is dense or sparse.
+ *
+ * @param data The table.
+ * @param y Index of the row.
+ * @param buffer Buffer with room for data->numCols columns. Only written to if the table is dense.
+ * @param numItems The number of columns in the row will be written to this pointer.
+ * @return const int* The columns of the row in ascending order.
+ */
+static inline const int *tableRowItems(const TableData *data, int y, int *buffer, int *numItems) {
+    if (!data->data) {
+        *numItems = data->rowStart[y + 1] - data->rowStart[y];
+        return data->items + data->rowStart[y];
+    }
+    const int *row = data->data[y];
+    int n = 0;
+    for (int x = 0; x < data->numCols; x++) {
+        if (row[x]) {
+            buffer[n++] = x;
+        }
+    }
+    *numItems = n;
+    return buffer;
+}
+
+/**
+ * @brief Checks whether a cell of the table is non-zero. Takes a binary search over the row if the table is sparse.
+ *
+ * @param data The table.
+ * @param y Index of the row.
+ * @param item Index of the column.
+ * @return int 1 if the cell is non-zero, 0 otherwise.
+ */
+static inline int tableHasItem(const TableData *data, int y, int item) {
+    if (data->data) {
+        return data->data[y][item] != 0;
+    }
+    size_t lo = data->rowStart[y];
+    size_t hi = data->rowStart[y + 1];
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (data->items[mid] < item) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < data->rowStart[y + 1] && data->items[lo] == item;
+}
+
+#endif  // TABLE_H
@@ -0,0 +1,73 @@
+#include "tidlists.h"
+
+#include <omp.h>
+#include <stdlib.h>
+
+#include "table.h"
+#include "utils.h"
+
+TidListTable *createTidListTable(const TableData *data, const int *items, int numItems) {
+    TidListTable *table = safeMalloc(sizeof(TidListTable));
+    int n = items ? numItems : data->numCols;
+    table->numItems = n;
+    table->numRows = data->numRows;
+    table->itemIdx = items ? createItemIndex(data->numCols, items, numItems) : NULL;
+    table->listStart = safeMalloc(((size_t)n + 1) * sizeof(size_t));
+
+    // Every thread counts the tids of its own block of rows per item, and then writes them at the offsets that follow
+    // from those counts. Both loops split the rows over the threads in the same way, in order, so every list is sorted.
+    int numThreads = omp_get_max_threads();
+    size_t *offsets = safeCalloc((size_t)numThreads * (n + 1), sizeof(size_t));
+    const int *itemIdx = table->itemIdx;
+    #pragma omp parallel num_threads(numThreads)
+    {
+        size_t *threadOffsets = offsets + (size_t)omp_get_thread_num() * (n + 1);
+        int *rowBuffer = safeMalloc(data->numCols * sizeof(int));
+        #pragma omp for schedule(static)
+        for (int y = 0; y < data->numRows; y++) {
+            int rowSize;
+            const int *row = tableRowItems(data, y, rowBuffer, &rowSize);
+            for (int i = 0; i < rowSize; i++) {
+                int idx = itemIdx ? itemIdx[row[i]] : row[i];
+                if (idx >= 0) {
+                    threadOffsets[idx]++;
+                }
+            }
+        }
+        #pragma omp single
+        {
+            size_t position = 0;
+            for (int i = 0; i < n; i++) {
+                table->listStart[i] = position;
+                for (int t = 0; t < numThreads; t++) {
+                    size_t count = offsets[(size_t)t * (n + 1) + i];
+                    offsets[(size_t)t * (n + 1) + i] = position;
+                    position += count;
+                }
+            }
+            table->listStart[n] = position;
+            table->tids = safeMalloc((position + 1) * sizeof(int));
+        }
+        #pragma omp for schedule(static)
+        for (int y = 0; y < data->numRows; y++) {
+            int rowSize;
+            const int *row = tableRowItems(data, y, rowBuffer, &rowSize);
+            for (int i = 0; i < rowSize; i++) {
+                int idx = itemIdx ? itemIdx[row[i]] : row[i];
+                if (idx >= 0) {
+                    table->tids[threadOffsets[idx]++] = y;
+                }
+            }
+        }
+        free(rowBuffer);
+    }
+    free(offsets);
+    return table;
+}
+
+void freeTidListTable(TidListTable *table) {
+    free(table->itemIdx);
+    free(table->listStart);
+    free(table->tids);
+    free(table);
+}
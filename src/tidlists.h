@@ -0,0 +1,53 @@
+#ifndef TIDLISTS_H
+#define TIDLISTS_H
+
+#include <stddef.h>
+
+#include "apriori.h"
+
+/**
+ * @brief Item-major sparse representation of a TableData. For every included item (column), the rows it occurs in are
+ * stored in ascending order, with all tid-lists back to back in a single array. The tids of the item at index i are
+ * tids[listStart[i]] ... tids[listStart[i + 1] - 1]. Unlike a BitsetTable, the size only grows with the number of
+ * non-zero cells, so it stays small for sparse data.
+ */
+typedef struct TidListTable {
+    int numItems;       // Number of tid-lists
+    int numRows;
+    int *itemIdx;       // Tid-list of every column, -1 for columns without one. NULL if every column has one, in order.
+    size_t *listStart;  // numItems + 1 offsets into tids
+    int *tids;
+} TidListTable;
+
+/**
+ * @brief Builds the tid-lists of some or all columns of the provided table in two scans over its rows.
+ *
+ * @param data Table where each row signifies a transaction and each column a product.
+ * @param items The columns to build a tid-list for. NULL to build one for every column.
+ * @param numItems Number of columns in items. Ignored if items is NULL.
+ * @return TidListTable* The tid-lists. Must be freed with freeTidListTable.
+ */
+TidListTable *createTidListTable(const TableData *data, const int *items, int numItems);
+
+/**
+ * @brief Frees the memory used by a tid-list table.
+ *
+ * @param table The tid-list table to free.
+ */
+void freeTidListTable(TidListTable *table);
+
+/**
+ * @brief Retrieves the tid-list of a single item.
+ *
+ * @param table The tid-list table.
+ * @param item Index of the item (column). Must have a tid-list in the table.
+ * @param numTids The number of tids in the list will be written to this pointer.
+ * @return const int* The rows the item occurs in, in ascending order.
+ */
+static inline const int *itemTids(const TidListTable *table, int item, int *numTids) {
+    size_t idx = table->itemIdx ? table->itemIdx[item] : item;
+    *numTids = table->listStart[idx + 1] - table->listStart[idx];
+    return table->tids + table->listStart[idx];
+}
+
+#endif  // TIDLISTS_H
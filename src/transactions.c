@@ -0,0 +1,177 @@
+#include "transactions.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "table.h"
+#include "utils.h"
+
+TransactionList *createTransactionList(const TableData *data, const int *keepItems) {
+    TransactionList *list = safeCalloc(1, sizeof(TransactionList));
+    list->numRows = data->numRows;
+    list->rowStart = safeMalloc(((size_t)data->numRows + 1) * sizeof(size_t));
+
+    // First pass counts the items per row, second pass fills them in at the prefix-summed offsets
+    list->rowStart[0] = 0;
+    #pragma omp parallel
+    {
+        int *rowBuffer = safeMalloc(data->numCols * sizeof(int));
+        #pragma omp for schedule(static)
+        for (int y = 0; y < data->numRows; y++) {
+            int rowSize;
+            const int *row = tableRowItems(data, y, rowBuffer, &rowSize);
+            size_t numItems = 0;
+            for (int i = 0; i < rowSize; i++) {
+                numItems += !keepItems || keepItems[row[i]];
+            }
+            list->rowStart[y + 1] = numItems;
+        }
+        free(rowBuffer);
+    }
+    for (int y = 0; y < data->numRows; y++) {
+        list->rowStart[y + 1] += list->rowStart[y];
+    }
+    list->items = safeMalloc((list->rowStart[data->numRows] + 1) * sizeof(int));
+    #pragma omp parallel
+    {
+        int *rowBuffer = safeMalloc(data->numCols * sizeof(int));
+        #pragma omp for schedule(static)
+        for (int y = 0; y < data->numRows; y++) {
+            int rowSize;
+            const int *row = tableRowItems(data, y, rowBuffer, &rowSize);
+            int *items = list->items + list->rowStart[y];
+            for (int i = 0; i < rowSize; i++) {
+                if (!keepItems || keepItems[row[i]]) {
+                    *items++ = row[i];
+                }
+            }
+        }
+        free(rowBuffer);
+    }
+    return list;
+}
+
+static int compareKeys(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Hashes the items of a row, to find identical rows with.
+ */
+static inline uint64_t hashRow(const int *items, int numItems) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ (uint64_t)numItems;
+    for (int i = 0; i < numItems; i++) {
+        h = (h ^ (uint32_t)items[i]) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+    }
+    return h ^ (h >> 29);
+}
+
+TransactionList *createReducedTransactionList(const TableData *data, const int *supports, int minItems) {
+    // The rarest items get the lowest ids. Every key holds the support in its high and the column in its low bits.
+    int64_t *keys = safeMalloc((data->numCols + 1) * sizeof(int64_t));
+    int *keepItems = safeCalloc(data->numCols, sizeof(int));
+    int numItemIds = 0;
+    for (int c = 0; c < data->numCols; c++) {
+        if (supports[c] >= 0) {
+            keys[numItemIds++] = (int64_t)supports[c] << 32 | c;
+            keepItems[c] = 1;
+        }
+    }
+    qsort(keys, numItemIds, sizeof(int64_t), compareKeys);
+    TransactionList *list = createTransactionList(data, keepItems);
+    free(keepItems);
+    list->numItemIds = numItemIds;
+    list->itemColumns = safeMalloc((numItemIds + 1) * sizeof(int));
+    list->itemIds = safeMalloc(data->numCols * sizeof(int));
+    for (int c = 0; c < data->numCols; c++) {
+        list->itemIds[c] = -1;
+    }
+    for (int id = 0; id < numItemIds; id++) {
+        list->itemColumns[id] = (int)(keys[id] & INT32_MAX);
+        list->itemIds[list->itemColumns[id]] = id;
+    }
+    free(keys);
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < list->numRows; y++) {
+        int *items = list->items + list->rowStart[y];
+        int numItems = list->rowStart[y + 1] - list->rowStart[y];
+        for (int i = 0; i < numItems; i++) {
+            items[i] = list->itemIds[items[i]];
+        }
+        sortInts(items, numItems);
+    }
+    list->weights = safeMalloc(((size_t)list->numRows + 1) * sizeof(int));
+    for (int y = 0; y < list->numRows; y++) {
+        list->weights[y] = 1;
+    }
+    reduceTransactionList(list, NULL, 0, minItems);
+    return list;
+}
+
+void reduceTransactionList(TransactionList *list, const int *itemHits, int minHits, int minItems) {
+    if (!list->weights) {
+        list->weights = safeMalloc(((size_t)list->numRows + 1) * sizeof(int));
+        for (int y = 0; y < list->numRows; y++) {
+            list->weights[y] = 1;
+        }
+    }
+    // Open addressing table of the rows kept so far, to merge identical rows. -1 marks an empty slot.
+    size_t capacity = 16;
+    while (capacity < 2 * (size_t)list->numRows) {
+        capacity *= 2;
+    }
+    int *slots = safeMalloc(capacity * sizeof(int));
+    memset(slots, -1, capacity * sizeof(int));
+
+    // The rows are compacted in place. The items and offsets of a row are read before anything at or after them is
+    // overwritten, since the kept rows only move to lower positions.
+    int numRows = 0;
+    size_t start = list->rowStart[0];
+    for (int y = 0; y < list->numRows; y++) {
+        size_t end = list->rowStart[y + 1];
+        int weight = list->weights[y];
+        int *items = list->items + list->rowStart[numRows];
+        int numItems = 0;
+        for (size_t i = start; i < end; i++) {
+            if (!itemHits || itemHits[i] >= minHits) {
+                items[numItems++] = list->items[i];
+            }
+        }
+        start = end;
+        if (numItems < minItems) {
+            continue;
+        }
+        size_t slot = hashRow(items, numItems) & (capacity - 1);
+        for (; slots[slot] >= 0; slot = (slot + 1) & (capacity - 1)) {
+            int other = slots[slot];
+            size_t otherStart = list->rowStart[other];
+            if (list->rowStart[other + 1] - otherStart == (size_t)numItems &&
+                memcmp(list->items + otherStart, items, numItems * sizeof(int)) == 0) {
+                break;
+            }
+        }
+        if (slots[slot] >= 0) {
+            list->weights[slots[slot]] += weight;
+            continue;
+        }
+        slots[slot] = numRows;
+        list->weights[numRows] = weight;
+        list->rowStart[numRows + 1] = list->rowStart[numRows] + numItems;
+        numRows++;
+    }
+    list->numRows = numRows;
+    free(slots);
+}
+
+void freeTransactionList(TransactionList *list) {
+    free(list->rowStart);
+    free(list->items);
+    free(list->weights);
+    free(list->itemColumns);
+    free(list->itemIds);
+    free(list);
+}
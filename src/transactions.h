@@ -0,0 +1,68 @@
+#ifndef TRANSACTIONS_H
+#define TRANSACTIONS_H
+
+#include <stddef.h>
+
+#include "apriori.h"
+
+/**
+ * @brief Horizontal sparse representation of a TableData. For every transaction, the sorted indices of the items it
+ * contains are stored back to back in a single array. The items of transaction r are
+ * items[rowStart[r]] ... items[rowStart[r + 1] - 1].
+ *
+ * A reduced list, see createReducedTransactionList, holds dense item ids instead of column indices, and every row may
+ * stand for a number of identical transactions.
+ */
+typedef struct TransactionList {
+    int numRows;
+    size_t *rowStart;  // numRows + 1 offsets into items
+    int *items;
+    int *weights;      // Number of transactions every row stands for. NULL if every row is a single transaction.
+    int numItemIds;    // Number of dense item ids. 0 if the items are column indices.
+    int *itemColumns;  // Column of every dense item id. NULL if the items are column indices.
+    int *itemIds;      // Dense item id of every column, -1 for dropped columns. NULL if the items are column indices.
+} TransactionList;
+
+/**
+ * @brief Builds the transaction list of the provided table.
+ *
+ * @param data Table where each row signifies a transaction and each column a product. An entry in this table is either
+ * 1 or 0, depending on whether the product occured in the provided transacion.
+ * @param keepItems Optional array with an entry for every column. Only columns with a non-zero entry are added to the
+ * transaction list. If NULL, all columns are added.
+ * @return TransactionList* The transaction list. Must be freed with freeTransactionList.
+ */
+TransactionList *createTransactionList(const TableData *data, const int *keepItems);
+
+/**
+ * @brief Builds a reduced transaction list of the provided table: the kept columns are remapped to dense item ids in
+ * order of ascending support, rows with too few kept items are dropped and identical rows are merged into a single
+ * weighted row.
+ *
+ * @param data Table where each row signifies a transaction and each column a product.
+ * @param supports Support of every column, or -1 to drop the column.
+ * @param minItems Rows with fewer kept items are dropped.
+ * @return TransactionList* The transaction list. Must be freed with freeTransactionList.
+ */
+TransactionList *createReducedTransactionList(const TableData *data, const int *supports, int minItems);
+
+/**
+ * @brief Shrinks a reduced transaction list between two levels: items that take part in too few candidates of their
+ * row are dropped, as are rows that are left with too few items. Rows that became identical are merged.
+ *
+ * @param list The reduced transaction list.
+ * @param itemHits Optional number of candidates every item of list->items is part of, see countTrieSupportsAndHits.
+ * If NULL, all items are kept.
+ * @param minHits Items with fewer hits are dropped.
+ * @param minItems Rows with fewer remaining items are dropped.
+ */
+void reduceTransactionList(TransactionList *list, const int *itemHits, int minHits, int minItems);
+
+/**
+ * @brief Frees the memory used by a transaction list.
+ *
+ * @param list The transaction list to free.
+ */
+void freeTransactionList(TransactionList *list);
+
+#endif  // TRANSACTIONS_H
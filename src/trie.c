@@ -0,0 +1,191 @@
+#include "trie.h"
+
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "utils.h"
+
+/**
+ * @brief Node of the trie. The children of a node are stored consecutively and sorted on their item. For leaves,
+ * firstChild is the index of the candidate the leaf represents.
+ */
+typedef struct TrieNode {
+    int item;
+    int firstChild;
+    int numChildren;
+} TrieNode;
+
+struct CandidateTrie {
+    TrieNode *nodes;  // nodes[0] is the root
+    int numNodes;
+    int capacity;
+    int numSets;
+    int setSize;
+};
+
+static int addNode(CandidateTrie *trie, int item) {
+    if (trie->numNodes == trie->capacity) {
+        trie->capacity *= 2;
+        trie->nodes = realloc(trie->nodes, trie->capacity * sizeof(TrieNode));
+        if (!trie->nodes) {
+            fatalError("Failed to grow the candidate trie to %d nodes.\n", trie->capacity);
+        }
+    }
+    trie->nodes[trie->numNodes] = (TrieNode){.item = item, .firstChild = 0, .numChildren = 0};
+    return trie->numNodes++;
+}
+
+/**
+ * @brief Adds the children of a node for the candidates in [lo, hi), which all share their first depth items. All
+ * children are added before recursing, so that they end up next to each other.
+ */
+static void buildChildren(CandidateTrie *trie, int node, int **sets, int lo, int hi, int depth) {
+    int firstChild = trie->numNodes;
+    int numChildren = 0;
+    for (int c = lo; c < hi; c++) {
+        if (c == lo || sets[c][depth] != sets[c - 1][depth]) {
+            addNode(trie, sets[c][depth]);
+            numChildren++;
+        }
+    }
+    trie->nodes[node].firstChild = firstChild;
+    trie->nodes[node].numChildren = numChildren;
+
+    int child = firstChild;
+    int start = lo;
+    for (int c = lo + 1; c <= hi; c++) {
+        if (c == hi || sets[c][depth] != sets[start][depth]) {
+            if (depth + 1 == trie->setSize) {
+                trie->nodes[child].firstChild = start;  // Leaf: store the candidate index
+            } else {
+                buildChildren(trie, child, sets, start, c, depth + 1);
+            }
+            child++;
+            start = c;
+        }
+    }
+}
+
+CandidateTrie *createCandidateTrie(int **sets, int numSets, int setSize) {
+    CandidateTrie *trie = safeMalloc(sizeof(CandidateTrie));
+    trie->capacity = 1024;
+    trie->nodes = safeMalloc(trie->capacity * sizeof(TrieNode));
+    trie->numNodes = 0;
+    trie->numSets = numSets;
+    trie->setSize = setSize;
+    addNode(trie, -1);
+    if (numSets > 0) {
+        buildChildren(trie, 0, sets, 0, numSets, 0);
+    }
+    return trie;
+}
+
+size_t candidateTrieBytes(int numSets, int setSize) {
+    // The node array doubles when it is full, so up to half of it may be unused
+    size_t numNodes = 1 + (size_t)numSets * setSize;
+    return sizeof(CandidateTrie) + 2 * numNodes * sizeof(TrieNode) +
+           (size_t)(omp_get_max_threads() - 1) * numSets * sizeof(int);
+}
+
+void freeCandidateTrie(CandidateTrie *trie) {
+    free(trie->nodes);
+    free(trie);
+}
+
+/**
+ * @brief State of the walk of a single row through the trie.
+ */
+typedef struct TrieWalk {
+    int *counts;       // Count array of the current thread
+    int weight;        // Number of transactions the row stands for
+    int *hits;         // Hit count of every item of the row. NULL if the hits are not counted.
+    const int *row;    // First item of the row
+    const int **path;  // The matched item of the row at every depth
+} TrieWalk;
+
+/**
+ * @brief Walks a transaction through the subtree of a node and increments the counts of all candidates (leaves) it
+ * contains. The children of the node and the remaining items of the transaction are both sorted, so they are merged.
+ *
+ * @param trie The trie.
+ * @param node The node whose children to match.
+ * @param depth Depth of the node. The root has depth 0.
+ * @param items Remaining items of the transaction.
+ * @param numItems Number of remaining items.
+ * @param walk The row and the counts to add to.
+ */
+static void countNode(const CandidateTrie *trie, const TrieNode *node, int depth, const int *items, int numItems,
+                      const TrieWalk *walk) {
+    const TrieNode *child = trie->nodes + node->firstChild;
+    const TrieNode *end = child + node->numChildren;
+    int remaining = trie->setSize - depth;  // Items still needed to complete a candidate
+    int i = 0;
+    while (child < end && numItems - i >= remaining) {
+        if (child->item < items[i]) {
+            child++;
+        } else if (child->item > items[i]) {
+            i++;
+        } else {
+            walk->path[depth] = items + i;
+            if (remaining > 1) {
+                countNode(trie, child, depth + 1, items + i + 1, numItems - i - 1, walk);
+            } else {
+                walk->counts[child->firstChild] += walk->weight;
+                for (int d = 0; walk->hits && d <= depth; d++) {
+                    walk->hits[walk->path[d] - walk->row]++;
+                }
+            }
+            child++;
+            i++;
+        }
+    }
+}
+
+void countTrieSupports(const CandidateTrie *trie, const TransactionList *transactions, int *supports) {
+    countTrieSupportsAndHits(trie, transactions, supports, NULL);
+}
+
+void countTrieSupportsAndHits(const CandidateTrie *trie, const TransactionList *transactions, int *supports,
+                              int *itemHits) {
+    int numThreads = omp_get_max_threads();
+    int **counts = safeCalloc(numThreads, sizeof(int *));
+    counts[0] = supports;
+    memset(supports, 0, trie->numSets * sizeof(int));
+    if (itemHits) {
+        memset(itemHits, 0, transactions->rowStart[transactions->numRows] * sizeof(int));
+    }
+    #pragma omp parallel
+    {
+        int thread = omp_get_thread_num();
+        if (thread > 0) {
+            counts[thread] = safeCalloc(trie->numSets, sizeof(int));
+        }
+        const int *path[trie->setSize];
+        TrieWalk walk = {counts[thread], 1, NULL, NULL, path};
+        double busyStart = busyClock();
+        #pragma omp for schedule(dynamic, 256) nowait
+        for (int y = 0; y < transactions->numRows; y++) {
+            size_t start = transactions->rowStart[y];
+            int numItems = transactions->rowStart[y + 1] - start;
+            walk.row = transactions->items + start;
+            walk.weight = transactions->weights ? transactions->weights[y] : 1;
+            walk.hits = itemHits ? itemHits + start : NULL;
+            countNode(trie, &trie->nodes[0], 0, walk.row, numItems, &walk);
+        }
+        addThreadBusy(PHASE_COUNT, trie->setSize, busyClock() - busyStart);
+        // All counts must be complete before they are summed
+        #pragma omp barrier
+        #pragma omp for schedule(static)
+        for (int c = 0; c < trie->numSets; c++) {
+            for (int t = 1; t < omp_get_num_threads(); t++) {
+                supports[c] += counts[t][c];
+            }
+        }
+    }
+    for (int t = 1; t < numThreads; t++) {
+        free(counts[t]);
+    }
+    free(counts);
+}
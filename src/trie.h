@@ -0,0 +1,64 @@
+#ifndef TRIE_H
+#define TRIE_H
+
+#include "transactions.h"
+
+/**
+ * @brief Prefix trie over the candidate item sets of a single level. Every path from the root to a leaf spells out one
+ * candidate, so all candidates contained in a transaction can be found in a single walk over the transaction.
+ */
+typedef struct CandidateTrie CandidateTrie;
+
+/**
+ * @brief Builds a prefix trie of a number of candidate sets.
+ *
+ * @param sets The candidate sets. Must be sorted lexicographically and every set must be sorted.
+ * @param numSets Number of candidate sets.
+ * @param setSize Number of elements in every set.
+ * @return CandidateTrie* The trie. Must be freed with freeCandidateTrie.
+ */
+CandidateTrie *createCandidateTrie(int **sets, int numSets, int setSize);
+
+/**
+ * @brief Returns an upper bound on the number of bytes a trie of a number of candidates takes while it is counted with
+ * countTrieSupports, including the count arrays of the threads.
+ *
+ * @param numSets Number of candidate sets.
+ * @param setSize Number of elements in every set.
+ * @return size_t The bound. The nodes only reach it if the candidates share no prefix at all.
+ */
+size_t candidateTrieBytes(int numSets, int setSize);
+
+/**
+ * @brief Frees the memory used by a candidate trie.
+ *
+ * @param trie The trie to free.
+ */
+void freeCandidateTrie(CandidateTrie *trie);
+
+/**
+ * @brief Calculates the support of all candidates in the trie in a single parallel scan over the transactions. Every
+ * thread counts a part of the transactions into its own count array; the arrays are summed at the end.
+ *
+ * @param trie The candidate trie.
+ * @param transactions The transactions to count in.
+ * @param supports Output array with an entry per candidate, in the order the candidates were passed to
+ * createCandidateTrie.
+ */
+void countTrieSupports(const CandidateTrie *trie, const TransactionList *transactions, int *supports);
+
+/**
+ * @brief Calculates the support of all candidates in the trie like countTrieSupports, and also counts for every item
+ * of every transaction the number of candidates it is part of in that transaction. An item with fewer than k hits at
+ * level k can not be part of a candidate of level k + 1 in that transaction, see reduceTransactionList.
+ *
+ * @param trie The candidate trie.
+ * @param transactions The transactions to count in.
+ * @param supports Output array with an entry per candidate, in the order the candidates were passed to
+ * createCandidateTrie.
+ * @param itemHits Output array with an entry per item of transactions->items.
+ */
+void countTrieSupportsAndHits(const CandidateTrie *trie, const TransactionList *transactions, int *supports,
+                              int *itemHits);
+
+#endif  // TRIE_H
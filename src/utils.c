@@ -0,0 +1,86 @@
+#include "utils.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void fatalError(const char *format, ...) {
+    fprintf(stderr, "Fatal error: ");
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    exit(EXIT_FAILURE);
+}
+
+void warning(const char *format, ...) {
+    fprintf(stderr, "Warning: ");
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+void *safeMalloc(size_t size) {
+    void *p = malloc(size);
+    if (p == NULL) {
+        fatalError("safeMalloc(%zu) failed.\n", size);
+    }
+    return p;
+}
+
+void *safeCalloc(size_t count, size_t size) {
+    void *p = calloc(count, size);
+    if (p == NULL) {
+        fatalError("safeCalloc(%zu, %zu) failed.\n", count, size);
+    }
+    return p;
+}
+
+void *safeAlignedMalloc(size_t alignment, size_t size) {
+    void *p = NULL;
+    if (posix_memalign(&p, alignment, size) != 0) {
+        fatalError("safeAlignedMalloc(%zu) failed.\n", size);
+    }
+    return p;
+}
+
+void *safeAlignedCalloc(size_t alignment, size_t size) {
+    void *p = safeAlignedMalloc(alignment, size);
+    memset(p, 0, size);
+    return p;
+}
+
+static int compareInts(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+void sortInts(int *values, int n) {
+    if (n > 16) {
+        qsort(values, n, sizeof(int), compareInts);
+        return;
+    }
+    for (int i = 1; i < n; i++) {
+        int value = values[i];
+        int j = i - 1;
+        while (j >= 0 && values[j] > value) {
+            values[j + 1] = values[j];
+            j--;
+        }
+        values[j + 1] = value;
+    }
+}
+
+int *createItemIndex(int numCols, const int *items, int numItems) {
+    int *itemIdx = safeMalloc((numCols + 1) * sizeof(int));
+    for (int c = 0; c < numCols; c++) {
+        itemIdx[c] = -1;
+    }
+    for (int i = 0; i < numItems; i++) {
+        itemIdx[items[i]] = i;
+    }
+    return itemIdx;
+}
@@ -0,0 +1,81 @@
+#ifndef UTILS_H
+#define UTILS_H
+
+#include <stddef.h>
+
+/**
+ * @brief Prints a message to stderr and exits the program. Works with var args similar to printf.
+ *
+ * @param format Message to print.
+ * @param ... Var args. Use is similar to printf.
+ */
+void fatalError(const char *format, ...);
+
+/**
+ * @brief Prints a warning message to stderr.
+ *
+ * @param format Message to print
+ * @param ... Var args. Use is similar to printf.
+ */
+void warning(const char *format, ...);
+
+/**
+ * @brief Utility function to ensure malloc is not called with incorrect values. Verifies that malloc correctly
+ * allocates memory.
+ *
+ * @param size Number of bytes to allocate.
+ * @return void* Pointer to the allocated memory.
+ */
+void *safeMalloc(size_t size);
+
+/**
+ * @brief Utility function that allocates zero-initialised memory for an array. Exits the program if the allocation
+ * fails.
+ *
+ * @param count Number of elements to allocate.
+ * @param size Size of a single element in bytes.
+ * @return void* Pointer to the allocated memory.
+ */
+void *safeCalloc(size_t count, size_t size);
+
+/**
+ * @brief Allocates uninitialised memory aligned to the given boundary. Exits the program if the allocation fails. The
+ * pages are only placed on a NUMA node when they are first written, so the threads that will use the memory should be
+ * the ones to initialise it. The memory can be released with a regular free.
+ *
+ * @param alignment Alignment in bytes. Must be a power of two and a multiple of sizeof(void *).
+ * @param size Number of bytes to allocate.
+ * @return void* Pointer to the allocated memory.
+ */
+void *safeAlignedMalloc(size_t alignment, size_t size);
+
+/**
+ * @brief Allocates zero-initialised memory aligned to the given boundary. Exits the program if the allocation fails.
+ * The memory can be released with a regular free.
+ *
+ * @param alignment Alignment in bytes. Must be a power of two and a multiple of sizeof(void *).
+ * @param size Number of bytes to allocate.
+ * @return void* Pointer to the allocated memory.
+ */
+void *safeAlignedCalloc(size_t alignment, size_t size);
+
+/**
+ * @brief Sorts an array of ints in ascending order. Transactions, paths and item sets are usually short, so these are
+ * insertion sorted.
+ *
+ * @param values The values to sort.
+ * @param n Number of values.
+ */
+void sortInts(int *values, int n);
+
+/**
+ * @brief Maps every column of a table to its index among a number of items.
+ *
+ * @param numCols Number of columns.
+ * @param items The columns to include.
+ * @param numItems Number of columns to include.
+ * @return int* Index of every column within items, -1 for columns that are not included. Has numCols + 1 entries.
+ */
+int *createItemIndex(int numCols, const int *items, int numItems);
+
+#endif  // UTILS_H